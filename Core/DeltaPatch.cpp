@@ -0,0 +1,240 @@
+#include "stdafx.h"
+
+#include <bcrypt.h>
+#include <stdarg.h>
+#include <zstd.h>
+
+#include "DeltaPatch.h"
+
+namespace {
+    // Patches are made with --long=27; anything asking for a bigger window than that isn't one of ours
+    constexpr int MAX_WINDOW_LOG = 27;
+    constexpr size_t SHA256_SIZE = 32;
+
+    std::string ToHex(const uint8_t* Bytes, const size_t Length)
+    {
+        static constexpr char Digits[] = "0123456789abcdef";
+        std::string Out(Length * 2, '\0');
+        for (size_t i = 0; i < Length; i++) {
+            Out[i * 2] = Digits[Bytes[i] >> 4];
+            Out[i * 2 + 1] = Digits[Bytes[i] & 0xF];
+        }
+        return Out;
+    }
+
+    bool ReadEntireFile(const wchar_t* FilePath, std::vector<char>& Out)
+    {
+        FILE* File = _wfopen(FilePath, L"rb");
+        if (!File) {
+            return false;
+        }
+        Out.clear();
+        char Buffer[64 * 1024];
+        size_t Read;
+        while ((Read = fread(Buffer, 1, sizeof(Buffer), File)) > 0) {
+            Out.insert(Out.end(), Buffer, Buffer + Read);
+        }
+        const bool Success = !ferror(File);
+        fclose(File);
+        return Success;
+    }
+}
+
+bool ComputeFileSha256(const wchar_t* FilePath, std::string& Out)
+{
+    FILE* File = _wfopen(FilePath, L"rb");
+    if (!File) {
+        return false;
+    }
+    BCRYPT_ALG_HANDLE hAlg = nullptr;
+    BCRYPT_HASH_HANDLE hHash = nullptr;
+    bool Success = BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&hAlg, BCRYPT_SHA256_ALGORITHM, nullptr, 0))
+        && BCRYPT_SUCCESS(BCryptCreateHash(hAlg, &hHash, nullptr, 0, nullptr, 0, 0));
+
+    uint8_t Buffer[64 * 1024];
+    size_t Read;
+    while (Success && (Read = fread(Buffer, 1, sizeof(Buffer), File)) > 0) {
+        Success = BCRYPT_SUCCESS(BCryptHashData(hHash, Buffer, static_cast<ULONG>(Read), 0));
+    }
+    Success = Success && !ferror(File);
+
+    uint8_t Digest[SHA256_SIZE];
+    Success = Success && BCRYPT_SUCCESS(BCryptFinishHash(hHash, Digest, sizeof(Digest), 0));
+    if (Success) {
+        Out = ToHex(Digest, sizeof(Digest));
+    }
+
+    if (hHash) {
+        BCryptDestroyHash(hHash);
+    }
+    if (hAlg) {
+        BCryptCloseAlgorithmProvider(hAlg, 0);
+    }
+    fclose(File);
+    return Success;
+}
+
+DeltaPatch::DeltaPatch()
+    : m_DCtx(nullptr)
+    , m_HashAlg(nullptr)
+    , m_Hash(nullptr)
+    , m_File(nullptr)
+    , m_BytesWritten(0)
+    , m_FrameDone(false)
+    , m_Failed(false)
+{
+}
+
+DeltaPatch::~DeltaPatch()
+{
+    if (m_File) {
+        fclose(m_File);
+    }
+    if (m_DCtx) {
+        ZSTD_freeDCtx(m_DCtx);
+    }
+    if (m_Hash) {
+        BCryptDestroyHash(m_Hash);
+    }
+    if (m_HashAlg) {
+        BCryptCloseAlgorithmProvider(m_HashAlg, 0);
+    }
+}
+
+bool DeltaPatch::Fail(const char* Format, ...)
+{
+    char Buffer[256];
+    va_list Args;
+    va_start(Args, Format);
+    vsnprintf(Buffer, sizeof(Buffer), Format, Args);
+    va_end(Args);
+    m_Error = Buffer;
+    m_Failed = true;
+    return false;
+}
+
+bool DeltaPatch::Begin(const wchar_t* BasePath, const wchar_t* OutputPath)
+{
+    assert(!m_DCtx && !m_File);
+
+    if (!ReadEntireFile(BasePath, m_Base)) {
+        return Fail("Failed to read base file '%ls'", BasePath);
+    }
+    if (!BCRYPT_SUCCESS(BCryptOpenAlgorithmProvider(&m_HashAlg, BCRYPT_SHA256_ALGORITHM, nullptr, 0))
+        || !BCRYPT_SUCCESS(BCryptCreateHash(m_HashAlg, &m_Hash, nullptr, 0, nullptr, 0, 0))) {
+        return Fail("Failed to create SHA-256 hash");
+    }
+
+    m_DCtx = ZSTD_createDCtx();
+    if (!m_DCtx) {
+        return Fail("ZSTD_createDCtx failed");
+    }
+    // The base file is the "prefix" the patch refers back to; it has to stay alive until the frame is done
+    size_t Result = ZSTD_DCtx_setParameter(m_DCtx, ZSTD_d_windowLogMax, MAX_WINDOW_LOG);
+    if (!ZSTD_isError(Result)) {
+        Result = ZSTD_DCtx_refPrefix(m_DCtx, m_Base.data(), m_Base.size());
+    }
+    if (ZSTD_isError(Result)) {
+        return Fail("Failed to set up decompression: %s", ZSTD_getErrorName(Result));
+    }
+    m_OutBuffer.resize(ZSTD_DStreamOutSize());
+
+    m_File = _wfopen(OutputPath, L"wb");
+    if (!m_File) {
+        return Fail("Failed to open '%ls' for writing (%lu)", OutputPath, GetLastError());
+    }
+    return true;
+}
+
+bool DeltaPatch::Flush(const size_t Count)
+{
+    if (!Count) {
+        return true;
+    }
+    if (fwrite(m_OutBuffer.data(), 1, Count, m_File) != Count) {
+        return Fail("Failed to write %zu bytes (%lu)", Count, GetLastError());
+    }
+    if (!BCRYPT_SUCCESS(BCryptHashData(m_Hash, reinterpret_cast<PUCHAR>(m_OutBuffer.data()), static_cast<ULONG>(Count), 0))) {
+        return Fail("Failed to hash output");
+    }
+    m_BytesWritten += Count;
+    return true;
+}
+
+bool DeltaPatch::Write(const void* Data, const size_t Size)
+{
+    if (m_Failed || !m_DCtx || !m_File) {
+        return false;
+    }
+    ZSTD_inBuffer Input = {Data, Size, 0};
+    for (;;) {
+        ZSTD_outBuffer Output = {m_OutBuffer.data(), m_OutBuffer.size(), 0};
+        const size_t Result = ZSTD_decompressStream(m_DCtx, &Output, &Input);
+        if (ZSTD_isError(Result)) {
+            return Fail("Failed to apply patch: %s", ZSTD_getErrorName(Result));
+        }
+        if (!Flush(Output.pos)) {
+            return false;
+        }
+        if (Result == 0) {
+            // The prefix only applies to one frame, so a patch is exactly one frame
+            m_FrameDone = true;
+            if (Input.pos < Input.size) {
+                return Fail("Unexpected data after the end of the patch");
+            }
+            return true;
+        }
+        // A full output buffer may mean there's more to flush for the input we already gave it
+        if (Input.pos == Input.size && Output.pos < Output.size) {
+            return true;
+        }
+    }
+}
+
+bool DeltaPatch::ApplyFile(const wchar_t* PatchPath)
+{
+    FILE* File = _wfopen(PatchPath, L"rb");
+    if (!File) {
+        return Fail("Failed to open patch '%ls' (%lu)", PatchPath, GetLastError());
+    }
+    std::vector<char> Buffer(ZSTD_DStreamInSize());
+    size_t Read;
+    bool Success = true;
+    while (Success && (Read = fread(Buffer.data(), 1, Buffer.size(), File)) > 0) {
+        Success = Write(Buffer.data(), Read);
+    }
+    if (Success && ferror(File)) {
+        Success = Fail("Failed to read patch '%ls'", PatchPath);
+    }
+    fclose(File);
+    return Success;
+}
+
+bool DeltaPatch::End()
+{
+    if (m_File) {
+        if (fclose(m_File) != 0 && !m_Failed) {
+            Fail("Failed to close output (%lu)", GetLastError());
+        }
+        m_File = nullptr;
+    }
+    if (m_DCtx) {
+        ZSTD_freeDCtx(m_DCtx);
+        m_DCtx = nullptr;
+    }
+    m_Base.clear();
+    m_Base.shrink_to_fit();
+
+    if (m_Failed) {
+        return false;
+    }
+    if (!m_FrameDone) {
+        return Fail("Patch is incomplete");
+    }
+    uint8_t Digest[SHA256_SIZE];
+    if (!BCRYPT_SUCCESS(BCryptFinishHash(m_Hash, Digest, sizeof(Digest), 0))) {
+        return Fail("Failed to hash output");
+    }
+    m_Sha256 = ToHex(Digest, sizeof(Digest));
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+struct ZSTD_DCtx_s;
+
+// Hex encoded SHA-256 of a file on disk
+bool ComputeFileSha256(const wchar_t* FilePath, std::string& Out);
+
+// Rebuilds a file from the copy we already have plus a zstd "patch-from" delta, made with:
+//   zstd -19 --long=27 --patch-from=<old file> <new file> -o <patch>
+// The patch is fed in chunks as it arrives, and the output is hashed as it's written,
+// so neither the patch nor the rebuilt file has to be held in memory.
+class DeltaPatch {
+public:
+    DeltaPatch();
+    DeltaPatch(const DeltaPatch&) = delete;
+    DeltaPatch& operator=(const DeltaPatch&) = delete;
+
+    ~DeltaPatch();
+
+    // Loads the file the patch was made from, and creates the output file.
+    bool Begin(const wchar_t* BasePath, const wchar_t* OutputPath);
+
+    // Decompresses the next chunk of the patch into the output file.
+    // Returns false if the patch is broken or doesn't match the base file; any further calls are ignored.
+    bool Write(const void* Data, size_t Size);
+
+    // Feeds a whole patch file through Write, one chunk at a time.
+    bool ApplyFile(const wchar_t* PatchPath);
+
+    // Closes the output file. Returns false unless the whole patch has been applied.
+    bool End();
+
+    // Hex encoded SHA-256 of the output; valid after End().
+    const std::string& GetSha256() const { return m_Sha256; }
+    uint64_t GetBytesWritten() const { return m_BytesWritten; }
+    const std::string& GetError() const { return m_Error; }
+
+private:
+    bool Fail(const char* Format, ...);
+    bool Flush(size_t Count);
+
+    ZSTD_DCtx_s* m_DCtx;
+    void* m_HashAlg;
+    void* m_Hash;
+    FILE* m_File;
+
+    std::vector<char> m_Base;
+    std::vector<char> m_OutBuffer;
+
+    uint64_t m_BytesWritten;
+    bool m_FrameDone;
+    bool m_Failed;
+
+    std::string m_Sha256;
+    std::string m_Error;
+};
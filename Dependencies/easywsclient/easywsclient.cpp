@@ -181,6 +181,8 @@ namespace { // private module-only namespace
         void close() {}
         void _dispatch(Callback& callable) {}
         readyStateValues getReadyState() const { return CLOSED; }
+        uintptr_t getSocket() const { return ~uintptr_t(0); }
+        bool hasPendingTx() const { return false; }
     };
 
 
@@ -237,6 +239,14 @@ namespace { // private module-only namespace
 
         readyStateValues getReadyState() const { return readyState; }
 
+        uintptr_t getSocket() const
+        {
+            // ptConnCtx is freed when the connection closes
+            return readyState == CLOSED ? ~uintptr_t(0) : (uintptr_t)ptConnCtx->sockfd;
+        }
+
+        bool hasPendingTx() const { return !txbuf.empty(); }
+
         void poll(int timeout)
         { // timeout in milliseconds
             if (readyState == CLOSED) {
@@ -8,6 +8,7 @@
 // wget https://raw.github.com/dhbaird/easywsclient/master/easywsclient.hpp
 // wget https://raw.github.com/dhbaird/easywsclient/master/easywsclient.cpp
 
+#include <cstdint>
 #include <string>
 #include <map>
 
@@ -31,6 +32,10 @@ class WebSocket {
     virtual void sendPing() = 0;
     virtual void close() = 0;
     virtual readyStateValues getReadyState() const = 0;
+    // Native socket handle, so several sockets can be waited on with one select(); ~0 once closed.
+    virtual uintptr_t getSocket() const = 0;
+    // True while sent data is still waiting for room in the socket's send buffer.
+    virtual bool hasPendingTx() const = 0;
     template<class Callable>
     void dispatch(Callable callable) { // N.B. this is compatible with both C++11 lambdas, functors and C function pointers
         struct _Callback : public Callback {
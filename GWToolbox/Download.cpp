@@ -1,5 +1,6 @@
 #include "stdafx.h"
 
+#include <DeltaPatch.h>
 #include <File.h>
 #include <Path.h>
 
@@ -11,7 +12,7 @@
 class AsyncFileDownloader : public AsyncRestClient {
 public:
     AsyncFileDownloader()
-        : m_DownloadLength{0} {}
+        : m_DownloadLength{0}, m_Patch{nullptr}, m_PatchFailed{false} {}
 
     AsyncFileDownloader(const AsyncFileDownloader&) = delete;
 
@@ -20,14 +21,33 @@ public:
         return m_DownloadLength.load(std::memory_order_relaxed);
     }
 
+    // Stream the content into patch instead of keeping it in memory; the transfer is aborted as soon as the patch turns out to be bad.
+    // patch must not be touched until the download has completed.
+    void SetPatch(DeltaPatch* patch)
+    {
+        m_Patch = patch;
+        SetAbortCallback([this] {
+            return m_PatchFailed.load(std::memory_order_relaxed);
+        });
+    }
+
 private: // From AsyncRestClient
     void OnContent(const char* bytes, const size_t count) override
     {
-        AsyncRestClient::OnContent(bytes, count);
+        if (m_Patch) {
+            if (!m_PatchFailed && !m_Patch->Write(bytes, count)) {
+                m_PatchFailed = true;
+            }
+        }
+        else {
+            AsyncRestClient::OnContent(bytes, count);
+        }
         m_DownloadLength += count;
     }
 
     std::atomic<size_t> m_DownloadLength;
+    DeltaPatch* m_Patch;
+    std::atomic<bool> m_PatchFailed;
 };
 
 bool Download(std::string& content, const char* url)
@@ -63,6 +83,8 @@ struct Asset {
     std::string name{};
     size_t size = 0;
     std::string browser_download_url{};
+    // Hex sha256, if github has one for this asset
+    std::string sha256{};
 };
 
 struct Release {
@@ -131,6 +153,15 @@ static bool ParseRelease(const std::string& json_text, Release* release)
         asset.size = it_size->get<size_t>();
         asset.browser_download_url = it_browser_download_url->get<std::string>();
 
+        // e.g. "sha256:abcd..."; older assets don't have one
+        auto it_digest = entry.find("digest");
+        if (it_digest != entry.end() && it_digest->is_string()) {
+            const auto digest = it_digest->get<std::string>();
+            if (digest.starts_with("sha256:")) {
+                asset.sha256 = digest.substr(7);
+            }
+        }
+
         release->assets.emplace_back(std::move(asset));
     }
 
@@ -170,6 +201,80 @@ std::string GetDllRelease(const std::filesystem::path& dllpath)
     return {buffer};
 }
 
+// Runs the download to completion, updating the progress bar as it goes.
+// Returns false if it failed, or if the user closed the window first.
+static bool RunDownload(DownloadWindow& window, AsyncFileDownloader& downloader, const std::string& url, const size_t file_size)
+{
+    AsyncDownload(url.c_str(), &downloader);
+
+    while (!window.ShouldClose()) {
+        window.PollMessages(16);
+
+        if (downloader.IsCompleted()) {
+            return downloader.IsSuccessful();
+        }
+        if (file_size) {
+            const size_t BytesDownloaded = downloader.GetDownloadCount();
+            const auto progress = std::min<size_t>(BytesDownloaded * 100 / file_size, 100);
+            window.SetProgress(progress);
+        }
+    }
+
+    if (downloader.IsPending()) {
+        downloader.Abort();
+    }
+    return false;
+}
+
+// If the release has a delta from the installed dll, rebuild the new dll from that instead of downloading all of it.
+// The result has to match the release's sha256; returns false if anything goes wrong, leaving the installed dll as it was.
+static bool TryDeltaUpdate(DownloadWindow& window, const std::filesystem::path& dllpath, const Release& release, const Asset& dll_asset)
+{
+    if (dll_asset.sha256.empty() || !std::filesystem::exists(dllpath)) {
+        return false;
+    }
+    std::string installed_sha256;
+    if (!ComputeFileSha256(dllpath.wstring().c_str(), installed_sha256)) {
+        return false;
+    }
+    // Patches are published as GWToolboxdll-<first 16 hex digits of the sha256 of the dll they apply to>.patch
+    const auto patch_name = std::format("GWToolboxdll-{}.patch", installed_sha256.substr(0, 16));
+    const auto patch_asset = std::ranges::find_if(release.assets, [&patch_name](const Asset& asset) {
+        return asset.name == patch_name;
+    });
+    if (patch_asset == release.assets.end() || patch_asset->browser_download_url.empty()) {
+        return false;
+    }
+
+    auto newpath = dllpath;
+    newpath += L".new";
+
+    DeltaPatch patch;
+    bool success = patch.Begin(dllpath.wstring().c_str(), newpath.wstring().c_str());
+    if (success) {
+        AsyncFileDownloader downloader;
+        downloader.SetPatch(&patch);
+        success = RunDownload(window, downloader, patch_asset->browser_download_url, patch_asset->size);
+    }
+    success = patch.End() && success;
+
+    if (success && _stricmp(patch.GetSha256().c_str(), dll_asset.sha256.c_str()) != 0) {
+        fprintf(stderr, "Patched dll has sha256 %s, expected %s\n", patch.GetSha256().c_str(), dll_asset.sha256.c_str());
+        success = false;
+    }
+    else if (!success && !patch.GetError().empty()) {
+        fprintf(stderr, "Failed to apply '%s': %s\n", patch_name.c_str(), patch.GetError().c_str());
+    }
+    if (success && !MoveFileExW(newpath.wstring().c_str(), dllpath.wstring().c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        fprintf(stderr, "MoveFileExW failed (%lu)\n", GetLastError());
+        success = false;
+    }
+    if (!success) {
+        DeleteFileW(newpath.wstring().c_str());
+    }
+    return success;
+}
+
 bool DownloadWindow::DownloadAllFiles(std::wstring& error)
 {
     std::filesystem::path dllpath = GetInstallationDir();
@@ -223,55 +328,42 @@ bool DownloadWindow::DownloadAllFiles(std::wstring& error)
         return error = L"Didn't find GWTooolboxdll.dll", false;
 
 
-    const auto& url = release_dll_asset->browser_download_url;
-    const auto& file_size = release_dll_asset->size;
-
     DownloadWindow window;
     window.Create();
     window.SetChangelog(release.body.c_str(), release.body.size());
 
-    AsyncFileDownloader downloader;
-    AsyncDownload(url.c_str(), &downloader);
-
-    while (!window.ShouldClose()) {
-        window.PollMessages(16);
-
-        if (!downloader.IsCompleted()) {
-            size_t BytesDownloaded = downloader.GetDownloadCount();
-            const auto progress = BytesDownloaded * 100 / file_size;
-            SendMessageW(window.m_hProgressBar, PBM_SETPOS, progress, 0);
+    if (!TryDeltaUpdate(window, dllpath, release, *release_dll_asset)) {
+        // The user could close the window, before the download is complete
+        if (window.ShouldClose()) {
+            return false;
         }
-        else {
-            if (!downloader.IsSuccessful()) {
-                // Convert error message to wstring
-                std::wstring url_w(url.begin(), url.end());
-                std::string status_str = downloader.GetStatusStr();
-                std::wstring status_w(status_str.begin(), status_str.end());
-                return error = std::format(L"Failed to download '{}'. (Status: {}, StatusCode: {})",
-                                           url_w, status_w, downloader.GetStatusCode()), false;
-            }
 
-            std::string& file_content = downloader.GetContent();
-            if (!WriteEntireFile(dllpath.wstring().c_str(), file_content.c_str(), file_content.size())) {
-                std::wstring dllpath_str = dllpath.wstring();
-                return error = std::format(L"WriteEntireFile failed on '{}' with {} bytes",
-                                           dllpath_str, file_content.size()), false;
-            }
+        const auto& url = release_dll_asset->browser_download_url;
 
-            downloader.Clear();
-            SendMessageW(window.m_hProgressBar, PBM_SETPOS, 100, 0);
-            SendMessageW(window.m_hWnd, WM_CLOSE, 0, 0);
+        AsyncFileDownloader downloader;
+        if (!RunDownload(window, downloader, url, release_dll_asset->size)) {
+            if (window.ShouldClose()) {
+                return false;
+            }
+            // Convert error message to wstring
+            std::wstring url_w(url.begin(), url.end());
+            std::string status_str = downloader.GetStatusStr();
+            std::wstring status_w(status_str.begin(), status_str.end());
+            return error = std::format(L"Failed to download '{}'. (Status: {}, StatusCode: {})",
+                                       url_w, status_w, downloader.GetStatusCode()), false;
         }
-    }
 
-    //
-    // The user could close the window, before the download is complete
-    //
-    if (downloader.IsPending()) {
-        downloader.Abort();
-        return false;
+        std::string& file_content = downloader.GetContent();
+        if (!WriteEntireFile(dllpath.wstring().c_str(), file_content.c_str(), file_content.size())) {
+            std::wstring dllpath_str = dllpath.wstring();
+            return error = std::format(L"WriteEntireFile failed on '{}' with {} bytes",
+                                       dllpath_str, file_content.size()), false;
+        }
+        downloader.Clear();
     }
 
+    window.SetProgress(100);
+    SendMessageW(window.m_hWnd, WM_CLOSE, 0, 0);
     return true;
 }
 
@@ -289,6 +381,11 @@ void DownloadWindow::SetChangelog(const char* str, const size_t length) const
     SendMessageW(m_hChangelog, WM_SETTEXT, 0, reinterpret_cast<LPARAM>(content.c_str()));
 }
 
+void DownloadWindow::SetProgress(const size_t percent) const
+{
+    SendMessageW(m_hProgressBar, PBM_SETPOS, percent, 0);
+}
+
 LRESULT DownloadWindow::WndProc(HWND hWnd, const UINT uMsg, const WPARAM wParam, const LPARAM lParam)
 {
     switch (uMsg) {
@@ -16,6 +16,7 @@ public:
     bool Create() override;
     static bool DownloadAllFiles(std::wstring& error);
     void SetChangelog(const char* str, size_t length) const;
+    void SetProgress(size_t percent) const;
 
 private:
     LRESULT WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam) override;
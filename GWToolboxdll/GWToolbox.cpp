@@ -33,6 +33,7 @@
 #include <Modules/InventoryManager.h>
 #include <Modules/ItemDescriptionHandler.h>
 #include <Modules/Updater.h>
+#include <Modules/WebSocketModule.h>
 #include <Windows/SettingsWindow.h>
 
 #include <Windows/MainWindow.h>
@@ -1117,6 +1118,7 @@ void GWToolbox::UpdateInitialising(float)
     Log::Log("Creating Modules\n");
     ToggleModule(CrashHandler::Instance());
     ToggleModule(Resources::Instance());
+    ToggleModule(WebSocketModule::Instance());
     ToggleModule(ToolboxTheme::Instance());
     ToggleModule(ItemDescriptionHandler::Instance());
     ToggleModule(ToolboxSettings::Instance());
@@ -20,6 +20,8 @@
 #include <Windows/FriendListWindow.h>
 
 #include <GWToolbox.h>
+#include <Utils/AhoCorasick.h>
+#include <Utils/RegexSet.h>
 #include <Utils/TextUtils.h>
 
 //#define PRINT_CHAT_PACKETS
@@ -83,13 +85,83 @@ namespace {
     constexpr uint32_t NOISE_REDUCTION_DELAY_MS = 1000;
 
     // Chat filter
-    std::vector<std::wstring> bycontent_words;
+    // Every word in one automaton over folded text, so checking a message costs the same however many words there are
+    AhoCorasick<wchar_t> bycontent_words;
     char bycontent_word_buf[FILTER_BUF_SIZE] = "";
     bool bycontent_filedirty = false;
 
-    std::vector<std::wregex> bycontent_regex;
+    RegexSet bycontent_regex;
     char bycontent_regex_buf[FILTER_BUF_SIZE] = "";
 
+    // Content verdicts for recently seen message text; trade and local spam is the same few messages over and over.
+    // Fixed size, evicted with the clock algorithm; cleared whenever the word or regex lists are parsed.
+    class VerdictCache {
+    public:
+        static constexpr size_t CAPACITY = 1024;
+
+        VerdictCache() { entries.reserve(CAPACITY); }
+
+        // Returns nullptr if text isn't cached
+        const bool* Find(const std::wstring_view text)
+        {
+            const auto found = index.find(text);
+            if (found == index.end()) {
+                misses++;
+                return nullptr;
+            }
+            hits++;
+            auto& entry = entries[found->second];
+            entry.referenced = true;
+            return &entry.verdict;
+        }
+
+        void Add(const std::wstring_view text, const bool verdict)
+        {
+            size_t slot;
+            if (entries.size() < CAPACITY) {
+                slot = entries.size();
+                entries.emplace_back();
+            }
+            else {
+                // Skip past anything used since the hand last came round
+                while (entries[hand].referenced) {
+                    entries[hand].referenced = false;
+                    hand = (hand + 1) % CAPACITY;
+                }
+                slot = hand;
+                hand = (hand + 1) % CAPACITY;
+                index.erase(entries[slot].text);
+            }
+            auto& entry = entries[slot];
+            entry.text = text;
+            entry.verdict = verdict;
+            entry.referenced = false;
+            index.emplace(entry.text, static_cast<uint32_t>(slot));
+        }
+
+        void Clear()
+        {
+            index.clear();
+            entries.clear();
+            hand = 0;
+        }
+
+        [[nodiscard]] size_t size() const { return entries.size(); }
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+
+    private:
+        struct Entry {
+            std::wstring text;
+            bool verdict = false;
+            bool referenced = false;
+        };
+        std::vector<Entry> entries; // Reserved up front, so the index's views into them stay valid
+        std::unordered_map<std::wstring_view, uint32_t> index;
+        size_t hand = 0;
+    };
+    VerdictCache verdict_cache;
+
 #ifdef EXTENDED_IGNORE_LIST
     bool messagebyauthor = false;
     std::set<std::string> byauthor_words;
@@ -163,25 +235,26 @@ namespace {
         return 0;
     }
 
-    void ParseBuffer(const char* text, std::vector<std::wstring>& words)
+    void ParseBuffer(const char* text, AhoCorasick<wchar_t>& words)
     {
         using namespace TextUtils;
-        words.clear();
-        const auto text_ws = RemoveDiacritics(ToLower(StringToWString(text)));
+        verdict_cache.Clear();
+        words.Clear();
+        auto text_ws = StringToWString(text);
+        Fold(text_ws, text_ws, FoldCase | FoldDiacritics);
         std::wstringstream stream(text_ws.c_str());
         std::wstring word;
         while (std::getline(stream, word)) {
-            if (word.empty()) {
-                continue;
-            }
-            words.push_back(word);
+            words.Add(word); // Blank lines are ignored
         }
+        words.Build();
     }
 
-    void ParseBuffer(const char* text, std::vector<std::wregex>& regex)
+    void ParseBuffer(const char* text, RegexSet& regex)
     {
         using namespace TextUtils;
-        regex.clear();
+        verdict_cache.Clear();
+        regex.Clear();
         const auto text_ws = RemoveDiacritics(StringToWString(text));
         std::wstringstream stream(text_ws.c_str());
         std::wstring word;
@@ -192,49 +265,37 @@ namespace {
             try {
                 const auto last_slash = word.rfind('/');
                 if (word.starts_with('/') && last_slash != std::wstring::npos && last_slash != 0) {
-                    const auto regex_str = word.substr(1, last_slash - 1);
-                    const auto flags = word.substr(last_slash + 1);
-                    auto regex_flags = std::regex_constants::optimize;
+                    const auto regex_str = std::wstring_view(word).substr(1, last_slash - 1);
+                    const auto flags = std::wstring_view(word).substr(last_slash + 1);
+                    uint8_t regex_flags = RegexSet::Default;
                     for (const auto chr : flags) {
                         switch (chr) {
                             case 'i':
-                                regex_flags |= std::regex_constants::icase;
+                                regex_flags |= RegexSet::IgnoreCase;
                                 break;
-                            case 'c':
-                                regex_flags |= std::regex_constants::collate;
-                                break;
-                            case 'n':
-                                regex_flags |= std::regex_constants::nosubs;
-                                break;
-                            case 's':
-                                regex_flags |= std::regex_constants::ECMAScript;
+                            case 'c': // collate
+                            case 'n': // nosubs
+                            case 's': // ECMAScript
+                                // Nothing to do; only whether there's a match is used, and ranges are by code point
                                 break;
                             case 'b':
-                                regex_flags |= std::regex_constants::basic;
-                                break;
                             case 'x':
-                                regex_flags |= std::regex_constants::extended;
-                                break;
                             case 'a':
-                                regex_flags |= std::regex_constants::awk;
-                                break;
                             case 'g':
-                                regex_flags |= std::regex_constants::grep;
-                                break;
                             case 'e':
-                                regex_flags |= std::regex_constants::egrep;
+                                Log::Warning("Regular expression '%s' asks for a POSIX grammar; only ECMAScript is supported", WStringToString(word).c_str());
                                 break;
                             default:
                                 break;
                         }
                     }
-                    regex.emplace_back(regex_str, regex_flags);
+                    regex.Add(regex_str, regex_flags);
                 }
                 else {
-                    regex.emplace_back(word, std::regex_constants::optimize);
+                    regex.Add(word);
                 }
             } catch (const std::regex_error&) {
-                Log::Warning("Cannot parse regular expression '%s'", word.c_str());
+                Log::Warning("Cannot parse regular expression '%s'", WStringToString(word).c_str());
             }
         }
     }
@@ -684,24 +745,27 @@ namespace {
             end = &message[i];
         }
 
-        using namespace TextUtils;
-        const auto str = std::wstring(start, end);
+        const std::wstring_view str(start, end);
         if (str.empty()) {
             return false;
         }
-        const auto sanitized = RemoveDiacritics(str);
-        const auto lowercase = ToLower(sanitized);
-        for (const auto& s : bycontent_words) {
-            if (lowercase.find(s) != std::wstring::npos) {
-                return true;
-            }
+        if (const auto cached = verdict_cache.Find(str)) {
+            return *cached;
         }
-        for (const auto& r : bycontent_regex) {
-            if (std::regex_search(sanitized, r)) {
+        const auto verdict = [str] {
+            // Folded as it's scanned, straight from the packet
+            if (bycontent_words.Contains(str, TextUtils::FoldForSearch)) {
                 return true;
             }
-        }
-        return false;
+            if (bycontent_regex.empty()) {
+                return false;
+            }
+            static std::wstring sanitized; // Reused between messages; only called from the game thread
+            TextUtils::Fold(str, sanitized, TextUtils::FoldDiacritics);
+            return bycontent_regex.Search(sanitized);
+        }();
+        verdict_cache.Add(str, verdict);
+        return verdict;
     }
 
     // Should this channel be checked for ignored messages?
@@ -880,6 +944,10 @@ void ChatFilter::LoadSettings(ToolboxIni* ini)
 
     LOAD_BOOL(block_messages_from_inactive_channels);
 
+    // Either file may be gone; nothing compiled from the previous load, or decided with it, should outlive this
+    verdict_cache.Clear();
+    bycontent_words.Clear();
+    bycontent_regex.Clear();
     strcpy_s(bycontent_word_buf, "");
     strcpy_s(bycontent_regex_buf, "");
 
@@ -1136,22 +1204,16 @@ void ChatFilter::DrawSettingsInternal()
     ImGui::ShowHelp("Regular expressions allow you to specify wildcards and express more.\n"
         "The default syntax is described at www.cplusplus.com/reference/regex/ECMAScript\n"
         "If you wish to only block if the entire message is matched, use the ^...$ syntax (^ for start, $ for end).\n"
-        "You can apply flags to your regexes by using the form /^...$/ics\n"
-        "i (icase) for case-insensitive\n"
-        "c (collate) for locale sensitive character ranges\n"
-        "n (nosubs) for non marking sub expressions\n"
-        "s (ECMAScript) for modified ECMAScript syntax (default)\n"
-        "b (basic) for BASIC regex syntax\n"
-        "x (extended) for extended POSIX regex syntax\n"
-        "a (awk) for awk grep syntax\n"
-        "g (grep) for grep syntax\n"
-        "e (egrep) for egrep synax\n"
-        "You must supply at most one syntax flag.\n"
-        "See https://en.cppreference.com/w/cpp/regex/syntax_option_type for further documentation.");
+        "You can make a regex case-insensitive by using the form /^...$/i\n"
+        "Backreferences (\\1) and lookaheads ((?=...), (?!...)) aren't supported; they can make a filter take too long on some messages.");
     if (ImGui::InputTextMultiline("##bycontentfilter_regex", bycontent_regex_buf,
                                   FILTER_BUF_SIZE, ImVec2(-1.0f, 0.0))) {
         timer_parse_regexes = GetTickCount() + NOISE_REDUCTION_DELAY_MS;
     }
+    if (const auto lookups = verdict_cache.hits + verdict_cache.misses) {
+        ImGui::TextDisabled("Repeated messages: %.1f%% of %llu checks answered from cache (%zu cached)",
+                            100.0 * verdict_cache.hits / lookups, lookups, verdict_cache.size());
+    }
     ImGui::Unindent();
 
 #ifdef EXTENDED_IGNORE_LIST
@@ -21,6 +21,7 @@
 
 #include <Modules/ChatSettings.h>
 #include <Modules/Obfuscator.h>
+#include <Utils/AhoCorasick.h>
 #include <Utils/GuiUtils.h>
 #include <Windows/FriendListWindow.h>
 
@@ -264,6 +265,80 @@ namespace {
     // Current position in the list of obfuscated names
     size_t pool_index = 0;
 
+    // Rewrites every name in one of the maps above into its mapped name, in a single pass over the message.
+    // The automaton is only rebuilt when names have been added since the last message.
+    class NameReplacer {
+    public:
+        explicit NameReplacer(const std::map<std::wstring, std::wstring>& _names)
+            : names(_names) {}
+
+        void Invalidate() { dirty = true; }
+
+        // Returns false, leaving out untouched, if there are no names in message
+        bool Replace(const std::wstring_view message, std::wstring& out)
+        {
+            if (dirty) {
+                Rebuild();
+            }
+            occurrences.clear();
+            automaton.Scan(message, [this](const uint32_t id, const size_t end) {
+                occurrences.push_back({end - automaton.PatternLength(id), end, id});
+                return true;
+            });
+            if (occurrences.empty()) {
+                return false;
+            }
+            // Leftmost first, then longest; overlapping names after that are skipped
+            std::ranges::sort(occurrences, [](const Occurrence& a, const Occurrence& b) {
+                return a.start != b.start ? a.start < b.start : a.end > b.end;
+            });
+            rewritten.clear();
+            size_t written = 0;
+            for (const auto& [start, end, id] : occurrences) {
+                if (start < written) {
+                    continue;
+                }
+                rewritten.append(message.substr(written, start - written));
+                rewritten.append(replacements[id]);
+                written = end;
+            }
+            rewritten.append(message.substr(written));
+            // message may point into out
+            out.assign(rewritten);
+            return true;
+        }
+
+    private:
+        struct Occurrence {
+            size_t start;
+            size_t end;
+            uint32_t id;
+        };
+
+        void Rebuild()
+        {
+            automaton.Clear();
+            replacements.clear();
+            for (const auto& [from, to] : names) {
+                if (automaton.Add(from) == replacements.size()) {
+                    replacements.push_back(to);
+                }
+            }
+            automaton.Build();
+            dirty = false;
+        }
+
+        const std::map<std::wstring, std::wstring>& names;
+        AhoCorasick<wchar_t> automaton;
+        std::vector<std::wstring> replacements; // By pattern id
+        std::vector<Occurrence> occurrences;
+        std::wstring rewritten;
+        bool dirty = true;
+    };
+
+    NameReplacer obfuscator(obfuscated_by_original);
+    NameReplacer unobfuscator(obfuscated_by_obfuscation);
+
     // Current state
     enum class ObfuscatorState : uint8_t {
         Disabled,
@@ -353,6 +428,8 @@ namespace {
         if (!obfuscated_by_original.contains(original_name)) {
             obfuscated_by_obfuscation.emplace(tmp_out, original_name);
             obfuscated_by_original.emplace(original_name, tmp_out);
+            obfuscator.Invalidate();
+            unobfuscator.Invalidate();
             out.assign(tmp_out);
             return true;
         }
@@ -377,22 +454,7 @@ namespace {
     {
         if (!wcschr(message.data(),0x107))
             return false; // Message contains no player names
-        std::wstring replacemsg{message};
-        const auto& to_search = obfuscate ? obfuscated_by_original : obfuscated_by_obfuscation;
-        bool was_changed = false;
-        for (const auto& [from, to] : to_search) {
-            if (from.empty()) {
-                break;
-            }
-            size_t start_pos = 0;
-            while ((start_pos = replacemsg.find(from, start_pos)) != std::string::npos) {
-                replacemsg.replace(start_pos, from.length(), to);
-                start_pos += to.length(); // In case 'to' contains 'from', like replacing 'x' with 'yx'
-                was_changed = true;
-            }
-        }
-        out.assign(replacemsg);
-        return !out.empty() && was_changed;
+        return (obfuscate ? obfuscator : unobfuscator).Replace(message, out);
     }
 
     bool UnobfuscateMessage(const wchar_t* message, std::wstring& out)
@@ -545,6 +607,8 @@ namespace {
         pool_index = 0;
         obfuscated_by_obfuscation.clear();
         obfuscated_by_original.clear();
+        obfuscator.Invalidate();
+        unobfuscator.Invalidate();
         // Don't use clear() on this; the game uses the pointer so we don't want to mess with it
         account_info_obfuscated_name[0] = '\0';
         // Don't use clear() on this; the game uses the pointer so we don't want to mess with it
@@ -1,7 +1,5 @@
 #include "stdafx.h"
 
-#include <queue>
-
 #include <GWCA/Context/CharContext.h>
 #include <GWCA/Context/PartyContext.h>
 
@@ -20,11 +18,11 @@
 #include <Modules/PartyBroadcastModule.h>
 #include <Modules/Resources.h>
 #include <Modules/Updater.h>
+#include <Modules/WebSocketModule.h>
 
 #include <Utils/GuiUtils.h>
 #include <Utils/TextUtils.h>
 
-#include <easywsclient/easywsclient.hpp>
 #include <nlohmann/json.hpp>
 
 #include <Defines.h>
@@ -49,18 +47,15 @@ namespace {
     clock_t need_to_send_party_searches = 0;
     clock_t failed_to_send_ts = 0;
 
-    WSAData wsaData = {0};
-
     static constexpr uint32_t COST_PER_CONNECTION_MS = 30 * 1000;
     static constexpr uint32_t COST_PER_CONNECTION_MAX_MS = 60 * 1000;
+    // Changes arriving within this long of the first pending change are sent together in one frame
+    static constexpr clock_t COALESCE_WINDOW_MS = 250;
+    static constexpr clock_t STATS_WINDOW_MS = 60 * 1000;
 
     RateLimiter window_rate_limiter;
-    easywsclient::WebSocket* ws = nullptr;
+    WebSocketConnection party_socket;
     const char* websocket_url = "wss://party.gwtoolbox.com";
-    std::queue<std::string> websocket_send_queue;
-    std::recursive_mutex websocket_mutex;
-    std::thread* websocket_thread = nullptr;
-    bool pending_websocket_disconnect = false;
     bool terminating = false;
 
     struct MapDistrictInfo {
@@ -68,6 +63,8 @@ namespace {
         GW::Constants::ServerRegion region = (GW::Constants::ServerRegion)0;
         GW::Constants::Language language = (GW::Constants::Language)0;
         int district_number = 0;
+
+        bool operator==(const MapDistrictInfo&) const = default;
     };
 
     MapDistrictInfo GetDistrictInfo()
@@ -88,11 +85,25 @@ namespace {
         uint8_t level = 0;
         std::string message;
         std::string sender;
+
+        bool operator==(const PartySearchAdvertisement&) const = default;
     };
+    // What the server has been sent on this connection. The socket is ordered and reliable, so every earlier frame has been applied by the time the next one arrives;
+    // the baseline only goes stale when the connection drops, or when the server asks for a resync.
     std::map<uint32_t, PartySearchAdvertisement> server_parties;
     MapDistrictInfo last_sent_district_info;
 
+    // Set once the server says hello with delta support; until then only whole party entries are sent, as older servers expect
+    std::atomic_bool delta_protocol = false;
+    // Sequence number of the last frame sent in delta mode, so the server can spot a frame it missed and ask for a resync
+    uint32_t sent_seq = 0;
+
+    std::mutex stats_mutex;
+    PartyBroadcast::Stats stats;
+    std::deque<std::pair<clock_t, size_t>> recent_sends; // timestamp, bytes
+
     bool send_payload(const std::string& payload);
+    void disconnect_ws();
 
     void to_json(nlohmann::json& j, const PartySearchAdvertisement& p)
     {
@@ -117,6 +128,35 @@ namespace {
         if (p.level != 20) j["l"] = p.level;
     }
 
+    // Only the fields that differ from what the server already has for this party; absent keys are unchanged, so defaults are sent explicitly.
+    void to_json_delta(nlohmann::json& j, const PartySearchAdvertisement& prev, const PartySearchAdvertisement& p)
+    {
+        j = nlohmann::json{{"i", p.party_id}};
+        if (p.search_type != prev.search_type) j["t"] = p.search_type;
+        if (p.primary != prev.primary) j["p"] = p.primary;
+        if (p.sender != prev.sender) j["s"] = p.sender;
+        if (p.party_size != prev.party_size) j["ps"] = p.party_size;
+        if (p.hero_count != prev.hero_count) j["hc"] = p.hero_count;
+        if (p.hardmode != prev.hardmode) j["hm"] = p.hardmode;
+        if (p.language != prev.language) j["dl"] = p.language;
+        if (p.secondary != prev.secondary) j["sc"] = p.secondary;
+        if (p.district_number != prev.district_number) j["dn"] = p.district_number;
+        if (p.message != prev.message) j["ms"] = p.message;
+        if (p.level != prev.level) j["l"] = p.level;
+    }
+
+    void record_sent(const size_t bytes, const bool full)
+    {
+        std::lock_guard lock(stats_mutex);
+        stats.messages_sent++;
+        stats.bytes_sent += bytes;
+        if (full) stats.full_updates++;
+        recent_sends.emplace_back(TIMER_INIT(), bytes);
+        while (TIMER_DIFF(recent_sends.front().first) > STATS_WINDOW_MS) {
+            recent_sends.pop_front();
+        }
+    }
+
     bool get_api_key(std::string& out)
     {
         GWToolboxRelease current_release;
@@ -128,11 +168,6 @@ namespace {
         return true;
     }
 
-    bool is_websocket_ready()
-    {
-        return ws && ws->getReadyState() == easywsclient::WebSocket::readyStateValues::OPEN;
-    }
-
     bool get_uuid(std::string& out)
     {
         const auto account_uuid = GW::AccountMgr::GetPortalAccountUuid();
@@ -212,7 +247,7 @@ namespace {
 
         auto parties = collect_party_searches();
         if (parties.empty()) {
-            pending_websocket_disconnect = true;
+            disconnect_ws();
             return true;
         }
 
@@ -221,9 +256,14 @@ namespace {
         j["map_id"] = (uint32_t)GW::Map::GetMapID();
         j["district_region"] = (int)GW::Map::GetRegion();
         j["parties"] = parties;
+        if (delta_protocol) {
+            j["seq"] = sent_seq + 1;
+        }
 
         const auto payload = j.dump();
         if (!send_payload(payload)) return false;
+        if (delta_protocol) sent_seq++;
+        record_sent(payload.size(), true);
         last_sent_district_info = GetDistrictInfo();
 
         server_parties.clear();
@@ -241,12 +281,11 @@ namespace {
         }
         auto parties = collect_party_searches();
         if (parties.empty()) {
-            pending_websocket_disconnect = true;
+            disconnect_ws();
             return true;
         }
 
-        const auto current_map_info = GetDistrictInfo();
-        if (memcmp(&current_map_info, &last_sent_district_info, sizeof(current_map_info)) != 0) {
+        if (GetDistrictInfo() != last_sent_district_info) {
             // Map has changed since last attempt; send full list
             return send_all_party_searches();
         }
@@ -255,7 +294,7 @@ namespace {
 
         for (auto& existing_party : parties) {
             const auto found = server_parties.find(existing_party.party_id);
-            if (found != server_parties.end() && memcmp(&existing_party, &found->second, sizeof(existing_party)) == 0) {
+            if (found != server_parties.end() && existing_party == found->second) {
                 continue; // No change, don't send
             }
             to_send.push_back(existing_party);
@@ -277,13 +316,29 @@ namespace {
 
         if (to_send.empty()) return true; // No change
         json j;
-        j["type"] = "updated_parties";
+        j["type"] = delta_protocol ? "party_delta" : "updated_parties";
         j["map_id"] = (uint32_t)GW::Map::GetMapID();
         j["district_region"] = (int)GW::Map::GetRegion();
-        j["parties"] = to_send;
+        if (delta_protocol) {
+            j["seq"] = sent_seq + 1;
+            auto& entries = j["parties"] = json::array();
+            for (const auto& party : to_send) {
+                const auto prev = server_parties.find(party.party_id);
+                if (prev == server_parties.end() || !prev->second.party_size || !party.party_size) {
+                    entries.push_back(party); // New, re-added or removed; whole entry
+                    continue;
+                }
+                to_json_delta(entries.emplace_back(), prev->second, party);
+            }
+        }
+        else {
+            j["parties"] = to_send;
+        }
 
         const auto payload = j.dump();
         if (!send_payload(payload)) return false;
+        if (delta_protocol) sent_seq++;
+        record_sent(payload.size(), false);
         last_sent_district_info = GetDistrictInfo();
         for (auto& party : to_send) {
             server_parties[party.party_id] = party;
@@ -292,90 +347,69 @@ namespace {
         return true;
     }
 
+    // Forget what the server has, so the next update sends the full list
+    void reset_server_state()
+    {
+        server_parties.clear();
+        last_sent_district_info = {};
+        sent_seq = 0;
+        need_to_send_party_searches = TIMER_INIT();
+    }
+
     void on_websocket_closed()
     {
-        std::lock_guard<std::recursive_mutex> lk(websocket_mutex);
-        while (!websocket_send_queue.empty())
-            websocket_send_queue.pop();
         last_update_content = "";
         last_update_timestamp = 0;
-        server_parties.clear();
-        need_to_send_party_searches = TIMER_INIT();
-        memset(&last_sent_district_info, 0, sizeof(last_sent_district_info));
+        delta_protocol = false;
+        reset_server_state();
         Log::Log("Websocket disconnected");
     }
 
-    void disconnect_ws()
+    void on_websocket_message(const std::string& message)
     {
-        if (!ws) return;
-        ws->close();
-        ws->poll();
-        delete ws;
-        ws = nullptr;
-        on_websocket_closed();
+        const auto j = json::parse(message, nullptr, false);
+        if (j.is_discarded() || !j.is_object()) return;
+        const auto type = j.value("type", std::string());
+        if (type == "hello") {
+            // The full list was sent before the server said it understands deltas; send it again with a sequence number to start from
+            delta_protocol = j.value("delta", 0) == 1;
+            if (delta_protocol) reset_server_state();
+        }
+        else if (type == "resync") {
+            Log::Log("Party broadcast server asked for a resync at seq %u", sent_seq);
+            reset_server_state();
+        }
     }
 
-    void on_websocket_message(const std::string&)
+    void disconnect_ws()
     {
-        // Log::Log("Websocket message\n%s", message.c_str());
+        if (party_socket.IsClosed()) return;
+        party_socket.Close();
+        on_websocket_closed();
+        window_rate_limiter = RateLimiter(); // Graceful disconnect, reset limiter
     }
 
-    void websocket_thread_loop()
+    bool connect_ws()
     {
-        while (!pending_websocket_disconnect) {
-            if (ws) {
-                switch (ws->getReadyState()) {
-                    case easywsclient::WebSocket::CONNECTING:
-                    case easywsclient::WebSocket::CLOSING:
-                    case easywsclient::WebSocket::OPEN: {
-                        ws->poll();
-                        ws->dispatch(on_websocket_message);
-                    } break;
-                    case easywsclient::WebSocket::CLOSED: {
-                        delete ws;
-                        ws = nullptr;
-                        on_websocket_closed();
-                    } break;
-                }
-            }
-            if (!(ws || websocket_send_queue.empty())) {
-                // Connect to websocket
-                if (!window_rate_limiter.AddTime(COST_PER_CONNECTION_MS, COST_PER_CONNECTION_MAX_MS)) goto endloop;
-                if (!get_api_key(api_key)) goto endloop;
-                std::string uuid;
-                if (!get_uuid(uuid)) goto endloop;
+        if (!window_rate_limiter.AddTime(COST_PER_CONNECTION_MS, COST_PER_CONNECTION_MAX_MS)) return false;
+        if (!get_api_key(api_key)) return false;
+        std::string uuid;
+        if (!get_uuid(uuid)) return false;
 
-                easywsclient::HeaderKeyValuePair headers = {{"User-Agent", "GWToolboxpp"}, {"X-Api-Key", api_key}, {"X-Account-Uuid", uuid}, {"X-Bot-Version", "101"}};
-                Log::Log("Connecting to %s (X-Api-Key: %s, X-Account-Uuid: %s)", websocket_url, headers["X-Api-Key"].c_str(), headers["X-Account-Uuid"].c_str());
+        easywsclient::HeaderKeyValuePair headers = {{"User-Agent", "GWToolboxpp"}, {"X-Api-Key", api_key}, {"X-Account-Uuid", uuid}, {"X-Bot-Version", "101"}, {"X-Party-Delta", "1"}};
+        Log::Log("Connecting to %s (X-Api-Key: %s, X-Account-Uuid: %s)", websocket_url, headers["X-Api-Key"].c_str(), headers["X-Account-Uuid"].c_str());
 
-                ws = easywsclient::WebSocket::from_url(websocket_url, headers);
-            }
-            while (ws && !websocket_send_queue.empty()) {
-                std::string cpy;
-                {
-                    std::lock_guard<std::recursive_mutex> lk(websocket_mutex);
-                    if (websocket_send_queue.empty()) break;
-                    cpy = std::move(websocket_send_queue.front());
-                    websocket_send_queue.pop();
-                }
-                ws->send(cpy);
-            }
-
-        endloop:
-            std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        }
-        disconnect_ws();
+        // Dropped connections are re-established by the websocket module; anything queued is dropped with them, so resend everything
+        party_socket.Open(websocket_url, {.on_message = on_websocket_message, .on_close = [](bool) { on_websocket_closed(); }}, std::move(headers));
+        return true;
     }
 
-    // Run on worker thread!
+    // Run on game thread!
     bool send_payload(const std::string& payload)
     {
-        if (pending_websocket_disconnect) return false;
-        if (!websocket_thread) {
-            websocket_thread = new std::thread(websocket_thread_loop);
-        }
-        std::lock_guard<std::recursive_mutex> lk(websocket_mutex);
-        websocket_send_queue.push(payload);
+        if (terminating) return false;
+        if (party_socket.IsClosed() && !connect_ws()) return false;
+        party_socket.Send(payload);
         return true;
     }
 
@@ -383,55 +417,39 @@ namespace {
 
     void OnUIMessage(GW::HookStatus*, GW::UI::UIMessage, void*, void*)
     {
-        need_to_send_party_searches = TIMER_INIT();
+        // Don't push the deadline back; a busy district would otherwise never go quiet long enough to send
+        if (!need_to_send_party_searches) {
+            need_to_send_party_searches = TIMER_INIT();
+        }
     }
 } // namespace
 
 void PartyBroadcast::Update(float)
 {
-    if (pending_websocket_disconnect) {
-        if (websocket_thread) {
-            ASSERT(websocket_thread->joinable());
-            websocket_thread->join();
-            delete websocket_thread;
-            websocket_thread = nullptr;
-        }
-        pending_websocket_disconnect = false;
-        window_rate_limiter = RateLimiter(); // Graceful disconnect, reset limiter
-    }
     if (terminating) return;
 
     if (!(ToolboxSettings::send_anonymous_gameplay_info && GW::Map::GetInstanceType() == GW::Constants::InstanceType::Outpost)) {
-        pending_websocket_disconnect |= websocket_thread != nullptr;
+        disconnect_ws();
         return;
     }
 
-    if (need_to_send_party_searches && TIMER_DIFF(need_to_send_party_searches) > 250 && send_changed_party_searches()) {
+    if (need_to_send_party_searches && TIMER_DIFF(need_to_send_party_searches) > COALESCE_WINDOW_MS && send_changed_party_searches()) {
         need_to_send_party_searches = 0;
     }
 }
 
-bool PartyBroadcast::CanTerminate()
-{
-    return !websocket_thread;
-}
-
 void PartyBroadcast::SignalTerminate()
 {
     GW::UI::RemoveUIMessageCallback(&OnUIMessage_Hook);
     GW::StoC::RemoveCallbacks(&OnUIMessage_Hook);
     terminating = true;
-    pending_websocket_disconnect = true;
+    disconnect_ws();
 }
 
 void PartyBroadcast::Initialize()
 {
     ToolboxModule::Initialize();
-    int res;
-    if (!wsaData.wVersion && (res = WSAStartup(MAKEWORD(2, 2), &wsaData)) != 0) {
-        return; // WSAStartup failed
-    }
-    pending_websocket_disconnect = terminating = false;
+    terminating = false;
 
     need_to_send_party_searches = TIMER_INIT();
 
@@ -452,9 +470,18 @@ void PartyBroadcast::Terminate()
 {
     ToolboxModule::Terminate();
     GW::UI::RemoveUIMessageCallback(&OnUIMessage_Hook);
-    if (wsaData.wVersion) {
-        WSACleanup();
-        wsaData = {0};
+    disconnect_ws();
+}
+
+PartyBroadcast::Stats PartyBroadcast::GetStats()
+{
+    std::lock_guard lock(stats_mutex);
+    auto out = stats;
+    out.delta_protocol = delta_protocol;
+    for (const auto& [timestamp, bytes] : recent_sends) {
+        if (TIMER_DIFF(timestamp) > STATS_WINDOW_MS) continue;
+        out.messages_last_minute++;
+        out.bytes_last_minute += bytes;
     }
-    ASSERT(!websocket_thread);
+    return out;
 }
@@ -22,7 +22,16 @@ public:
     void Initialize() override;
     void Terminate() override;
     void SignalTerminate() override;
-    bool CanTerminate() override;
     void Update(float) override;
     bool HasSettings() override { return false; }
+
+    struct Stats {
+        bool delta_protocol = false; // Server accepted field-level deltas
+        uint64_t messages_sent = 0;
+        uint64_t bytes_sent = 0;
+        uint64_t full_updates = 0;
+        size_t messages_last_minute = 0;
+        size_t bytes_last_minute = 0;
+    };
+    static Stats GetStats();
 };
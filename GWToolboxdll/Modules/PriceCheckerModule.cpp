@@ -612,7 +612,7 @@ const std::unordered_map<std::string,uint32_t>& PriceCheckerModule::FetchPrices(
         Resources::Download(trader_quotes_url, [](bool success, const std::string& response, void*) {
             if (success)
                 ParsePriceJson(response);
-            });
+            }, nullptr, std::chrono::seconds(request_interval / CLOCKS_PER_SEC), WorkerPriority::Bulk);
     }
     return prices_by_identifier;
 }
@@ -22,6 +22,8 @@
 
 #include <GWCA/Constants/Constants.h>
 #include <Modules/Resources.h>
+#include <Utils/AsyncTask.h>
+#include <Utils/DecodedStrings.h>
 #include <Utils/GuiUtils.h>
 
 #pragma warning(push) // Save current warning state
@@ -32,6 +34,7 @@
 #pragma warning(pop)
 #include <dxgiformat.h>
 #include <wolfssl/wolfcrypt/asn.h>
+#include <wolfssl/wolfcrypt/sha256.h>
 
 #include <Modules/GwDatTextureModule.h>
 #include <Constants/EncStrings.h>
@@ -134,26 +137,32 @@ namespace {
     std::map<GW::Constants::MapID, GuiUtils::EncString*> region_names;
     std::unordered_map<GW::Constants::Language, std::unordered_map<uint32_t, GuiUtils::EncString*>> encoded_string_ids;
     std::filesystem::path current_settings_folder;
-    constexpr size_t MAX_WORKERS = 20;
+    // Number of worker threads reserved for each WorkerPriority lane. Workers also serve any higher priority lane, so
+    // interactive jobs can use every thread, but bulk jobs can never starve the interactive ones.
+    constexpr std::array<size_t, std::to_underlying(WorkerPriority::Count)> WORKERS_PER_LANE = {4, 12, 4};
+    // Largest decoded body we'll hold in memory for a single download
+    constexpr size_t MAX_DOWNLOAD_SIZE_IN_MEMORY = 32 * 1024 * 1024;
     const wchar_t* GUILD_WARS_WIKI_FILES_PATH = L"img\\gww_files";
     const wchar_t* SKILL_IMAGES_PATH = L"img\\skills";
     const wchar_t* ITEM_IMAGES_PATH = L"img\\items";
     const wchar_t* PROF_ICONS_PATH = L"img\\professions";
     const wchar_t* DMGTYPE_ICONS_PATH = L"img\\damagetypes";
+    const wchar_t* DECODED_STRINGS_PATH = L"decoded_strings.dat";
 
-    std::recursive_mutex worker_mutex;
     std::recursive_mutex main_mutex;
     std::recursive_mutex dx_mutex;
 
-    // tasks to be done async by the worker thread
-    std::queue<std::function<void()>> thread_jobs;
     // tasks to be done in the render thread
     std::queue<std::function<void(IDirect3DDevice9*)>> dx_jobs;
     // tasks to be done in main thread
     std::queue<std::function<void()>> main_jobs;
 
     IDirect3DTexture9* empty_texture_ptr = nullptr;
-    bool should_stop = false;
+    std::atomic<bool> should_stop = false;
+    // Lane of the job this worker thread is running; requests made from other threads count as Background
+    thread_local WorkerPriority current_worker_priority = WorkerPriority::Background;
+    // Only worker threads wait for a host to take their request; anything else is refused rather than stalled
+    thread_local bool is_worker_thread = false;
 
     // snprintf error message, pass to callback as a failure. Used internally.
     void trigger_failure_callback(const std::function<void(bool, const std::wstring&)>& callback, const wchar_t* format, ...)
@@ -182,66 +191,1235 @@ namespace {
         }
     }
 
+    // Blocking multi-lane job queue for the worker threads; idle workers sleep on a condition variable until work arrives
+    class WorkerQueue {
+        using Clock = std::chrono::steady_clock;
+        static constexpr size_t lane_count = std::to_underlying(WorkerPriority::Count);
+
+    public:
+        struct Job {
+            Resources::WorkerTask task;
+            Clock::time_point enqueued_at;
+            size_t lane = 0;
+        };
+
+        void Push(Resources::WorkerTask&& task, const WorkerPriority priority)
+        {
+            const auto lane = std::to_underlying(priority);
+            ASSERT(lane < lane_count);
+            std::array<bool, lane_count> to_wake{};
+            {
+                std::lock_guard lock(mutex);
+                lanes[lane].push_back({std::move(task), Clock::now(), lane});
+                stats[lane].enqueued++;
+                // Any worker whose home lane is at or below this priority can take the job
+                for (size_t home = lane; home < lane_count; home++) {
+                    to_wake[home] = idle[home] > 0;
+                }
+            }
+            for (size_t home = lane; home < lane_count; home++) {
+                if (to_wake[home]) {
+                    wakeup[home].notify_one();
+                }
+            }
+        }
+
+        // Blocks until a job is available for a worker serving home_lane, or until Stop() is called.
+        bool Pop(const size_t home_lane, Job& out)
+        {
+            std::unique_lock lock(mutex);
+            while (!stopping) {
+                for (size_t lane = 0; lane <= home_lane; lane++) {
+                    if (lanes[lane].empty()) {
+                        continue;
+                    }
+                    out = std::move(lanes[lane].front());
+                    lanes[lane].pop_front();
+                    const auto waited = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - out.enqueued_at).count());
+                    stats[lane].total_wait_us += waited;
+                    stats[lane].max_wait_us = std::max(stats[lane].max_wait_us, waited);
+                    return true;
+                }
+                idle[home_lane]++;
+                wakeup[home_lane].wait(lock);
+                idle[home_lane]--;
+            }
+            return false;
+        }
+
+        void Completed(const Job& job, const Clock::duration run_time)
+        {
+            std::lock_guard lock(mutex);
+            stats[job.lane].completed++;
+            stats[job.lane].total_run_us += static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(run_time).count());
+        }
+
+        // Jobs still queued are dropped, so they don't run in the next session. Call this while the request scheduler is still
+        // alive: a dropped job can hold an admission, which is released back to it.
+        void Stop()
+        {
+            std::array<std::deque<Job>, lane_count> dropped;
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+                dropped.swap(lanes);
+            }
+            for (auto& cv : wakeup) {
+                cv.notify_all();
+            }
+            // dropped is destroyed here, out of the lock, as releasing an admission can push more jobs
+        }
+
+        void Reset()
+        {
+            std::array<std::deque<Job>, lane_count> dropped; // Anything pushed since Stop(), as above
+            std::lock_guard lock(mutex);
+            stopping = false;
+            dropped.swap(lanes);
+        }
+
+        [[nodiscard]] Resources::WorkerQueueStats GetStats(const size_t lane)
+        {
+            std::lock_guard lock(mutex);
+            auto out = stats[lane];
+            out.queued = lanes[lane].size();
+            out.workers = WORKERS_PER_LANE[lane];
+            return out;
+        }
+
+    private:
+        std::mutex mutex;
+        std::array<std::deque<Job>, lane_count> lanes;
+        // Indexed by the home lane of the waiting worker
+        std::array<std::condition_variable, lane_count> wakeup;
+        std::array<size_t, lane_count> idle{};
+        std::array<Resources::WorkerQueueStats, lane_count> stats{};
+        bool stopping = false;
+    };
+
+    // Defined after request_scheduler, so it's destroyed first; see Stop()
+    extern WorkerQueue worker_queue;
+
     class WorkerThread {
     public:
-        bool is_running = false;
-        std::jthread thread;
+        std::atomic<bool> is_running = false;
+        std::jthread thread;
+
+        explicit WorkerThread(const size_t home_lane)
+        {
+            ASSERT(!is_running);
+            is_running = true;
+            thread = std::jthread([this, home_lane] {
+                is_worker_thread = true;
+                WorkerQueue::Job job;
+                while (!should_stop && worker_queue.Pop(home_lane, job)) {
+                    const auto started = std::chrono::steady_clock::now();
+                    current_worker_priority = static_cast<WorkerPriority>(job.lane);
+                    job.task();
+                    job.task = nullptr;
+                    worker_queue.Completed(job, std::chrono::steady_clock::now() - started);
+                }
+                is_running = false;
+            });
+        }
+
+        ~WorkerThread()
+        {
+            ASSERT(!is_running);
+        }
+    };
+
+    std::vector<WorkerThread*> workers;
+
+    void InitRestClient(RestClient* r)
+    {
+        char user_agent_str[32];
+        ASSERT(snprintf(user_agent_str, sizeof(user_agent_str), "GWToolboxpp/%s", GWTOOLBOXDLL_VERSION) != -1);
+        r->SetUserAgent(user_agent_str);
+        r->SetFollowLocation(true);
+        r->SetVerifyPeer(false); // idc about mitm or out of date certs
+        r->SetMethod(HttpMethod::Get);
+        r->SetVerifyHost(false);
+        r->SetConnectTimeoutSec(5);
+        r->SetTimeoutSec(10);
+        r->SetAcceptEncoding(""); // gzip/deflate/br, whatever curl supports
+    }
+
+    const std::string HashStr(const std::string& str)
+    {
+        const auto bytes_to_hash = std::vector<byte>(str.begin(), str.end());
+        auto hash = std::vector<byte>(WC_SHA256_DIGEST_SIZE);
+        wc_Sha256Hash(bytes_to_hash.data(), bytes_to_hash.size(), hash.data());
+        std::stringstream hexstream;
+        hexstream << std::hex << std::setfill('0');
+        for (auto b : hash) {
+            hexstream << std::setw(2) << static_cast<unsigned>(b);
+        }
+        return hexstream.str();
+    };
+
+    std::string RemoveProtocol(const std::string& url)
+    {
+        for (const auto prefix : {"http://", "https://"}) {
+            if (url.starts_with(prefix)) {
+                return url.substr(strlen(prefix));
+            }
+        }
+        return url;
+    }
+
+    // Returns the value of a header from the final response in a curl header blob; redirects each add their own block.
+    std::string GetResponseHeader(const std::string& headers, const std::string_view name)
+    {
+        std::string value;
+        size_t pos = 0;
+        while (pos < headers.size()) {
+            auto eol = headers.find("\r\n", pos);
+            if (eol == std::string::npos) {
+                eol = headers.size();
+            }
+            const std::string_view line(headers.data() + pos, eol - pos);
+            pos = eol + 2;
+            if (line.starts_with("HTTP/")) {
+                value.clear(); // New response block
+                continue;
+            }
+            const auto colon = line.find(':');
+            if (colon != name.size() || _strnicmp(line.data(), name.data(), name.size()) != 0) {
+                continue;
+            }
+            auto header_value = line.substr(colon + 1);
+            while (!header_value.empty() && isspace(static_cast<unsigned char>(header_value.front()))) {
+                header_value.remove_prefix(1);
+            }
+            while (!header_value.empty() && isspace(static_cast<unsigned char>(header_value.back()))) {
+                header_value.remove_suffix(1);
+            }
+            value = header_value;
+        }
+        return value;
+    }
+
+    bool ReadBinaryFile(const std::filesystem::path& path, std::string& out)
+    {
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(path, ec);
+        if (ec) {
+            return false;
+        }
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        out.resize(static_cast<size_t>(size));
+        return file.read(out.data(), static_cast<std::streamsize>(size)).gcount() == static_cast<std::streamsize>(size);
+    }
+
+    // Write to a temporary file first, then rename over the destination so readers never see a partial file.
+    // Each write gets its own temporary file, so concurrent writes to the same path don't interleave.
+    bool WriteBinaryFile(const std::filesystem::path& path, const std::string_view content)
+    {
+        static std::atomic_uint32_t next_tmp_id = 0;
+        auto tmp_path = path;
+        tmp_path += std::format(".{}.tmp", next_tmp_id++);
+        bool written;
+        {
+            std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+            written = file.is_open() && file.write(content.data(), static_cast<std::streamsize>(content.size()));
+        }
+        std::error_code ec;
+        if (written) {
+            std::filesystem::rename(tmp_path, path, ec);
+        }
+        if (!written || ec) {
+            std::filesystem::remove(tmp_path, ec);
+            return false;
+        }
+        return true;
+    }
+
+    std::string ToHex(const uint8_t* bytes, const size_t len)
+    {
+        std::string out;
+        out.reserve(len * 2);
+        for (size_t i = 0; i < len; i++) {
+            out += std::format("{:02x}", bytes[i]);
+        }
+        return out;
+    }
+
+    // Streams the response body straight into an open file, hashing as it goes, so memory use is bounded by curl's buffer
+    // size instead of the size of the download.
+    class FileSinkRestClient : public RestClient {
+    public:
+        FileSinkRestClient()
+        {
+            wc_InitSha256(&sha256);
+        }
+
+        ~FileSinkRestClient() override
+        {
+            CloseFile();
+            wc_Sha256Free(&sha256);
+        }
+
+        // Open the destination for writing. If resuming and it already holds bytes from an earlier attempt, they're hashed
+        // and a Range request is made for the rest.
+        bool OpenFile(const std::filesystem::path& path, const bool resume)
+        {
+            file_path = path;
+            std::error_code ec;
+            resume_offset = resume && std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+            if (ec) {
+                resume_offset = 0;
+            }
+            if (resume_offset && !HashExisting(path)) {
+                resume_offset = 0;
+            }
+            if (!resume_offset) {
+                wc_InitSha256(&sha256);
+            }
+            file = _wfopen(path.c_str(), resume_offset ? L"ab" : L"wb");
+            if (!file) {
+                return false;
+            }
+            bytes_written = resume_offset;
+            if (resume_offset) {
+                curl_easy_setopt(m_Handle, CURLOPT_RESUME_FROM_LARGE, static_cast<curl_off_t>(resume_offset));
+            }
+            return true;
+        }
+
+        void CloseFile()
+        {
+            if (file) {
+                fclose(file);
+                file = nullptr;
+            }
+        }
+
+        [[nodiscard]] std::string GetSha256()
+        {
+            uint8_t digest[WC_SHA256_DIGEST_SIZE];
+            wc_Sha256Final(&sha256, digest);
+            return ToHex(digest, sizeof(digest));
+        }
+
+        [[nodiscard]] uintmax_t GetBytesWritten() const { return bytes_written; }
+        [[nodiscard]] uintmax_t GetResumeOffset() const { return resume_offset; }
+        [[nodiscard]] bool HasWriteError() const { return write_error; }
+
+    protected:
+        void OnContent(const char* bytes, const size_t count) override
+        {
+            if (!file || write_error || discarding) {
+                return;
+            }
+            if (!checked_status) {
+                checked_status = true;
+                long status_code = 0;
+                curl_easy_getinfo(m_Handle, CURLINFO_RESPONSE_CODE, &status_code);
+                if (status_code < 200 || status_code > 299) {
+                    // An error page, not the file; it mustn't end up in the .part as a prefix to resume from
+                    discarding = true;
+                    return;
+                }
+                if (resume_offset && status_code != 206) {
+                    // Server ignored our Range header and is sending the whole thing; start again from byte 0
+                    fclose(file);
+                    file = _wfopen(file_path.c_str(), L"wb");
+                    wc_InitSha256(&sha256);
+                    resume_offset = bytes_written = 0;
+                    if (!file) {
+                        write_error = true;
+                        return;
+                    }
+                }
+            }
+            if (fwrite(bytes, 1, count, file) != count) {
+                write_error = true;
+                return;
+            }
+            wc_Sha256Update(&sha256, reinterpret_cast<const byte*>(bytes), static_cast<word32>(count));
+            bytes_written += count;
+        }
+
+    private:
+        bool HashExisting(const std::filesystem::path& path)
+        {
+            wc_InitSha256(&sha256);
+            FILE* existing = _wfopen(path.c_str(), L"rb");
+            if (!existing) {
+                return false;
+            }
+            std::array<byte, 64 * 1024> buffer;
+            size_t read;
+            uintmax_t total = 0;
+            while ((read = fread(buffer.data(), 1, buffer.size(), existing)) > 0) {
+                wc_Sha256Update(&sha256, buffer.data(), static_cast<word32>(read));
+                total += read;
+            }
+            fclose(existing);
+            return total == resume_offset;
+        }
+
+        std::filesystem::path file_path;
+        FILE* file = nullptr;
+        wc_Sha256 sha256{};
+        uintmax_t resume_offset = 0;
+        uintmax_t bytes_written = 0;
+        bool checked_status = false;
+        bool discarding = false;
+        bool write_error = false;
+    };
+
+    // Two tier HTTP cache used by Resources::Download(url, callback, context, cache_duration).
+    // Bodies live on disk under cache/<sha256 of url> with a cache/<sha256>.meta json sidecar holding the validators used
+    // for conditional requests; recently used bodies are also kept in a memory LRU so hot entries skip the disk entirely.
+    class HttpCache {
+    public:
+        static constexpr size_t memory_quota = 8 * 1024 * 1024;
+        static constexpr size_t memory_max_entry_size = 1024 * 1024;
+        static constexpr uint64_t disk_quota = 64 * 1024 * 1024;
+
+        struct Entry {
+            std::string etag;
+            std::string last_modified;
+            int status_code = 0;
+            time_t stored_at = 0;
+            std::shared_ptr<const std::string> body;
+
+            [[nodiscard]] bool IsSuccessful() const { return status_code >= 200 && status_code <= 302; }
+        };
+
+        enum class Tier { None, Memory, Disk };
+
+        // Files are read and written outside the lock; only the memory LRU and the disk index are guarded by it.
+        Tier Lookup(const std::string& key, Entry& out)
+        {
+            {
+                std::lock_guard lock(mutex);
+                if (const auto found = memory.find(key); found != memory.end()) {
+                    lru.splice(lru.begin(), lru, found->second.lru_it);
+                    out = found->second.entry;
+                    TouchDisk(key);
+                    return Tier::Memory;
+                }
+            }
+            // Bodies and sidecars are replaced by rename, so a read sees either the old file or the new one
+            Entry entry;
+            const auto body_path = GetBodyPath(key);
+            auto body = std::make_shared<std::string>();
+            if (!ReadBinaryFile(body_path, *body)) {
+                return Tier::None;
+            }
+            std::string meta_str;
+            if (ReadBinaryFile(GetMetaPath(key), meta_str)) {
+                const auto meta = nlohmann::json::parse(meta_str, nullptr, false);
+                if (meta.is_object()) {
+                    entry.etag = meta.value("etag", "");
+                    entry.last_modified = meta.value("last_modified", "");
+                    entry.status_code = meta.value("status_code", 200);
+                    entry.stored_at = meta.value("stored_at", static_cast<time_t>(0));
+                }
+            }
+            if (!entry.stored_at) {
+                // Legacy cache file without a sidecar; all we know is when it was written
+                std::error_code ec;
+                const auto mtime = std::filesystem::last_write_time(body_path, ec);
+                entry.status_code = 200;
+                entry.stored_at = ec ? 0 : std::chrono::system_clock::to_time_t(std::chrono::clock_cast<std::chrono::system_clock>(mtime));
+            }
+            entry.body = std::move(body);
+            {
+                std::lock_guard lock(mutex);
+                StoreMemory(key, entry);
+                TouchDisk(key);
+            }
+            out = std::move(entry);
+            return Tier::Disk;
+        }
+
+        void Store(const std::string& key, Entry&& entry)
+        {
+            IndexDisk();
+            Resources::EnsureFolderExists(GetCacheFolder());
+            if (!(WriteBinaryFile(GetBodyPath(key), *entry.body) && WriteMeta(key, entry))) {
+                EraseDisk(key);
+                return;
+            }
+            std::vector<std::string> evicted;
+            {
+                std::lock_guard lock(mutex);
+                auto& disk_entry = disk_index[key];
+                disk_bytes = disk_bytes - disk_entry.size + entry.body->size();
+                disk_entry = {entry.body->size(), time(nullptr)};
+                evicted = EnforceDiskQuota();
+                StoreMemory(key, entry);
+            }
+            for (const auto& evicted_key : evicted) {
+                RemoveFiles(evicted_key);
+            }
+        }
+
+        // Server answered 304 Not Modified; the cached body is good for another cache_duration.
+        // The 304 may carry new validators, which replace the ones we sent.
+        void Revalidated(const std::string& key, Entry& entry, const std::string& etag, const std::string& last_modified)
+        {
+            entry.stored_at = time(nullptr);
+            if (!etag.empty()) {
+                entry.etag = etag;
+            }
+            if (!last_modified.empty()) {
+                entry.last_modified = last_modified;
+            }
+            WriteMeta(key, entry);
+            std::lock_guard lock(mutex);
+            if (const auto found = memory.find(key); found != memory.end()) {
+                found->second.entry.stored_at = entry.stored_at;
+                found->second.entry.etag = entry.etag;
+                found->second.entry.last_modified = entry.last_modified;
+            }
+        }
+
+        void Count(uint64_t Resources::HttpCacheStats::* counter)
+        {
+            std::lock_guard lock(mutex);
+            stats.*counter += 1;
+        }
+
+        [[nodiscard]] Resources::HttpCacheStats GetStats()
+        {
+            std::lock_guard lock(mutex);
+            auto out = stats;
+            out.memory_bytes = memory_bytes;
+            out.disk_bytes = disk_bytes;
+            return out;
+        }
+
+    private:
+        struct MemoryEntry {
+            Entry entry;
+            std::list<std::string>::iterator lru_it;
+        };
+
+        struct DiskEntry {
+            uint64_t size = 0;
+            time_t last_used = 0;
+        };
+
+        static std::filesystem::path GetCacheFolder() { return Resources::GetPath("cache"); }
+        static std::filesystem::path GetBodyPath(const std::string& key) { return GetCacheFolder() / key; }
+
+        static std::filesystem::path GetMetaPath(const std::string& key)
+        {
+            auto path = GetBodyPath(key);
+            path += ".meta";
+            return path;
+        }
+
+        static bool WriteMeta(const std::string& key, const Entry& entry)
+        {
+            const nlohmann::json meta = {
+                {"etag", entry.etag},
+                {"last_modified", entry.last_modified},
+                {"status_code", entry.status_code},
+                {"stored_at", entry.stored_at}
+            };
+            return WriteBinaryFile(GetMetaPath(key), meta.dump());
+        }
+
+        void StoreMemory(const std::string& key, const Entry& entry)
+        {
+            EraseMemory(key);
+            if (entry.body->size() > memory_max_entry_size) {
+                return;
+            }
+            lru.push_front(key);
+            memory[key] = {entry, lru.begin()};
+            memory_bytes += entry.body->size();
+            while (memory_bytes > memory_quota && !lru.empty()) {
+                EraseMemory(lru.back());
+            }
+        }
+
+        void EraseMemory(const std::string& key)
+        {
+            const auto found = memory.find(key);
+            if (found == memory.end()) {
+                return;
+            }
+            memory_bytes -= found->second.entry.body->size();
+            lru.erase(found->second.lru_it);
+            memory.erase(found);
+        }
+
+        // Scan the cache folder once so the disk quota covers entries written by previous sessions.
+        // The scan runs outside the lock; anything stored meanwhile is already in the index and is kept as is.
+        void IndexDisk()
+        {
+            std::call_once(disk_indexed, [this] {
+                std::unordered_map<std::string, DiskEntry> found;
+                std::error_code ec;
+                for (const auto& file : std::filesystem::directory_iterator(GetCacheFolder(), ec)) {
+                    if (!file.is_regular_file(ec)) {
+                        continue;
+                    }
+                    if (file.path().extension() == ".tmp") {
+                        // Left behind by a write that never finished; a recent one may still be in progress
+                        const auto age = std::filesystem::file_time_type::clock::now() - file.last_write_time(ec);
+                        if (!ec && age > std::chrono::hours(1)) {
+                            std::filesystem::remove(file.path(), ec);
+                        }
+                        continue;
+                    }
+                    if (file.path().has_extension()) {
+                        continue;
+                    }
+                    const auto mtime = file.last_write_time(ec);
+                    const auto size = file.file_size(ec);
+                    if (ec) {
+                        continue;
+                    }
+                    found[file.path().filename().string()] = {size, std::chrono::system_clock::to_time_t(std::chrono::clock_cast<std::chrono::system_clock>(mtime))};
+                }
+                std::lock_guard lock(mutex);
+                for (auto& [key, disk_entry] : found) {
+                    if (disk_index.emplace(key, disk_entry).second) {
+                        disk_bytes += disk_entry.size;
+                    }
+                }
+            });
+        }
+
+        void TouchDisk(const std::string& key)
+        {
+            if (const auto found = disk_index.find(key); found != disk_index.end()) {
+                found->second.last_used = time(nullptr);
+            }
+        }
+
+        static void RemoveFiles(const std::string& key)
+        {
+            std::error_code ec;
+            std::filesystem::remove(GetBodyPath(key), ec);
+            std::filesystem::remove(GetMetaPath(key), ec);
+        }
+
+        void EraseDisk(const std::string& key)
+        {
+            RemoveFiles(key);
+            std::lock_guard lock(mutex);
+            if (const auto found = disk_index.find(key); found != disk_index.end()) {
+                disk_bytes -= found->second.size;
+                disk_index.erase(found);
+            }
+        }
+
+        // Evict least recently used entries until we're comfortably under quota. Call with the lock held;
+        // returns the keys whose files the caller should remove once it's released.
+        std::vector<std::string> EnforceDiskQuota()
+        {
+            std::vector<std::string> evicted;
+            if (disk_bytes <= disk_quota) {
+                return evicted;
+            }
+            std::vector<std::pair<time_t, std::string>> by_age;
+            by_age.reserve(disk_index.size());
+            for (const auto& [key, disk_entry] : disk_index) {
+                by_age.emplace_back(disk_entry.last_used, key);
+            }
+            std::ranges::sort(by_age);
+            for (auto& key : by_age | std::views::values) {
+                if (disk_bytes <= disk_quota * 9 / 10) {
+                    break;
+                }
+                EraseMemory(key);
+                const auto found = disk_index.find(key);
+                disk_bytes -= found->second.size;
+                disk_index.erase(found);
+                evicted.push_back(std::move(key));
+                stats.evictions++;
+            }
+            return evicted;
+        }
+
+        std::mutex mutex;
+        std::list<std::string> lru;
+        std::unordered_map<std::string, MemoryEntry> memory;
+        size_t memory_bytes = 0;
+        std::unordered_map<std::string, DiskEntry> disk_index;
+        uint64_t disk_bytes = 0;
+        std::once_flag disk_indexed;
+        Resources::HttpCacheStats stats;
+    };
+
+    HttpCache http_cache;
+
+    // Retry-After is either a number of seconds or an HTTP date
+    std::optional<std::chrono::seconds> ParseRetryAfter(const std::string& value)
+    {
+        if (value.empty()) {
+            return std::nullopt;
+        }
+        if (std::ranges::all_of(value, [](const char c) { return isdigit(static_cast<unsigned char>(c)) != 0; })) {
+            return std::chrono::seconds(strtoll(value.c_str(), nullptr, 10));
+        }
+        std::tm tm{};
+        std::istringstream ss(value);
+        ss >> std::get_time(&tm, "%a, %d %b %Y %H:%M:%S");
+        if (ss.fail()) {
+            return std::nullopt;
+        }
+        return std::chrono::seconds(std::max<time_t>(0, _mkgmtime(&tm) - time(nullptr)));
+    }
+
+    // Per-host admission control in front of every outgoing request: a token bucket for the request rate, a cap on concurrent requests,
+    // and a back-off window when the server asks us to slow down. Requests waiting on the same host go out in priority order.
+    class RequestScheduler {
+        using Clock = std::chrono::steady_clock;
+        static constexpr size_t lane_count = std::to_underlying(WorkerPriority::Count);
+        // Worker threads stop waiting for their turn after this long and go ahead anyway
+        static constexpr auto max_blocking_wait = std::chrono::seconds(30);
+        // Requests are only sent again automatically if the server wants us to wait less than this
+        static constexpr auto max_retry_after = std::chrono::seconds(20);
+        // Back-off used for a 429 without a Retry-After header
+        static constexpr auto default_backoff = std::chrono::seconds(5);
+        static constexpr size_t max_retries = 2;
+
+        struct Limits {
+            std::string_view host;
+            double requests_per_second;
+            double burst;
+            size_t max_concurrent;
+        };
+        static constexpr Limits default_limits = {"", 10.0, 20.0, 6};
+        static constexpr std::array host_limits = {
+            Limits{"wiki.guildwars.com", 4.0, 8.0, 4},
+            Limits{"api.github.com", 1.0, 4.0, 2},
+        };
+
+    public:
+        // Permission to have one request in flight to a host; released when destroyed. Empty if the host refused.
+        class Admission {
+        public:
+            Admission() = default;
+            Admission(Admission&& other) noexcept
+                : scheduler(std::exchange(other.scheduler, nullptr)), host(std::move(other.host)) {}
+
+            Admission& operator=(Admission&& other) noexcept
+            {
+                if (this != &other) {
+                    Reset();
+                    scheduler = std::exchange(other.scheduler, nullptr);
+                    host = std::move(other.host);
+                }
+                return *this;
+            }
+
+            ~Admission() { Reset(); }
+
+            explicit operator bool() const { return scheduler != nullptr; }
+
+            void Reset()
+            {
+                if (scheduler) {
+                    std::exchange(scheduler, nullptr)->Release(host);
+                }
+            }
+
+        private:
+            friend class RequestScheduler;
+
+            Admission(RequestScheduler* _scheduler, std::string _host)
+                : scheduler(_scheduler), host(std::move(_host)) {}
+
+            RequestScheduler* scheduler = nullptr;
+            std::string host;
+        };
+
+        // A job given to Submit(); it's passed the admission its request was let through with
+        using Task = std::move_only_function<void(Admission)>;
+
+    private:
+        struct Pending {
+            // Empty for a blocking caller waiting in Acquire()
+            Task task;
+            bool* admitted = nullptr;
+            Clock::time_point queued_at;
+            Async::CancellationToken token;
+        };
+
+        struct Host {
+            Limits limits = default_limits;
+            double tokens = 0;
+            Clock::time_point refilled_at;
+            Clock::time_point backoff_until;
+            size_t in_flight = 0;
+            std::array<std::deque<Pending>, lane_count> pending;
+            Resources::HostRequestStats stats;
+        };
+
+    public:
+        // Held for the duration of a request. Uses the admission a Submit()ted job was given if it's for the same host; otherwise asks for one,
+        // which on a worker thread waits for the host's turn, and anywhere else fails straight away if the host is busy.
+        class Slot {
+        public:
+            Slot(RequestScheduler& _scheduler, const std::string& url)
+                : Slot(_scheduler, url, Admission()) {}
+
+            Slot(RequestScheduler& _scheduler, const std::string& url, Admission&& admitted)
+                : scheduler(_scheduler), host(GetHost(url))
+            {
+                if (admitted && admitted.host == host) {
+                    admission = std::move(admitted);
+                }
+                else {
+                    admitted.Reset();
+                    admission = scheduler.Acquire(host, current_worker_priority);
+                }
+            }
+
+            Slot(const Slot&) = delete;
+            Slot& operator=(const Slot&) = delete;
+
+            // False if the host refused the request; don't send it
+            explicit operator bool() const { return static_cast<bool>(admission); }
+
+            // Call with each response; returns true if the server told us to back off
+            bool Throttled(const int status_code, const std::string& headers) const { return scheduler.OnResponse(host, status_code, headers); }
+
+            // Waits until the throttled host will take the request again. Returns false if it's not worth retrying.
+            bool WaitToRetry()
+            {
+                if (retries >= max_retries || !scheduler.ReleaseToRetry(admission, max_retry_after)) {
+                    return false;
+                }
+                retries++;
+                admission = scheduler.Acquire(host, current_worker_priority);
+                return static_cast<bool>(admission);
+            }
+
+        private:
+            RequestScheduler& scheduler;
+            const std::string host;
+            Admission admission;
+            size_t retries = 0;
+        };
+
+        static std::string GetHost(const std::string& url)
+        {
+            const auto without_protocol = RemoveProtocol(url);
+            auto host = without_protocol.substr(0, without_protocol.find_first_of(":/?#"));
+            std::ranges::transform(host, host.begin(), [](const char c) {
+                return static_cast<char>(tolower(static_cast<unsigned char>(c)));
+            });
+            return host;
+        }
+
+        // Queue a job that makes a request to url; it's handed to the worker threads once the host will take it.
+        // If token fires while the job is queued, it's handed over straight away without counting against the host; the job should check the token and bail.
+        void Submit(const std::string& url, Task&& task, const WorkerPriority priority, const Async::CancellationToken& token = {})
+        {
+            std::lock_guard lock(mutex);
+            auto& host = GetHostLocked(GetHost(url));
+            host.pending[std::to_underlying(priority)].push_back({std::move(task), nullptr, Clock::now(), token});
+            pending_count++;
+            DispatchLocked();
+        }
+
+        // Let through anything that is now allowed to go; called every frame so refilled tokens and expired back-offs get picked up
+        void Dispatch()
+        {
+            if (!pending_count) {
+                return;
+            }
+            std::lock_guard lock(mutex);
+            DispatchLocked();
+        }
+
+        // Lets everything through so that nobody is left waiting on shutdown
+        void Stop()
+        {
+            {
+                std::lock_guard lock(mutex);
+                stopping = true;
+                DispatchLocked();
+            }
+            admitted_cv.notify_all();
+        }
+
+        void Reset()
+        {
+            std::lock_guard lock(mutex);
+            stopping = false;
+        }
+
+        [[nodiscard]] std::vector<Resources::HostRequestStats> GetStats()
+        {
+            std::lock_guard lock(mutex);
+            const auto now = Clock::now();
+            std::vector<Resources::HostRequestStats> out;
+            out.reserve(hosts.size());
+            for (auto& [name, host] : hosts) {
+                Refill(host, now);
+                auto& stats = out.emplace_back(host.stats);
+                stats.host = name;
+                stats.in_flight = host.in_flight;
+                stats.queued = 0;
+                for (const auto& queue : host.pending) {
+                    stats.queued += queue.size();
+                }
+                stats.tokens = static_cast<float>(host.tokens);
+                stats.backoff_remaining = host.backoff_until > now ? std::chrono::duration<float>(host.backoff_until - now).count() : 0.f;
+            }
+            return out;
+        }
+
+    private:
+        Admission Acquire(const std::string& host_name, const WorkerPriority priority)
+        {
+            std::unique_lock lock(mutex);
+            auto& host = GetHostLocked(host_name);
+            if (!is_worker_thread) {
+                // e.g. the game thread, or a widget joining its own fetch thread from it; waiting here would stall the frame
+                const auto now = Clock::now();
+                Refill(host, now);
+                if (!CanStart(host, now)) {
+                    host.stats.rejected++;
+                    return {};
+                }
+                Start(host, now, now);
+                return {this, host_name};
+            }
+            auto& queue = host.pending[std::to_underlying(priority)];
+            bool admitted = false;
+            queue.push_back({nullptr, &admitted, Clock::now()});
+            pending_count++;
+            DispatchLocked();
+            const auto give_up_at = Clock::now() + max_blocking_wait;
+            while (!admitted) {
+                if (Clock::now() >= give_up_at) {
+                    // Something is hogging the host; go anyway rather than hold this thread up forever
+                    std::erase_if(queue, [&admitted](const Pending& p) { return p.admitted == &admitted; });
+                    pending_count--;
+                    Start(host, give_up_at - max_blocking_wait, Clock::now());
+                    break;
+                }
+                // Nothing else refills the tokens while the game isn't drawing frames, so poll
+                admitted_cv.wait_for(lock, std::chrono::milliseconds(100));
+                if (!admitted) {
+                    DispatchLocked();
+                }
+            }
+            return {this, host_name};
+        }
+
+        void Release(const std::string& host_name)
+        {
+            std::lock_guard lock(mutex);
+            ReleaseLocked(GetHostLocked(host_name));
+        }
+
+        // Gives up the admission so a throttled request can wait for another. Returns false, keeping it, if the host is backing off for longer than max_wait.
+        bool ReleaseToRetry(Admission& admission, const Clock::duration max_wait)
+        {
+            if (!admission) {
+                return false;
+            }
+            std::lock_guard lock(mutex);
+            auto& host = GetHostLocked(admission.host);
+            if (host.backoff_until - Clock::now() > max_wait) {
+                return false;
+            }
+            host.stats.retried++;
+            admission.scheduler = nullptr;
+            ReleaseLocked(host);
+            return true;
+        }
+
+        void ReleaseLocked(Host& host)
+        {
+            ASSERT(host.in_flight > 0);
+            host.in_flight--;
+            DispatchLocked();
+        }
+
+        bool OnResponse(const std::string& host_name, const int status_code, const std::string& headers)
+        {
+            if (status_code != 429 && status_code != 503) {
+                return false;
+            }
+            auto delay = ParseRetryAfter(GetResponseHeader(headers, "Retry-After"));
+            if (!delay) {
+                if (status_code == 503) {
+                    return false; // Just broken, not asking us to slow down
+                }
+                delay = default_backoff;
+            }
+            std::lock_guard lock(mutex);
+            auto& host = GetHostLocked(host_name);
+            host.backoff_until = std::max(host.backoff_until, Clock::now() + *delay);
+            host.tokens = 0;
+            host.stats.throttled++;
+            return true;
+        }
+
+        Host& GetHostLocked(const std::string& host_name)
+        {
+            const auto [it, inserted] = hosts.try_emplace(host_name);
+            auto& host = it->second;
+            if (inserted) {
+                const auto found = std::ranges::find(host_limits, host_name, &Limits::host);
+                host.limits = found != host_limits.end() ? *found : default_limits;
+                host.tokens = host.limits.burst;
+                host.refilled_at = Clock::now();
+            }
+            return host;
+        }
+
+        static void Refill(Host& host, const Clock::time_point now)
+        {
+            const auto elapsed = std::chrono::duration<double>(now - host.refilled_at).count();
+            host.tokens = std::min(host.limits.burst, host.tokens + elapsed * host.limits.requests_per_second);
+            host.refilled_at = now;
+        }
+
+        [[nodiscard]] bool CanStart(const Host& host, const Clock::time_point now) const
+        {
+            if (stopping) {
+                return true;
+            }
+            return host.in_flight < host.limits.max_concurrent && host.tokens >= 1.0 && now >= host.backoff_until;
+        }
+
+        static void Start(Host& host, const Clock::time_point queued_at, const Clock::time_point now)
+        {
+            host.in_flight++;
+            host.tokens = std::max(0.0, host.tokens - 1.0);
+            host.stats.requests++;
+            const auto waited = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - queued_at).count());
+            host.stats.total_wait_us += waited;
+            host.stats.max_wait_us = std::max(host.stats.max_wait_us, waited);
+        }
+
+        void DispatchLocked()
+        {
+            const auto now = Clock::now();
+            bool woke_waiter = false;
+            for (auto& [name, host] : hosts) {
+                Refill(host, now);
+                for (size_t lane = 0; lane < lane_count; lane++) {
+                    auto& queue = host.pending[lane];
+                    // Cancelled jobs don't need to wait for the host
+                    for (auto it = queue.begin(); it != queue.end();) {
+                        if (!(it->task && it->token.IsCancelled())) {
+                            ++it;
+                            continue;
+                        }
+                        worker_queue.Push([task = std::move(it->task)]() mutable {
+                            task({});
+                        }, static_cast<WorkerPriority>(lane));
+                        it = queue.erase(it);
+                        pending_count--;
+                    }
+                    while (!queue.empty() && CanStart(host, now)) {
+                        auto job = std::move(queue.front());
+                        queue.pop_front();
+                        pending_count--;
+                        Start(host, job.queued_at, now);
+                        if (job.admitted) {
+                            *job.admitted = true;
+                            woke_waiter = true;
+                            continue;
+                        }
+                        // If the job finishes without making its request, the admission is released when it's destroyed
+                        worker_queue.Push([admission = Admission(this, name), task = std::move(job.task)]() mutable {
+                            task(std::move(admission));
+                        }, static_cast<WorkerPriority>(lane));
+                    }
+                }
+            }
+            if (woke_waiter) {
+                admitted_cv.notify_all();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable admitted_cv;
+        std::unordered_map<std::string, Host> hosts;
+        std::atomic<size_t> pending_count = 0;
+        bool stopping = false;
+    };
+
+    RequestScheduler request_scheduler;
+    WorkerQueue worker_queue;
+
+    // Aborts the transfer when token fires, and gives curl whatever is left before the token's deadline as its timeout
+    void ApplyCancellation(CurlEasy& r, const Async::CancellationToken& token)
+    {
+        if (!token.CanBeCancelled()) {
+            return;
+        }
+        if (token.HasDeadline()) {
+            const auto remaining_ms = std::chrono::duration_cast<std::chrono::milliseconds>(token.GetDeadline() - std::chrono::steady_clock::now()).count();
+            r.SetTimeoutMs(static_cast<int>(std::clamp<long long>(remaining_ms, 1, INT_MAX)));
+        }
+        r.SetAbortCallback([token] {
+            return token.IsCancelled();
+        });
+    }
+
+    // Sends the request once the host will take it, and again if the server throttled it and asked us to retry shortly
+    // Returns false if it was never sent: cancelled, or refused because the host was busy and this isn't a thread that can wait for it.
+    bool ExecuteScheduled(RestClient& r, const std::string& url, const Async::CancellationToken& token, RequestScheduler::Admission&& admission = {})
+    {
+        if (token.IsCancelled()) {
+            return false;
+        }
+        ApplyCancellation(r, token);
+        RequestScheduler::Slot slot(request_scheduler, url, std::move(admission));
+        if (!slot) {
+            return false;
+        }
+        r.Execute();
+        while (slot.Throttled(r.GetStatusCode(), r.GetHeader()) && !token.IsCancelled() && slot.WaitToRetry()) {
+            r.Clear();
+            r.Execute();
+        }
+        return true;
+    }
+
+    std::atomic<uint64_t> download_requests = 0;
+    std::atomic<uint64_t> download_requests_deduplicated = 0;
+
+    // Collapses concurrent requests for the same key into a single transfer; every caller that joined gets the result.
+    // Waiter is any type with a CancellationToken "token"; the transfer itself is cancelled once every waiter has cancelled.
+    template <typename Key, typename Waiter>
+    class SingleFlight {
+    public:
+        // Returns true if the caller should start the transfer, false if it was attached to one already in flight.
+        // The caller that starts the transfer gets the token to run it with in flight_token, and hands it back to Finish().
+        bool Join(const Key& key, Waiter&& waiter, Async::CancellationToken& flight_token)
+        {
+            download_requests++;
+            std::vector<Waiter> abandoned;
+            std::lock_guard lock(mutex);
+            auto& flight = in_flight[key];
+            if (flight.cancellation.IsCancelled()) {
+                // Everyone on it gave up and its transfer is being aborted; start a new one rather than hand this caller that failure
+                abandoned = std::move(flight.waiters);
+                flight = Flight();
+            }
+            flight.waiters.push_back(std::move(waiter));
+            if (flight.waiters.size() == 1) {
+                flight_token = flight.cancellation.Token();
+                return true;
+            }
+            download_requests_deduplicated++;
+            return false;
+        }
 
-        WorkerThread()
+        // Detach all waiters from the flight that flight_token was given out for; requests made after this point start a new transfer.
+        // Returns nothing if that flight was abandoned and replaced.
+        std::vector<Waiter> Finish(const Key& key, const Async::CancellationToken& flight_token)
         {
-            ASSERT(!is_running);
-            is_running = true;
-            thread = std::jthread([&] {
-                while (!should_stop) {
-                    worker_mutex.lock();
-                    if (thread_jobs.empty()) {
-                        worker_mutex.unlock();
-                        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                    }
-                    else {
-                        std::function<void()> func = thread_jobs.front();
-                        thread_jobs.pop();
-                        worker_mutex.unlock();
-                        func();
-                    }
-                }
-                is_running = false;
-            });
+            std::lock_guard lock(mutex);
+            const auto found = in_flight.find(key);
+            if (found == in_flight.end() || !found->second.cancellation.Issued(flight_token)) {
+                return {};
+            }
+            auto waiters = std::move(found->second.waiters);
+            in_flight.erase(found);
+            return waiters;
         }
 
-        ~WorkerThread()
+        // Cancel any transfer that nobody is waiting on any more. Called every frame.
+        void CancelAbandoned()
         {
-            ASSERT(!is_running);
+            std::lock_guard lock(mutex);
+            for (auto& flight : in_flight | std::views::values) {
+                if (flight.cancellation.IsCancelled()) {
+                    continue;
+                }
+                if (std::ranges::all_of(flight.waiters, [](const Waiter& waiter) { return waiter.token.IsCancelled(); })) {
+                    flight.cancellation.Cancel();
+                }
+            }
         }
+
+    private:
+        struct Flight {
+            std::vector<Waiter> waiters;
+            Async::CancellationSource cancellation;
+        };
+
+        std::mutex mutex;
+        std::unordered_map<Key, Flight> in_flight;
     };
 
-    std::vector<WorkerThread*> workers;
+    struct MbWaiter {
+        Resources::AsyncLoadMbCallback callback;
+        void* context = nullptr;
+        Async::CancellationToken token;
+    };
 
-    void InitRestClient(RestClient* r)
-    {
-        char user_agent_str[32];
-        ASSERT(snprintf(user_agent_str, sizeof(user_agent_str), "GWToolboxpp/%s", GWTOOLBOXDLL_VERSION) != -1);
-        r->SetUserAgent(user_agent_str);
-        r->SetFollowLocation(true);
-        r->SetVerifyPeer(false); // idc about mitm or out of date certs
-        r->SetMethod(HttpMethod::Get);
-        r->SetVerifyHost(false);
-        r->SetConnectTimeoutSec(5);
-        r->SetTimeoutSec(10);
-    }
+    struct FileWaiter {
+        Resources::AsyncLoadCallback callback;
+        Async::CancellationToken token;
+    };
 
-    const std::string HashStr(const std::string& str)
+    SingleFlight<std::string, MbWaiter> downloads_by_url;
+    SingleFlight<std::string, MbWaiter> cached_downloads_by_url;
+    SingleFlight<std::wstring, FileWaiter> downloads_by_path;
+
+    // Search page -> image url -> texture. The page is fetched on a worker thread, then the rest runs in the game loop, as callback expects.
+    Async::Task<> LoadItemImageFromWiki(IDirect3DTexture9** texture, const std::wstring item_name, const std::filesystem::path folder, const Resources::AsyncLoadCallback callback)
     {
-        const auto bytes_to_hash = std::vector<byte>(str.begin(), str.end());
-        auto hash = std::vector<byte>(WC_SHA256_DIGEST_SIZE);
-        wc_Sha256Hash(bytes_to_hash.data(), bytes_to_hash.size(), hash.data());
-        std::stringstream hexstream;
-        hexstream << std::hex << std::setfill('0');
-        for (auto b : hash) {
-            hexstream << std::setw(2) << static_cast<unsigned>(b);
+        const auto page = co_await Async::Download(GuiUtils::WikiUrl(item_name));
+        co_await Async::ResumeOnMain{};
+        if (!page.ok) {
+            callback(false, TextUtils::StringToWString(page.body));
+            co_return;
         }
-        return hexstream.str();
-    };
+        const std::string& response = page.body;
+        const std::string item_name_str = TextUtils::WStringToString(item_name);
+        // matches any characters that need to be escaped in RegEx
+        static constexpr ctll::fixed_string SPECIAL_CHARS{R"([\-\[\]{}()*+?.,\^$|#\s])"};
+        const std::string sanitized = TextUtils::ctre_regex_replace<SPECIAL_CHARS, R"(\$&)">(item_name_str);
+        std::smatch m;
+        // Find first png image that has an alt tag matching the html encoded title of the page
+        char regex_str[255];
+        snprintf(regex_str, sizeof(regex_str), R"(<img[^>]+alt=['"][^>]*%s[^>]*['"][^>]+src=['"]([^"']+)([.](png)))", sanitized.c_str());
+        if (!std::regex_search(response, m, std::regex(regex_str))) {
+            // Failed to find via item name; try via page title
+            const std::regex title_finder("<title>(.*) - Guild Wars Wiki.*</title>");
+            if (!std::regex_search(response, m, title_finder)) {
+                trigger_failure_callback(callback, L"Failed to find title HTML for %s from wiki", item_name.c_str());
+                co_return;
+            }
+            const std::string html_item_name = TextUtils::HtmlEncode(m[1].str());
+            snprintf(regex_str, sizeof(regex_str), R"(<img[^>]+alt=['"][^>]*%s[^>]*['"][^>]+src=['"]([^"']+)([.](png)))", html_item_name.c_str());
+            if (!std::regex_search(response, m, std::regex(regex_str))) {
+                trigger_failure_callback(callback, L"Failed to find image HTML for %s from wiki", item_name.c_str());
+                co_return;
+            }
+        }
+        const std::string image_path = m[1].str();
+        const std::string image_extension = m[2].str();
+        wchar_t path_to_file[MAX_PATH];
+        swprintf(path_to_file, _countof(path_to_file), L"%s\\%s%S", folder.c_str(), item_name.c_str(), image_extension.c_str());
+        char url[128];
+        if (strncmp(image_path.c_str(), "http", 4) == 0) {
+            // Image URL is absolute
+            snprintf(url, _countof(url), "%s%s", image_path.c_str(), image_extension.c_str());
+        }
+        else {
+            // Image URL is relative to domain
+            snprintf(url, _countof(url), "https://wiki.guildwars.com%s%s", image_path.c_str(), image_extension.c_str());
+        }
+        Resources::LoadTexture(texture, path_to_file, url, callback);
+    }
 } // namespace
 
 extern "C" __declspec(dllexport) IDirect3DTexture9** __cdecl GetSkillImage(GW::Constants::SkillID skill_id)
@@ -256,11 +1434,14 @@ Resources::Resources()
     co_initialized = SUCCEEDED(CoInitializeEx(nullptr, COINIT_MULTITHREADED));
 }
 
-void Resources::EnqueueWorkerTask(const std::function<void()>& f)
+void Resources::EnqueueWorkerTask(WorkerTask&& f, const WorkerPriority priority)
+{
+    worker_queue.Push(std::move(f), priority);
+}
+
+Resources::WorkerQueueStats Resources::GetWorkerQueueStats(const WorkerPriority priority)
 {
-    worker_mutex.lock();
-    thread_jobs.push(f);
-    worker_mutex.unlock();
+    return worker_queue.GetStats(std::to_underlying(priority));
 }
 
 void Resources::EnqueueMainTask(const std::function<void()>& f)
@@ -300,7 +1481,7 @@ void Resources::OpenFileDialog(std::function<void(const char*)> callback, const
         if (outPath) {
             free(outPath);
         }
-    });
+    }, WorkerPriority::Interactive);
 }
 
 void Resources::SaveFileDialog(std::function<void(const char*)> callback, const char* filterList, const char* defaultPath)
@@ -328,7 +1509,7 @@ void Resources::SaveFileDialog(std::function<void(const char*)> callback, const
         if (outPath) {
             free(outPath);
         }
-    });
+    }, WorkerPriority::Interactive);
 }
 
 float Resources::GetGWScaleMultiplier(const bool force)
@@ -414,15 +1595,24 @@ HRESULT Resources::ResolveShortcut(const std::filesystem::path& in_shortcut_path
 void Resources::Initialize()
 {
     ToolboxModule::Initialize();
-    for (size_t i = 0; i < MAX_WORKERS; i++) {
-        workers.push_back(new WorkerThread());
+    should_stop = false;
+    worker_queue.Reset();
+    request_scheduler.Reset();
+    for (size_t lane = 0; lane < WORKERS_PER_LANE.size(); lane++) {
+        for (size_t i = 0; i < WORKERS_PER_LANE[lane]; i++) {
+            workers.push_back(new WorkerThread(lane));
+        }
     }
     RegisterUIMessageCallback(&OnUIMessage_Hook, GW::UI::UIMessage::kPreferenceEnumChanged, OnUIMessage, 0x8000);
+    // Synchronous, so names are there for the first frame; it's one read of a file of a few hundred KB
+    DecodedStrings::Load(GetPath(DECODED_STRINGS_PATH));
 }
 
 void Resources::Cleanup()
 {
     should_stop = true;
+    request_scheduler.Stop();
+    worker_queue.Stop();
     for (const auto worker : workers) {
         for (size_t i = 0; i < 5000; i += 10) {
             if (!worker->is_running) 
@@ -453,6 +1643,8 @@ void Resources::Cleanup()
         }
     }
     encoded_string_ids.clear();
+    DecodedStrings::Save(GetPath(DECODED_STRINGS_PATH));
+    DecodedStrings::Clear();
     map_names.clear(); // NB: pointers to encoded_string_ids, no need to free memory
     skill_names.clear(); // NB: pointers to encoded_string_ids, no need to free memory
 }
@@ -485,13 +1677,16 @@ void Resources::SignalTerminate()
 {
     ToolboxModule::SignalTerminate();
     should_stop = true;
+    request_scheduler.Stop();
+    worker_queue.Stop();
 }
 
 void Resources::EndLoading() const
 {
-    EnqueueWorkerTask([this] {
+    EnqueueWorkerTask([] {
         should_stop = true;
-    });
+        worker_queue.Stop();
+    }, WorkerPriority::Bulk);
 }
 
 std::filesystem::path Resources::GetComputerFolderPath()
@@ -550,51 +1745,155 @@ bool Resources::EnsureFolderExists(const std::filesystem::path& path)
     return exists(path) || create_directories(path);
 }
 
-bool Resources::Download(const std::filesystem::path& path_to_file, const std::string& url, std::wstring& response)
-{
-    if (exists(path_to_file)) {
-        if (!std::filesystem::remove(path_to_file)) {
-            return StrSwprintf(response, L"Failed to delete existing file %s, err %d", path_to_file.wstring().c_str(), GetLastError()), false;
+namespace {
+    // Held around a download into a file, so only one transfer writes its .part at a time; a flight that replaced an abandoned one can
+    // otherwise start before the abandoned transfer has noticed it's been cancelled.
+    class PartFileLock {
+    public:
+        explicit PartFileLock(const std::filesystem::path& path)
+            : key(path.wstring())
+        {
+            std::unique_lock lock(mutex);
+            released.wait(lock, [this] { return !in_use.contains(key); });
+            in_use.insert(key);
         }
-    }
-    if (exists(path_to_file)) {
-        return StrSwprintf(response, L"File already exists @ %s", path_to_file.wstring().c_str()), false;
-    }
 
-    std::string content;
-    if (!Download(url, content)) {
-        return StrSwprintf(response, L"%S", content.c_str()), false;
-    }
-    if (!content.length()) {
-        return StrSwprintf(response, L"Failed to download %S, no content length", url.c_str()), false;
-    }
-    FILE* fp = fopen(path_to_file.string().c_str(), "wb");
-    if (!fp) {
-        return StrSwprintf(response, L"Failed to call fopen for %s, err %d", path_to_file.wstring().c_str(), GetLastError()), false;
-    }
-    const auto written = fwrite(content.data(), content.size() + 1, 1, fp);
-    fclose(fp);
-    if (written != 1) {
-        return StrSwprintf(response, L"Failed to call fwrite for %s, err %d", path_to_file.wstring().c_str(), GetLastError()), false;
+        ~PartFileLock()
+        {
+            {
+                std::lock_guard lock(mutex);
+                in_use.erase(key);
+            }
+            released.notify_all();
+        }
+
+        PartFileLock(const PartFileLock&) = delete;
+        PartFileLock& operator=(const PartFileLock&) = delete;
+
+    private:
+        const std::wstring key;
+        static inline std::mutex mutex;
+        static inline std::condition_variable released;
+        static inline std::unordered_set<std::wstring> in_use;
+    };
+
+    bool DownloadToFile(const std::filesystem::path& path_to_file, const std::string& url, std::wstring& response, const std::string& expected_sha256, const uintmax_t expected_size, const Async::CancellationToken& token, RequestScheduler::Admission&& admission)
+    {
+        if (token.IsCancelled()) {
+            return StrSwprintf(response, L"Download of %S cancelled", url.c_str()), false;
+        }
+        // Download into <file>.part, then rename over the destination once it's complete and verified.
+        // A .part left behind by an interrupted download is resumed with a Range request rather than started again.
+        auto part_path = path_to_file;
+        part_path += ".part";
+
+        FileSinkRestClient r;
+        InitRestClient(&r);
+        // Range offsets refer to the encoded body, so a decoded stream couldn't be resumed
+        r.SetAcceptEncoding(nullptr);
+        // Big files take a while; rely on the low speed limit rather than a total timeout
+        r.SetTimeoutSec(0);
+        r.SetLowSpeedLimit(1024, 15);
+        ApplyCancellation(r, token);
+        r.SetUrl(url.c_str());
+        // Only resume when there's a hash to check the result against; a stale .part could be from a different version of the file
+        if (!r.OpenFile(part_path, !expected_sha256.empty())) {
+            return StrSwprintf(response, L"Failed to open %s for writing, err %d", part_path.wstring().c_str(), GetLastError()), false;
+        }
+        {
+            // Not retried here on 429; the body has already gone to the file
+            RequestScheduler::Slot slot(request_scheduler, url, std::move(admission));
+            if (!slot) {
+                return StrSwprintf(response, L"Download of %S refused, the server is busy", url.c_str()), false;
+            }
+            r.Execute();
+            slot.Throttled(r.GetStatusCode(), r.GetHeader());
+        }
+        r.CloseFile();
+
+        std::error_code ec;
+        if (r.GetStatusCode() == 416 && r.GetResumeOffset()) {
+            // Range not satisfiable; whatever we had isn't a prefix of this file any more
+            std::filesystem::remove(part_path, ec);
+            return DownloadToFile(path_to_file, url, response, expected_sha256, expected_size, token, {});
+        }
+        if (r.HasWriteError()) {
+            std::filesystem::remove(part_path, ec);
+            return StrSwprintf(response, L"Failed to write to %s, err %d", part_path.wstring().c_str(), GetLastError()), false;
+        }
+        if (!r.IsSuccessful()) {
+            // Cancelled, or the connection failed part way: leave the partial file in place so the next attempt can resume
+            if (token.IsCancelled()) {
+                return StrSwprintf(response, L"Download of %S cancelled", url.c_str()), false;
+            }
+            if (r.GetStatus() == ResponseStatus::Completed) {
+                // The server answered with an error status; don't resume from whatever was there before
+                std::filesystem::remove(part_path, ec);
+            }
+            return StrSwprintf(response, L"Failed to download %S, curl status %d %S", url.c_str(), r.GetStatusCode(), r.GetStatusStr()), false;
+        }
+        if (!r.GetBytesWritten()) {
+            std::filesystem::remove(part_path, ec);
+            return StrSwprintf(response, L"Failed to download %S, no content length", url.c_str()), false;
+        }
+        if (expected_size && r.GetBytesWritten() != expected_size) {
+            std::filesystem::remove(part_path, ec);
+            return StrSwprintf(response, L"Failed to download %S, expected %llu bytes but got %llu", url.c_str(), expected_size, r.GetBytesWritten()), false;
+        }
+        if (!expected_sha256.empty()) {
+            const auto sha256 = r.GetSha256();
+            if (_stricmp(sha256.c_str(), expected_sha256.c_str()) != 0) {
+                std::filesystem::remove(part_path, ec);
+                if (r.GetResumeOffset()) {
+                    // The bytes we resumed from may have been bad; one more go from scratch
+                    return DownloadToFile(path_to_file, url, response, expected_sha256, expected_size, token, {});
+                }
+                return StrSwprintf(response, L"Failed to download %S, sha256 mismatch (expected %S, got %S)", url.c_str(), expected_sha256.c_str(), sha256.c_str()), false;
+            }
+        }
+        std::filesystem::rename(part_path, path_to_file, ec);
+        if (ec) {
+            return StrSwprintf(response, L"Failed to move %s to %s, err %d", part_path.wstring().c_str(), path_to_file.wstring().c_str(), ec.value()), false;
+        }
+        return true;
     }
-    return true;
 }
 
-void Resources::Download(const std::filesystem::path& path_to_file, const std::string& url, const AsyncLoadCallback& callback) const
+bool Resources::Download(const std::filesystem::path& path_to_file, const std::string& url, std::wstring& response, const std::string& expected_sha256, const uintmax_t expected_size, const Async::CancellationToken& token)
+{
+    PartFileLock part_lock(path_to_file);
+    return DownloadToFile(path_to_file, url, response, expected_sha256, expected_size, token, {});
+}
+
+void Resources::Download(const std::filesystem::path& path_to_file, const std::string& url, const AsyncLoadCallback& callback, const std::string& expected_sha256, const uintmax_t expected_size, const Async::CancellationToken& token) const
 {
-    EnqueueWorkerTask([this, path_to_file, url, callback] {
+    auto flight_key = path_to_file.wstring();
+    Async::CancellationToken flight_token;
+    if (!downloads_by_path.Join(flight_key, {callback, token}, flight_token)) {
+        return; // Already downloading to this file
+    }
+    request_scheduler.Submit(url, [path_to_file, url, flight_key, expected_sha256, expected_size, flight_token](RequestScheduler::Admission admission) {
         std::wstring error_message;
-        bool success = Download(path_to_file, url, error_message);
-        // and call the callback in the main thread
-        if (callback) {
-            EnqueueMainTask([callback, success, error_message] {
-                callback(success, error_message);
-            });
-        }
-        else if (!success) {
-            Log::LogW(L"Failed to download %s from %S\n%S", path_to_file.wstring().c_str(), url.c_str(), error_message.c_str());
-        }
-    });
+        bool success;
+        {
+            PartFileLock part_lock(path_to_file);
+            success = DownloadToFile(path_to_file, url, error_message, expected_sha256, expected_size, flight_token, std::move(admission));
+        }
+        // and call the callbacks in the main thread
+        EnqueueMainTask([path_to_file, url, flight_key, flight_token, success, error_message] {
+            for (const auto& [waiter, waiter_token] : downloads_by_path.Finish(flight_key, flight_token)) {
+                if (waiter_token.IsCancelled()) {
+                    continue;
+                }
+                if (waiter) {
+                    waiter(success, error_message);
+                }
+                else if (!success) {
+                    Log::LogW(L"Failed to download %s from %S\n%s", path_to_file.wstring().c_str(), url.c_str(), error_message.c_str());
+                }
+            }
+        });
+    }, WorkerPriority::Background, flight_token);
 }
 
 bool Resources::ReadFile(const std::filesystem::path& path, std::string& response)
@@ -629,134 +1928,190 @@ bool Resources::Download(const std::string& url, std::string& response)
     return Download(url, response, statusCode);
 }
 
-bool Resources::Download(const std::string& url, std::string& response, int& statusCode)
-{
-    RestClient r;
-    InitRestClient(&r);
-    r.SetUrl(url.c_str());
-    r.Execute();
-    statusCode = r.GetStatusCode();
-    response = std::move(r.GetContent());
-    if (!r.IsSuccessful()) {
-        if (response.empty()) {
-            response = std::format("Failed to download {}, curl status {} {}", url, r.GetStatusCode(), r.GetStatusStr());
+namespace {
+    bool DownloadToMemory(const std::string& url, std::string& response, int& statusCode, const Async::CancellationToken& token, RequestScheduler::Admission&& admission)
+    {
+        RestClient r;
+        InitRestClient(&r);
+        r.SetMaxDecodedSize(MAX_DOWNLOAD_SIZE_IN_MEMORY);
+        r.SetUrl(url.c_str());
+        const bool sent = ExecuteScheduled(r, url, token, std::move(admission));
+        statusCode = r.GetStatusCode();
+        response = std::move(r.GetContent());
+        if (!r.IsSuccessful()) {
+            if (token.IsCancelled()) {
+                response = std::format("Download of {} cancelled", url);
+            }
+            else if (!sent) {
+                response = std::format("Download of {} refused, the server is busy", url);
+            }
+            else if (response.empty()) {
+                response = std::format("Failed to download {}, curl status {} {}", url, r.GetStatusCode(), r.GetStatusStr());
+            }
+            return false;
         }
-        return false;
+        return true;
     }
-    return true;
 }
 
-void Resources::Download(const std::string& url, AsyncLoadMbCallback callback, void* context)
+bool Resources::Download(const std::string& url, std::string& response, int& statusCode, const Async::CancellationToken& token)
 {
-    EnqueueWorkerTask([url, callback, context] {
-        std::string response;
+    return DownloadToMemory(url, response, statusCode, token, {});
+}
+
+void Resources::Download(const std::string& url, AsyncLoadMbCallback callback, void* context, const WorkerPriority priority, const Async::CancellationToken& token)
+{
+    Async::CancellationToken flight_token;
+    if (!downloads_by_url.Join(url, {std::move(callback), context, token}, flight_token)) {
+        return; // Already downloading this url
+    }
+    request_scheduler.Submit(url, [url, flight_token](RequestScheduler::Admission admission) {
+        auto response = std::make_shared<std::string>();
         int statusCode = 0;
-        bool ok = Download(url, response, statusCode);
-        EnqueueMainTask([callback, ok, response, context] {
-            callback(ok, response, context);
+        bool ok = DownloadToMemory(url, *response, statusCode, flight_token, std::move(admission));
+        EnqueueMainTask([url, flight_token, ok, response] {
+            for (const auto& waiter : downloads_by_url.Finish(url, flight_token)) {
+                if (!waiter.token.IsCancelled()) {
+                    waiter.callback(ok, *response, waiter.context);
+                }
+            }
         });
-    });
+    }, priority, flight_token);
 }
 
-void Resources::Download(const std::string& url, AsyncLoadMbCallback callback, void* context, std::chrono::seconds cache_duration)
+void Resources::Download(const std::string& url, AsyncLoadMbCallback callback, void* context, std::chrono::seconds cache_duration, const WorkerPriority priority, const Async::CancellationToken& token)
 {
-    EnqueueWorkerTask([url, callback, context, &cache_duration] {
-        const auto get_cache_modified_time = [](const std::filesystem::path& file_name) -> std::optional<std::filesystem::file_time_type> {
-            if (!std::filesystem::exists(file_name)) {
-                return std::optional<std::filesystem::file_time_type>();
+    Async::CancellationToken flight_token;
+    if (!cached_downloads_by_url.Join(url, {std::move(callback), context, token}, flight_token)) {
+        return; // Already fetching this url; the first caller's cache_duration applies
+    }
+    // Hand the (possibly shared) result to everyone still waiting on this url
+    const auto finish = [url, flight_token](const bool ok, std::shared_ptr<const std::string> response) {
+        EnqueueMainTask([url, flight_token, ok, response] {
+            for (const auto& waiter : cached_downloads_by_url.Finish(url, flight_token)) {
+                if (!waiter.token.IsCancelled()) {
+                    waiter.callback(ok, *response, waiter.context);
+                }
             }
-
-            const auto file_time = std::filesystem::last_write_time(file_name);
-            return file_time;
-        };
-
-        const auto load_from_cache = [](const std::filesystem::path& file_name) -> std::optional<std::string> {
-            std::ifstream cache_file(file_name);
-            if (!cache_file.is_open()) {
-                return {};
+        });
+    };
+    EnqueueWorkerTask([url, finish, cache_duration, priority, flight_token] {
+        auto cache_key = HashStr(RemoveProtocol(url));
+        HttpCache::Entry cached;
+        const auto tier = http_cache.Lookup(cache_key, cached);
+        if (tier != HttpCache::Tier::None && time(nullptr) - cached.stored_at < cache_duration.count()) {
+            http_cache.Count(tier == HttpCache::Tier::Memory ? &HttpCacheStats::memory_hits : &HttpCacheStats::disk_hits);
+            finish(cached.IsSuccessful(), cached.body);
+            return;
+        }
+        // Not fresh; only the request itself needs to wait its turn with the host
+        request_scheduler.Submit(url, [url, finish, cache_key = std::move(cache_key), tier, cached = std::move(cached), flight_token](RequestScheduler::Admission admission) mutable {
+            if (flight_token.IsCancelled()) {
+                finish(false, std::make_shared<std::string>());
+                return;
             }
-
-            std::string contents((std::istreambuf_iterator<char>(cache_file)), std::istreambuf_iterator<char>());
-            return contents;
-        };
-
-        const auto save_to_cache = [](const std::filesystem::path& file_name, const std::string& content) -> bool {
-            std::filesystem::create_directories(file_name.parent_path());
-            std::ofstream cache_file(file_name);
-            if (!cache_file.is_open()) {
-                return false;
+            RestClient r;
+            InitRestClient(&r);
+            r.SetMaxDecodedSize(MAX_DOWNLOAD_SIZE_IN_MEMORY);
+            r.SetUrl(url.c_str());
+            if (tier != HttpCache::Tier::None) {
+                // Stale entry; ask the server whether our copy is still good
+                if (!cached.etag.empty()) {
+                    r.SetHeader("If-None-Match", cached.etag.c_str());
+                }
+                if (!cached.last_modified.empty()) {
+                    r.SetHeader("If-Modified-Since", cached.last_modified.c_str());
+                }
             }
-
-            cache_file << content;
-            return true;
-        };
-
-        const auto remove_protocol = [](const std::string& url) -> std::string {
-            const std::string http = "http://";
-            const std::string https = "https://";
-
-            // Check if the URL starts with http:// or https:// and remove it
-            if (url.substr(0, http.size()) == http) {
-                return url.substr(http.size());
+            ExecuteScheduled(r, url, flight_token, std::move(admission));
+            const int status_code = r.GetStatusCode();
+            if (tier != HttpCache::Tier::None && status_code == 304) {
+                http_cache.Revalidated(cache_key, cached, GetResponseHeader(r.GetHeader(), "ETag"), GetResponseHeader(r.GetHeader(), "Last-Modified"));
+                http_cache.Count(&HttpCacheStats::revalidated);
+                finish(cached.IsSuccessful(), cached.body);
+                return;
             }
-            if (url.substr(0, https.size()) == https) {
-                return url.substr(https.size());
+            http_cache.Count(&HttpCacheStats::misses);
+
+            auto response = std::make_shared<std::string>(std::move(r.GetContent()));
+            const bool ok = r.IsSuccessful();
+            if (r.GetStatus() == ResponseStatus::Completed && status_code != 429 && (ok || (status_code >= 300 && status_code < 500))) {
+                HttpCache::Entry entry;
+                entry.etag = GetResponseHeader(r.GetHeader(), "ETag");
+                entry.last_modified = GetResponseHeader(r.GetHeader(), "Last-Modified");
+                entry.status_code = status_code;
+                entry.stored_at = time(nullptr);
+                entry.body = response;
+                http_cache.Store(cache_key, std::move(entry));
             }
-            return url; // Return the original if no match is found
-        };
-        const auto cache_path = Resources::GetPath("cache") / HashStr(remove_protocol(url));
-        const auto expiration = get_cache_modified_time(cache_path);
-        if (expiration.has_value() &&
-            expiration.value() - std::chrono::file_clock::now() < cache_duration) {
-            const auto response = load_from_cache(cache_path);
-            if (response.has_value()) {
-                EnqueueMainTask([callback, context, response] {
-                    callback(true, response.value(), context);
-                });
-                return;
+            if (!ok && response->empty()) {
+                *response = std::format("Failed to download {}, curl status {} {}", url, status_code, r.GetStatusStr());
             }
-        }
-        std::string response;
-        int statusCode = 0;
-        bool ok = Download(url, response, statusCode);
-        if (ok ||
-            (statusCode >= 300 && statusCode < 500)) {
-            save_to_cache(cache_path, response);
-        }
-        EnqueueMainTask([callback, ok, response, context] {
-            callback(ok, response, context);
-        });
+            finish(ok, response);
+        }, priority, flight_token);
     });
 }
 
-bool Resources::Post(const std::string& url, const std::string& payload, std::string& response)
+Resources::HttpCacheStats Resources::GetHttpCacheStats()
 {
-    RestClient r;
-    InitRestClient(&r);
-    r.SetMethod(HttpMethod::Post);
-    r.SetPostContent(payload.c_str(), payload.size(), ContentFlag::ByRef);
+    return http_cache.GetStats();
+}
 
-    std::string content_type = nlohmann::json::accept(payload) ? "application/json" : "application/x-www-form-urlencoded";
-    r.SetHeader("Content-Type", content_type.c_str());
-    r.SetUrl(url.c_str());
-    r.Execute();
-    if (!(r.IsSuccessful() || r.GetStatusCode() == 415)) {
-        StrSprintf(response, "Failed to POST %s, curl status %d %s", url.c_str(), r.GetStatusCode(), r.GetStatusStr());
-        return false;
+Resources::DownloadDedupStats Resources::GetDownloadDedupStats()
+{
+    return {download_requests, download_requests_deduplicated};
+}
+
+std::vector<Resources::HostRequestStats> Resources::GetHostRequestStats()
+{
+    return request_scheduler.GetStats();
+}
+
+namespace {
+    bool PostScheduled(const std::string& url, const std::string& payload, std::string& response, const Async::CancellationToken& token, RequestScheduler::Admission&& admission)
+    {
+        RestClient r;
+        InitRestClient(&r);
+        r.SetMethod(HttpMethod::Post);
+        r.SetPostContent(payload.c_str(), payload.size(), ContentFlag::ByRef);
+
+        std::string content_type = nlohmann::json::accept(payload) ? "application/json" : "application/x-www-form-urlencoded";
+        r.SetHeader("Content-Type", content_type.c_str());
+        r.SetUrl(url.c_str());
+        const bool sent = ExecuteScheduled(r, url, token, std::move(admission));
+        if (token.IsCancelled()) {
+            StrSprintf(response, "POST to %s cancelled", url.c_str());
+            return false;
+        }
+        if (!sent) {
+            StrSprintf(response, "POST to %s refused, the server is busy", url.c_str());
+            return false;
+        }
+        if (!(r.IsSuccessful() || r.GetStatusCode() == 415)) {
+            StrSprintf(response, "Failed to POST %s, curl status %d %s", url.c_str(), r.GetStatusCode(), r.GetStatusStr());
+            return false;
+        }
+        response = std::move(r.GetContent());
+        return true;
     }
-    response = std::move(r.GetContent());
-    return true;
 }
 
-void Resources::Post(const std::string& url, const std::string& payload, AsyncLoadMbCallback callback, void* wparam)
+bool Resources::Post(const std::string& url, const std::string& payload, std::string& response, const Async::CancellationToken& token)
+{
+    return PostScheduled(url, payload, response, token, {});
+}
+
+void Resources::Post(const std::string& url, const std::string& payload, AsyncLoadMbCallback callback, void* wparam, const Async::CancellationToken& token)
 {
-    EnqueueWorkerTask([url, payload, callback, wparam] {
+    request_scheduler.Submit(url, [url, payload, callback, wparam, token](RequestScheduler::Admission admission) {
         std::string response;
-        bool ok = Post(url, payload, response);
-        EnqueueMainTask([callback, ok, response, wparam] {
-            callback(ok, response, wparam);
+        bool ok = PostScheduled(url, payload, response, token, std::move(admission));
+        EnqueueMainTask([callback, ok, response, wparam, token] {
+            if (!token.IsCancelled()) {
+                callback(ok, response, wparam);
+            }
         });
-    });
+    }, WorkerPriority::Background, token);
 }
 
 void Resources::EnsureFileExists(const std::filesystem::path& path_to_file, const std::string& url, const AsyncLoadCallback& callback)
@@ -958,6 +2313,10 @@ void Resources::DxUpdate(IDirect3DDevice9* device)
 
 void Resources::Update(float)
 {
+    downloads_by_url.CancelAbandoned();
+    cached_downloads_by_url.CancelAbandoned();
+    downloads_by_path.CancelAbandoned();
+    request_scheduler.Dispatch();
     main_mutex.lock();
     if (main_jobs.empty()) {
         main_mutex.unlock();
@@ -1054,7 +2413,7 @@ IDirect3DTexture9** Resources::GetGuildWarsWikiImage(const char* filename, size_
     };
     const auto texture = new IDirect3DTexture9*;
     *texture = nullptr;
-    guild_wars_wiki_images[filename] = texture;
+    guild_wars_wiki_images[filename_sanitised] = texture;
     static std::filesystem::path path = GetPath(GUILD_WARS_WIKI_FILES_PATH);
     if (!EnsureFolderExists(path)) {
         trigger_failure_callback(callback, L"Failed to create folder %s", path.wstring().c_str());
@@ -1386,49 +2745,7 @@ IDirect3DTexture9** Resources::GetItemImage(const std::wstring& item_name)
     }
 
     // No local file found; download from wiki via searching by the item name; the wiki will usually return a 302 redirect if its an exact item match
-    const std::string search_str = GuiUtils::WikiUrl(item_name);
-    Instance().Download(search_str, [texture, item_name, callback](const bool ok, const std::string& response, void*) {
-        if (!ok) {
-            callback(ok, TextUtils::StringToWString(response));
-            return;
-        }
-        const std::string item_name_str = TextUtils::WStringToString(item_name);
-        // matches any characters that need to be escaped in RegEx
-        static constexpr ctll::fixed_string SPECIAL_CHARS{R"([\-\[\]{}()*+?.,\^$|#\s])"};
-        const std::string sanitized = TextUtils::ctre_regex_replace<SPECIAL_CHARS, R"(\$&)">(item_name_str);
-        std::smatch m;
-        // Find first png image that has an alt tag matching the html encoded title of the page
-        char regex_str[255];
-        snprintf(regex_str, sizeof(regex_str), R"(<img[^>]+alt=['"][^>]*%s[^>]*['"][^>]+src=['"]([^"']+)([.](png)))", sanitized.c_str());
-        if (!std::regex_search(response, m, std::regex(regex_str))) {
-            // Failed to find via item name; try via page title
-            const std::regex title_finder("<title>(.*) - Guild Wars Wiki.*</title>");
-            if (!std::regex_search(response, m, title_finder)) {
-                trigger_failure_callback(callback, L"Failed to find title HTML for %s from wiki", item_name.c_str());
-                return;
-            }
-            const std::string html_item_name = TextUtils::HtmlEncode(m[1].str());
-            snprintf(regex_str, sizeof(regex_str), R"(<img[^>]+alt=['"][^>]*%s[^>]*['"][^>]+src=['"]([^"']+)([.](png)))", html_item_name.c_str());
-            if (!std::regex_search(response, m, std::regex(regex_str))) {
-                trigger_failure_callback(callback, L"Failed to find image HTML for %s from wiki", item_name.c_str());
-                return;
-            }
-        }
-        const std::string& image_path = m[1].str();
-        const std::string& image_extension = m[2].str();
-        wchar_t path_to_file[MAX_PATH];
-        swprintf(path_to_file, _countof(path_to_file), L"%s\\%s%S", path.c_str(), item_name.c_str(), image_extension.c_str());
-        char url[128];
-        if (strncmp(image_path.c_str(), "http", 4) == 0) {
-            // Image URL is absolute
-            snprintf(url, _countof(url), "%s%s", image_path.c_str(), image_extension.c_str());
-        }
-        else {
-            // Image URL is relative to domain
-            snprintf(url, _countof(url), "https://wiki.guildwars.com%s%s", image_path.c_str(), image_extension.c_str());
-        }
-        LoadTexture(texture, path_to_file, url, callback);
-    });
+    LoadItemImageFromWiki(texture, item_name, path, callback).Detach();
     return texture;
 }
 
@@ -2,6 +2,7 @@
 
 #include <ToolboxModule.h>
 #include <Utf8.h>
+#include <Utils/CancellationToken.h>
 
 namespace GuiUtils {
     class EncString;
@@ -16,6 +17,14 @@ namespace GW {
     }
 }
 
+// Worker lanes, highest priority first. Workers reserved for a lane will also pick up work from any higher priority lane.
+enum class WorkerPriority : uint8_t {
+    Interactive, // User is actively waiting on the result e.g. file dialogs, pathing
+    Background,  // Default; downloads, textures, anything the UI will show when ready
+    Bulk,        // Large or slow jobs that shouldn't hold up anything else e.g. fonts, run history
+    Count
+};
+
 class Resources : public ToolboxModule {
     friend class GWToolbox;
     Resources();
@@ -41,8 +50,24 @@ public:
     void Update(float delta) override;
     static void DxUpdate(IDirect3DDevice9* device);
 
+    using WorkerTask = std::move_only_function<void()>;
+
+    struct WorkerQueueStats {
+        size_t workers = 0;
+        size_t queued = 0;
+        uint64_t enqueued = 0;
+        uint64_t completed = 0;
+        // Time spent waiting in the queue before a worker picked the task up
+        uint64_t total_wait_us = 0;
+        uint64_t max_wait_us = 0;
+        // Time spent running the task
+        uint64_t total_run_us = 0;
+    };
+
     // Enqueue instruction to be called on worker thread, away from the render loop e.g. curl requests
-    static void EnqueueWorkerTask(const std::function<void()>& f);
+    static void EnqueueWorkerTask(WorkerTask&& f, WorkerPriority priority = WorkerPriority::Background);
+    // Snapshot of worker queue metrics for the given lane
+    static WorkerQueueStats GetWorkerQueueStats(WorkerPriority priority);
     // Enqueue instruction to be called on the main update loop of GW
     static void EnqueueMainTask(const std::function<void()>& f);
     // Enqueue instruction to be called on the draw loop of GW e.g. messing with DirectX9 device
@@ -124,10 +149,16 @@ public:
     // Ensure file exists on disk, download from remote location if not found. If an error occurs, details are held in error string
     static void EnsureFileExists(const std::filesystem::path& path_to_file, const std::string& url, const AsyncLoadCallback& callback);
 
+    // Requests that take a CancellationToken are dropped from the queue, or aborted mid-transfer, once it fires; the callback is not called.
+    // A deadline on the token (CancellationToken::WithTimeout) is passed on to curl as the request timeout.
+    // Pass ToolboxModule::GetCancellationToken() to tie a request to the lifetime of the module asking for it.
+
     // download to file, blocking. If an error occurs, details are held in response string
-    static bool Download(const std::filesystem::path& path_to_file, const std::string& url, std::wstring& response);
+    // The body is streamed to <file>.part and only renamed over the destination once complete; an interrupted download is resumed on the next call.
+    // If expected_sha256 (hex) or expected_size are given, the download fails unless the file matches.
+    static bool Download(const std::filesystem::path& path_to_file, const std::string& url, std::wstring& response, const std::string& expected_sha256 = {}, uintmax_t expected_size = 0, const Async::CancellationToken& token = {});
     // download to file, async, calls callback on completion. If an error occurs, details are held in response string
-    void Download(const std::filesystem::path& path_to_file, const std::string& url, const AsyncLoadCallback& callback) const;
+    void Download(const std::filesystem::path& path_to_file, const std::string& url, const AsyncLoadCallback& callback, const std::string& expected_sha256 = {}, uintmax_t expected_size = 0, const Async::CancellationToken& token = {}) const;
     // download to memory, blocking. If an error occurs, details are held in response string
     static bool Download(const std::string& url, std::string& response);
     // Read file on disk
@@ -135,16 +166,57 @@ public:
     // Read file on disk
     static bool ReadFile(const std::filesystem::path& path, std::wstring& response);
     // download to memory, blocking. If an error occurs, details are held in response string
-    static bool Download(const std::string& url, std::string& response, int& statusCode);
+    static bool Download(const std::string& url, std::string& response, int& statusCode, const Async::CancellationToken& token = {});
     // download to memory, async, calls callback on completion. If an error occurs, details are held in response string
-    static void Download(const std::string& url, AsyncLoadMbCallback callback, void* context = nullptr);
+    static void Download(const std::string& url, AsyncLoadMbCallback callback, void* context = nullptr, WorkerPriority priority = WorkerPriority::Background, const Async::CancellationToken& token = {});
     // download to memory, async, calls callback on completion and caches the response locally for the duration specified. If an error occurs, details are held in response string
-    static void Download(const std::string& url, AsyncLoadMbCallback callback, void* context, std::chrono::seconds cache_duration);
+    // Once the duration has passed, the cached copy is revalidated with the server (ETag/Last-Modified) instead of being downloaded again.
+    static void Download(const std::string& url, AsyncLoadMbCallback callback, void* context, std::chrono::seconds cache_duration, WorkerPriority priority = WorkerPriority::Background, const Async::CancellationToken& token = {});
+
+    struct HttpCacheStats {
+        uint64_t memory_hits = 0;
+        uint64_t disk_hits = 0;
+        // Stale entries the server confirmed as unchanged (304 Not Modified)
+        uint64_t revalidated = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t memory_bytes = 0;
+        uint64_t disk_bytes = 0;
+    };
+    static HttpCacheStats GetHttpCacheStats();
+
+    // Concurrent async downloads of the same url (or to the same file) share one transfer
+    struct DownloadDedupStats {
+        uint64_t requests = 0;
+        uint64_t deduplicated = 0;
+    };
+    static DownloadDedupStats GetDownloadDedupStats();
+
+    // All requests go through a per-host scheduler: a token bucket rate limit, a cap on concurrent requests, and a back-off when the server sends 429/Retry-After.
+    // Requests waiting on the same host are let through in WorkerPriority order.
+    struct HostRequestStats {
+        std::string host;
+        size_t in_flight = 0;
+        size_t queued = 0;
+        uint64_t requests = 0;
+        // Responses telling us to back off (429, or 503 with Retry-After)
+        uint64_t throttled = 0;
+        uint64_t retried = 0;
+        // Requests from threads that can't wait for a turn, refused because the host was busy
+        uint64_t rejected = 0;
+        // Time spent queued behind the host's limits
+        uint64_t total_wait_us = 0;
+        uint64_t max_wait_us = 0;
+        float tokens = 0;
+        // Seconds until the host takes requests again
+        float backoff_remaining = 0;
+    };
+    static std::vector<HostRequestStats> GetHostRequestStats();
 
     // download to memory, blocking. If an error occurs, details are held in response string
-    static bool Post(const std::string& url, const std::string& payload, std::string& response);
+    static bool Post(const std::string& url, const std::string& payload, std::string& response, const Async::CancellationToken& token = {});
     // download to memory, async, calls callback on completion. If an error occurs, details are held in response string
-    static void Post(const std::string& url, const std::string& payload, AsyncLoadMbCallback callback, void* wparam = nullptr);
+    static void Post(const std::string& url, const std::string& payload, AsyncLoadMbCallback callback, void* wparam = nullptr, const Async::CancellationToken& token = {});
 
     // Stops the worker thread once it's done with the current jobs.
     void EndLoading() const;
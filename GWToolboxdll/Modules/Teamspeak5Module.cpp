@@ -25,9 +25,9 @@
 
 #include <Modules/Resources.h>
 #include <Modules/Teamspeak5Module.h>
+#include <Modules/WebSocketModule.h>
 #include <Utils/TextUtils.h>
 
-using easywsclient::WebSocket;
 using nlohmann::json;
 using json_vec = std::vector<json>;
 
@@ -44,20 +44,12 @@ namespace {
     const char* gwtoolbox_teamspeak5_name = "GWToolbox++ Teamspeak 5";
     const char* gwtoolbox_teamspeak5_description = "Allows GWToolbox retrieve info from Teamspeak 5";
 
-    enum ConnectionStep : uint8_t {
-        Idle,
-        Connecting,
-        Downloading
-    };
-
-    ConnectionStep step = Idle;
-
     bool enabled = true;
-    bool disconnecting = false;
     bool pending_connect = false;
     bool pending_disconnect = false;
-    WSAData wsaData = {0};
-    WebSocket* websocket = nullptr;
+    // Report the outcome of a connect the user asked for; reconnects after that are silent
+    bool user_invoked_connect = false;
+    WebSocketConnection websocket;
 
     struct TS3Server {
         uint32_t my_client_id = 0;
@@ -125,22 +117,6 @@ namespace {
     }
 
 
-    void DeleteWebSocket()
-    {
-        if (!websocket) {
-            return;
-        }
-        if (websocket->getReadyState() == WebSocket::OPEN) {
-            websocket->close();
-        }
-        disconnecting = true;
-        while (websocket->getReadyState() != WebSocket::CLOSED) {
-            websocket->poll();
-        }
-        delete websocket;
-        websocket = nullptr;
-    }
-
     TS3Server* GetServer(const uint32_t connection_id)
     {
         const auto& found = connected_servers.find(connection_id);
@@ -162,7 +138,7 @@ namespace {
 
     const bool IsConnected()
     {
-        return websocket && websocket->getReadyState() == WebSocket::OPEN;
+        return websocket.IsOpen();
     }
 
     void GetServerInviteLink(TS3Server* server, std::string channel_id, std::function<void(const std::string&)> callback)
@@ -239,50 +215,42 @@ namespace {
         payload["content"] = content;
         packet["payload"] = payload;
 
-        websocket->send(packet.dump());
+        websocket.Send(packet.dump());
     }
 
+    bool OnWebsocketMessage(const std::string& data);
+
     bool Connect(bool user_invoked = false)
     {
         pending_connect = false;
-        if (step == Connecting || IsConnected()) {
-            return true;
-        }
-        if (step == Downloading) {
+        if (!websocket.IsClosed()) {
             return true;
         }
-        step = Connecting;
         if (!enabled) {
-            step = Idle;
-            return false;
-        }
-        int res;
-        if (!wsaData.wVersion && (res = WSAStartup(MAKEWORD(2, 2), &wsaData)) != 0) {
-            if (user_invoked) {
-                Log::Error("Failed to call WSAStartup: %d\n", res);
-            }
-            step = Idle;
             return false;
         }
-        step = Connecting;
-        Resources::EnqueueWorkerTask([user_invoked] {
-            websocket = WebSocket::from_url(GetWebsocketHost());
-            if (websocket == nullptr) {
-                if (user_invoked) {
-                    Log::Error("Couldn't connect to the teamspeak 5 websocket; ensure Teamspeak 5 is running and that the 'Remote Apps' feature is enabled");
-                }
+        user_invoked_connect = user_invoked;
+        WebSocketConnection::Callbacks callbacks;
+        callbacks.on_message = [](const std::string& data) {
+            OnWebsocketMessage(data);
+        };
+        callbacks.on_open = [] {
+            if (user_invoked_connect) {
+                Log::Flash("Teamspeak 5 connected");
+                user_invoked_connect = false;
             }
-            else {
-                if (user_invoked) {
-                    Log::Flash("Teamspeak 5 connected");
-                }
-                SendTeamspeakHandshake();
-                GW::Chat::CreateCommand(&ChatCmd_HookEntry, L"ts", OnTeamspeakCommand);
-                GW::Chat::CreateCommand(&ChatCmd_HookEntry, L"ts5", OnTeamspeakCommand);
+            SendTeamspeakHandshake();
+            GW::Chat::CreateCommand(&ChatCmd_HookEntry, L"ts", OnTeamspeakCommand);
+            GW::Chat::CreateCommand(&ChatCmd_HookEntry, L"ts5", OnTeamspeakCommand);
+        };
+        callbacks.on_close = [](const bool was_open) {
+            if (!was_open && user_invoked_connect) {
+                Log::Error("Couldn't connect to the teamspeak 5 websocket; ensure Teamspeak 5 is running and that the 'Remote Apps' feature is enabled");
             }
-            step = Idle;
-            pending_connect = false;
-        });
+            user_invoked_connect = false;
+        };
+        // Teamspeak 5 is often just not running; connect on load and when asked to, rather than retrying localhost forever
+        websocket.Open(GetWebsocketHost(), std::move(callbacks), {}, false);
         return true;
     }
 
@@ -441,7 +409,7 @@ namespace {
         //Log::Log("%s\n", data.c_str());
         const json& res = json::parse(data.c_str(), nullptr, false);
         if (res == json::value_t::discarded) {
-            Log::Log("ERROR: Failed to parse res JSON from response in websocket->dispatch\n");
+            Log::Log("ERROR: Failed to parse res JSON from response in OnWebsocketMessage\n");
             return false;
         }
         json payload;
@@ -493,11 +461,7 @@ void Teamspeak5Module::Initialize()
 
 void Teamspeak5Module::Terminate()
 {
-    DeleteWebSocket();
-    if (wsaData.wVersion) {
-        WSACleanup();
-        wsaData = {0};
-    }
+    websocket.Close();
     GW::Chat::DeleteCommand(&ChatCmd_HookEntry);
 }
 
@@ -525,34 +489,12 @@ void Teamspeak5Module::Update(float)
         Connect();
         pending_connect = false;
     }
-    if (!enabled && IsConnected()) {
+    if (!enabled && !websocket.IsClosed()) {
         pending_disconnect = true;
     }
     if (pending_disconnect) {
-        if (websocket) {
-            websocket->close();
-        }
+        websocket.Close();
         pending_disconnect = false;
-        return;
-    }
-    if (websocket) {
-        switch (websocket->getReadyState()) {
-            case WebSocket::OPEN:
-                if (pending_connect) {
-                    pending_connect = pending_disconnect = false;
-                    return;
-                }
-            case WebSocket::CLOSING:
-            case WebSocket::CONNECTING:
-                websocket->poll();
-                break;
-            case WebSocket::CLOSED:
-                delete websocket;
-                websocket = nullptr;
-                pending_connect = pending_disconnect = false;
-                return;
-        }
-        websocket->dispatch(OnWebsocketMessage);
     }
 }
 
@@ -575,12 +517,9 @@ void Teamspeak5Module::DrawSettingsInternal()
             if (IsConnected()) {
                 return "Connected";
             }
-            if (step == Connecting) {
+            if (websocket.IsConnecting()) {
                 return "Connecting";
             }
-            if (step == Downloading) {
-                return "Downloading";
-            }
             return "Disconnected";
         };
         if (ImGui::Button(status_str(), ImVec2(0, 0))) {
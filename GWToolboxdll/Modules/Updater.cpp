@@ -1,5 +1,7 @@
 #include "stdafx.h"
 
+#include <DeltaPatch.h>
+
 #include <Utils/GuiUtils.h>
 #include <GWToolbox.h>
 #include <Logger.h>
@@ -44,6 +46,28 @@ namespace {
     GWToolboxRelease latest_release;
     GWToolboxRelease current_release;
 
+    std::wstring GetDllPath()
+    {
+        WCHAR dllfile[MAX_PATH];
+        const DWORD size = GetModuleFileNameW(GWToolbox::GetDLLModule(), dllfile, MAX_PATH);
+        return size ? std::wstring(dllfile, size) : std::wstring();
+    }
+
+    // Name of the asset holding the delta from the installed dll to a release, i.e. GWToolboxdll-<first 16 hex digits of our sha256>.patch
+    const std::string& GetPatchAssetName()
+    {
+        // The dll on disk only changes when we update it, so hash it once
+        static std::string patch_name = [] {
+            std::string sha256;
+            const auto dll_path = GetDllPath();
+            if (dll_path.empty() || !ComputeFileSha256(dll_path.c_str(), sha256)) {
+                return std::string();
+            }
+            return std::format("GWToolboxdll-{}.patch", sha256.substr(0, 16));
+        }();
+        return patch_name;
+    }
+
     GWToolboxRelease* GetLatestRelease(GWToolboxRelease* release)
     {
         // Get list of releases
@@ -100,8 +124,24 @@ namespace {
                 }
                 std::ranges::transform(release->version, release->version.begin(), [](const auto chr) { return static_cast<char>(std::tolower(chr)); });
                 release->body = js["body"].get<std::string>();
+                release->sha256.clear();
+                if (asset.contains("digest") && asset["digest"].is_string()) {
+                    const auto digest = asset["digest"].get<std::string>();
+                    if (digest.starts_with("sha256:")) {
+                        release->sha256 = digest.substr(7);
+                    }
+                }
                 auto size_bytes = asset["size"].get<uintmax_t>(); // Slight rounding, GitHub isn't always correct down to the byte.
                 release->size = static_cast<uintmax_t>(std::ceil(size_bytes / 16.0) * 16);
+                release->patch_url.clear();
+                const auto& patch_name = GetPatchAssetName();
+                for (const Json& patch_asset : js["assets"]) {
+                    if (!patch_name.empty() && patch_asset.value("name", "") == patch_name
+                        && patch_asset.contains("browser_download_url") && patch_asset["browser_download_url"].is_string()) {
+                        release->patch_url = patch_asset["browser_download_url"].get<std::string>();
+                        break;
+                    }
+                }
                 return release;
             }
         }
@@ -127,6 +167,79 @@ namespace {
         return update_available_text;
     }
 
+    // 2. swap the loaded dll out for the new one; a loaded dll can be renamed, but not overwritten
+    void InstallNewDll(const std::wstring& wdll, const std::wstring& dllnew)
+    {
+        const auto dllold = wdll + L".old";
+        Log::LogW(L"moving to %s\n", dllold.c_str());
+        DeleteFileW(dllold.c_str());
+        if (!MoveFileW(wdll.c_str(), dllold.c_str())) {
+            Log::ErrorW(L"Updated error - cannot move %s, err %lu", wdll.c_str(), GetLastError());
+            step = Done;
+            return;
+        }
+        if (!MoveFileW(dllnew.c_str(), wdll.c_str())) {
+            Log::ErrorW(L"Updated error - cannot move %s, err %lu", dllnew.c_str(), GetLastError());
+            MoveFileW(dllold.c_str(), wdll.c_str());
+            step = Done;
+            return;
+        }
+        step = Success;
+        Log::WarningW(L"Update successful, please restart toolbox.");
+    }
+
+    void DownloadFullDll(const std::wstring& wdll, const std::wstring& dllnew)
+    {
+        Resources::Instance().Download(
+            dllnew, latest_release.download_url,
+            [wdll, dllnew](const bool success, const std::wstring& error) -> void {
+                if (!success) {
+                    Log::ErrorW(L"Updated error - cannot download GWToolbox.dll\n%s", error.c_str());
+                    step = Done;
+                    return;
+                }
+                InstallNewDll(wdll, dllnew);
+            }, latest_release.sha256);
+    }
+
+    // Rebuild the new dll from the installed one and the published delta, which is usually a small fraction of the full download.
+    // The result must match the release's sha256; anything else falls back to downloading the whole dll.
+    void DownloadDelta(const std::wstring& wdll, const std::wstring& dllnew)
+    {
+        const auto patch_path = wdll + L".patch";
+        Resources::Instance().Download(
+            patch_path, latest_release.patch_url,
+            [wdll, dllnew, patch_path](const bool success, const std::wstring& error) -> void {
+                if (!success) {
+                    Log::LogW(L"Failed to download update patch, downloading full dll instead\n%s", error.c_str());
+                    DownloadFullDll(wdll, dllnew);
+                    return;
+                }
+                Resources::EnqueueWorkerTask([wdll, dllnew, patch_path, expected_sha256 = latest_release.sha256] {
+                    DeltaPatch patch;
+                    bool applied = patch.Begin(wdll.c_str(), dllnew.c_str()) && patch.ApplyFile(patch_path.c_str());
+                    applied = patch.End() && applied;
+                    if (!applied) {
+                        Log::Log("Failed to apply update patch: %s", patch.GetError().c_str());
+                    }
+                    else if (_stricmp(patch.GetSha256().c_str(), expected_sha256.c_str()) != 0) {
+                        Log::Log("Patched dll has sha256 %s, expected %s", patch.GetSha256().c_str(), expected_sha256.c_str());
+                        applied = false;
+                    }
+                    DeleteFileW(patch_path.c_str());
+                    Resources::EnqueueMainTask([wdll, dllnew, applied] {
+                        if (applied) {
+                            InstallNewDll(wdll, dllnew);
+                        }
+                        else {
+                            DeleteFileW(dllnew.c_str());
+                            DownloadFullDll(wdll, dllnew);
+                        }
+                    });
+                }, WorkerPriority::Interactive);
+            });
+    }
+
     void DoUpdate()
     {
         Log::Warning("Downloading update...");
@@ -162,26 +275,14 @@ namespace {
             return;
         }
 
-        // 1. rename toolbox dll
-        const auto dllold = std::wstring(dllfile) + L".old";
-        Log::Log("moving to %s\n", dllold.c_str());
-        DeleteFileW(dllold.c_str());
-        MoveFileW(dllfile, dllold.c_str());
-
-        // 2. download new dll
-        Resources::Instance().Download(
-            dllfile, latest_release.download_url,
-            [wdll = std::wstring(dllfile), dllold](const bool success, const std::wstring& error) -> void {
-                if (success) {
-                    step = Success;
-                    Log::WarningW(L"Update successful, please restart toolbox.");
-                }
-                else {
-                    Log::ErrorW(L"Updated error - cannot download GWToolbox.dll\n%s", error.c_str());
-                    MoveFileW(dllold.c_str(), wdll.c_str());
-                    step = Done;
-                }
-            });
+        // 1. build the new dll next to the current one; the current dll stays in place until we have a verified replacement
+        const auto dllnew = std::wstring(dllfile) + L".new";
+        if (!latest_release.patch_url.empty() && !latest_release.sha256.empty()) {
+            DownloadDelta(dllfile, dllnew);
+        }
+        else {
+            DownloadFullDll(dllfile, dllnew);
+        }
     }
 }
 
@@ -6,6 +6,10 @@ struct GWToolboxRelease {
     std::string body;
     std::string version;
     std::string download_url;
+    // Hex sha256 of the release asset, if GitHub provided one
+    std::string sha256;
+    // Delta from the installed dll to this release, if one was published
+    std::string patch_url;
     uintmax_t size = 0;
 };
 
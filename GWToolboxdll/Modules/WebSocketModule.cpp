@@ -0,0 +1,453 @@
+#include "stdafx.h"
+
+#include <random>
+
+#include <Modules/Resources.h>
+#include <Modules/WebSocketModule.h>
+
+namespace {
+    using easywsclient::WebSocket;
+    using Clock = std::chrono::steady_clock;
+    using State = WebSocketConnection::State;
+
+    constexpr Clock::duration MIN_BACKOFF = std::chrono::seconds(2);
+    constexpr Clock::duration MAX_BACKOFF = std::chrono::seconds(120);
+    // Longest the I/O thread sleeps when nothing is scheduled; anything else wakes it up
+    constexpr Clock::duration IDLE_WAIT = std::chrono::seconds(1);
+    // How long a socket gets to flush its close frame before it's dropped
+    constexpr Clock::duration CLOSE_TIMEOUT = std::chrono::seconds(2);
+    // How long shutdown waits for connects that are still in flight
+    constexpr Clock::duration SHUTDOWN_TIMEOUT = std::chrono::seconds(5);
+
+    // Lock free, multiple producers and a single consumer.
+    // Producers push with one CAS; the consumer takes everything at once.
+    template <typename T>
+    class MpscQueue {
+        struct Node {
+            T value;
+            Node* next;
+        };
+        std::atomic<Node*> head = nullptr;
+
+    public:
+        MpscQueue() = default;
+        MpscQueue(const MpscQueue&) = delete;
+        ~MpscQueue() { TakeAll(); }
+
+        void Push(T value)
+        {
+            const auto node = new Node{std::move(value), head.load(std::memory_order_relaxed)};
+            while (!head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed)) { }
+        }
+
+        // Everything pushed so far, oldest first
+        std::vector<T> TakeAll()
+        {
+            std::vector<T> out;
+            for (auto node = head.exchange(nullptr, std::memory_order_acquire); node;) {
+                out.push_back(std::move(node->value));
+                delete std::exchange(node, node->next);
+            }
+            std::ranges::reverse(out);
+            return out;
+        }
+    };
+
+    // A loopback UDP socket that's always in the select() set; sending it a byte wakes the I/O thread.
+    // Kept trivially destructible, because connections owned by static objects can still call Wake() on exit.
+    // Atomic because Wake() can be called from any thread while Terminate() closes it.
+    std::atomic<SOCKET> wake_socket = INVALID_SOCKET;
+    std::atomic<bool> wake_pending = false;
+    std::atomic<bool> running = false;
+
+    void Wake()
+    {
+        const SOCKET s = wake_socket;
+        if (s != INVALID_SOCKET && !wake_pending.exchange(true)) {
+            ::send(s, "", 1, 0);
+        }
+    }
+
+    bool CreateWakeSocket()
+    {
+        const SOCKET s = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (s == INVALID_SOCKET) {
+            return false;
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int addr_len = sizeof(addr);
+        u_long non_blocking = 1;
+        // Bind to any free port, then connect to ourselves
+        if (bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR
+            || getsockname(s, reinterpret_cast<sockaddr*>(&addr), &addr_len) == SOCKET_ERROR
+            || connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == SOCKET_ERROR
+            || ioctlsocket(s, FIONBIO, &non_blocking) == SOCKET_ERROR) {
+            closesocket(s);
+            return false;
+        }
+        wake_socket = s;
+        return true;
+    }
+
+    void DrainWakeSocket()
+    {
+        char buf[64];
+        while (recv(wake_socket, buf, sizeof(buf), 0) > 0) { }
+    }
+
+    WSAData wsaData = {0};
+    std::thread* io_thread = nullptr;
+    std::atomic<bool> stopping = false;
+
+    std::atomic<size_t> stat_connections = 0;
+    std::atomic<size_t> stat_open = 0;
+    std::atomic<uint64_t> stat_received = 0;
+    std::atomic<uint64_t> stat_sent = 0;
+    std::atomic<uint64_t> stat_reconnects = 0;
+}
+
+struct WebSocketConnection::Shared {
+    std::string url;
+    easywsclient::HeaderKeyValuePair headers;
+    Callbacks callbacks;
+    bool reconnect = true;
+
+    std::atomic<State> state = State::Connecting;
+    // Set by Close(); the I/O thread tears the socket down, and callbacks already on their way to the main thread are dropped
+    std::atomic<bool> closed_by_owner = false;
+    MpscQueue<std::string> outbox;
+
+    // Handed over by the worker that ran the blocking connect. Whichever of the worker and the exiting I/O thread
+    // sets connect_done second owns the socket; see StartConnect() and the end of IoThreadLoop().
+    WebSocket* connected = nullptr;
+    std::atomic<bool> connect_done = false;
+
+    // Everything below is only touched by the I/O thread
+    WebSocket* socket = nullptr;
+    bool connect_in_flight = false;
+    Clock::time_point next_attempt{};
+    Clock::time_point closing_since{};
+    Clock::duration backoff = MIN_BACKOFF;
+};
+
+namespace {
+    using Shared = WebSocketConnection::Shared;
+
+    MpscQueue<std::shared_ptr<Shared>> incoming;
+    std::vector<std::shared_ptr<Shared>> connections;
+
+    Clock::duration Jitter(const Clock::duration d)
+    {
+        // Spread reconnects out, so every client doesn't hit the server at the same moment after it restarts
+        static thread_local std::minstd_rand rng(std::random_device{}());
+        return std::chrono::duration_cast<Clock::duration>(d * std::uniform_real_distribution(0.75, 1.25)(rng));
+    }
+
+    void StartConnect(const std::shared_ptr<Shared>& c)
+    {
+        c->connect_in_flight = true;
+        // from_url blocks on dns, tcp, tls and the http upgrade; keep that away from the sockets we're already serving
+        Resources::EnqueueWorkerTask([c] {
+            c->connected = WebSocket::from_url(c->url, c->headers);
+            if (c->connect_done.exchange(true, std::memory_order_acq_rel)) {
+                // The I/O thread has already exited and given up on this connect
+                delete std::exchange(c->connected, nullptr);
+                return;
+            }
+            Wake();
+        });
+    }
+
+    void OnOpened(const std::shared_ptr<Shared>& c)
+    {
+        c->state = State::Open;
+        c->backoff = MIN_BACKOFF;
+        Resources::EnqueueMainTask([c] {
+            if (!c->closed_by_owner && c->callbacks.on_open) {
+                c->callbacks.on_open();
+            }
+        });
+    }
+
+    void OnDropped(const std::shared_ptr<Shared>& c, const bool was_open, const Clock::time_point now)
+    {
+        c->outbox.TakeAll(); // Whatever was queued was meant for the connection that just went away
+        if (c->reconnect) {
+            c->state = State::Connecting;
+            c->next_attempt = now + Jitter(c->backoff);
+            c->backoff = std::min(c->backoff * 2, MAX_BACKOFF);
+            stat_reconnects++;
+        }
+        else {
+            c->state = State::Closed;
+        }
+        Resources::EnqueueMainTask([c, was_open] {
+            if (!c->closed_by_owner && c->callbacks.on_close) {
+                c->callbacks.on_close(was_open);
+            }
+        });
+    }
+
+    // Advances one connection; returns false once it's finished with
+    bool Step(const std::shared_ptr<Shared>& c, const Clock::time_point now, Clock::time_point& wait_until)
+    {
+        const bool closing = c->closed_by_owner || stopping;
+        if (closing && c->closing_since == Clock::time_point{}) {
+            c->closing_since = now;
+        }
+
+        if (c->connect_in_flight && c->connect_done.load(std::memory_order_acquire)) {
+            c->connect_in_flight = false;
+            c->connect_done = false;
+            c->socket = std::exchange(c->connected, nullptr);
+            if (!(c->socket && c->socket->getReadyState() == WebSocket::OPEN)) {
+                delete c->socket;
+                c->socket = nullptr;
+                if (!closing) {
+                    OnDropped(c, false, now);
+                }
+            }
+            else if (!closing) {
+                OnOpened(c);
+            }
+        }
+
+        if (c->socket) {
+            // Flush before closing, so anything sent before Close() still goes out
+            if (c->socket->getReadyState() == WebSocket::OPEN) {
+                const auto messages = c->outbox.TakeAll();
+                for (const auto& message : messages) {
+                    c->socket->send(message);
+                }
+                stat_sent += messages.size();
+                if (closing) {
+                    c->socket->close();
+                }
+            }
+            c->socket->poll(0);
+
+            std::vector<std::string> received;
+            c->socket->dispatch([&received](const std::string& message) {
+                received.push_back(message);
+            });
+            if (!received.empty() && !closing) {
+                stat_received += received.size();
+                Resources::EnqueueMainTask([c, received = std::move(received)] {
+                    if (c->closed_by_owner || !c->callbacks.on_message) {
+                        return;
+                    }
+                    for (const auto& message : received) {
+                        c->callbacks.on_message(message);
+                    }
+                });
+            }
+
+            if (c->socket->getReadyState() == WebSocket::CLOSED) {
+                delete c->socket;
+                c->socket = nullptr;
+                if (!closing) {
+                    OnDropped(c, true, now);
+                }
+            }
+            else if (closing && now - c->closing_since > CLOSE_TIMEOUT) {
+                delete c->socket;
+                c->socket = nullptr;
+            }
+        }
+
+        if (closing) {
+            if (!c->socket && !c->connect_in_flight) {
+                c->state = State::Closed;
+                return false;
+            }
+            return true;
+        }
+        if (!c->socket && !c->connect_in_flight) {
+            if (c->state != State::Connecting) {
+                return false; // Dropped, and not reconnecting
+            }
+            if (now >= c->next_attempt) {
+                StartConnect(c);
+            }
+            else {
+                wait_until = std::min(wait_until, c->next_attempt);
+            }
+        }
+        return true;
+    }
+
+    // Waits until any socket has something to read (or room to write, if we're waiting to flush), or until wait_until
+    void Select(const Clock::time_point now, const Clock::time_point wait_until)
+    {
+        fd_set rfds;
+        fd_set wfds;
+        FD_ZERO(&rfds);
+        FD_ZERO(&wfds);
+        FD_SET(wake_socket.load(), &rfds);
+        for (const auto& c : connections) {
+            if (!c->socket) {
+                continue;
+            }
+            const auto fd = static_cast<SOCKET>(c->socket->getSocket());
+            if (fd == INVALID_SOCKET || rfds.fd_count >= FD_SETSIZE) {
+                continue;
+            }
+            FD_SET(fd, &rfds);
+            // Covers the close frame too; a closing socket is closed as soon as its send buffer is empty
+            if (c->socket->hasPendingTx()) {
+                FD_SET(fd, &wfds);
+            }
+        }
+        const auto wait_us = std::chrono::duration_cast<std::chrono::microseconds>(std::clamp(wait_until - now, Clock::duration::zero(), IDLE_WAIT)).count();
+        timeval tv = {static_cast<long>(wait_us / 1000000), static_cast<long>(wait_us % 1000000)};
+        select(0, &rfds, &wfds, nullptr, &tv);
+    }
+
+    void IoThreadLoop()
+    {
+        std::optional<Clock::time_point> give_up_at;
+        while (true) {
+            // Clear before draining, so a Wake() that races with this iteration still wakes the next select
+            wake_pending = false;
+            DrainWakeSocket();
+            for (auto& c : incoming.TakeAll()) {
+                connections.push_back(std::move(c));
+            }
+
+            const auto now = Clock::now();
+            if (stopping && !give_up_at) {
+                give_up_at = now + SHUTDOWN_TIMEOUT;
+            }
+            auto wait_until = now + IDLE_WAIT;
+            size_t open = 0;
+            std::erase_if(connections, [&](const std::shared_ptr<Shared>& c) {
+                const bool keep = Step(c, now, wait_until);
+                open += c->state == State::Open;
+                return !keep;
+            });
+            stat_connections = connections.size();
+            stat_open = open;
+
+            if (stopping && (connections.empty() || now >= *give_up_at)) {
+                break;
+            }
+            Select(now, wait_until);
+        }
+        // Not worth holding up shutdown for connects still in flight; the worker deletes the socket when it gets one
+        for (const auto& c : connections) {
+            delete c->socket;
+            c->socket = nullptr;
+            if (c->connect_in_flight && c->connect_done.exchange(true, std::memory_order_acq_rel)) {
+                delete std::exchange(c->connected, nullptr);
+            }
+            c->state = State::Closed;
+        }
+        connections.clear();
+        for (const auto& c : incoming.TakeAll()) {
+            c->state = State::Closed;
+        }
+        stat_connections = stat_open = 0;
+        running = false;
+    }
+}
+
+WebSocketConnection::~WebSocketConnection()
+{
+    Close();
+}
+
+void WebSocketConnection::Open(const std::string& url, Callbacks callbacks, easywsclient::HeaderKeyValuePair headers, const bool reconnect)
+{
+    Close();
+    shared = std::make_shared<Shared>();
+    shared->url = url;
+    shared->headers = std::move(headers);
+    shared->callbacks = std::move(callbacks);
+    shared->reconnect = reconnect;
+    if (!running || stopping) {
+        shared->state = State::Closed;
+        return;
+    }
+    incoming.Push(shared);
+    Wake();
+}
+
+void WebSocketConnection::Close()
+{
+    if (!shared) {
+        return;
+    }
+    shared->closed_by_owner = true;
+    shared.reset();
+    Wake();
+}
+
+void WebSocketConnection::Send(std::string message)
+{
+    if (!shared || shared->state == State::Closed) {
+        return;
+    }
+    shared->outbox.Push(std::move(message));
+    Wake();
+}
+
+WebSocketConnection::State WebSocketConnection::GetState() const
+{
+    return shared ? shared->state.load() : State::Closed;
+}
+
+void WebSocketModule::Initialize()
+{
+    ToolboxModule::Initialize();
+    int res;
+    if (!wsaData.wVersion && (res = WSAStartup(MAKEWORD(2, 2), &wsaData)) != 0) {
+        Log::Error("Failed to call WSAStartup: %d", res);
+        return;
+    }
+    if (!CreateWakeSocket()) {
+        Log::Error("Failed to create websocket wake socket: %d", WSAGetLastError());
+        return;
+    }
+    stopping = false;
+    running = true;
+    io_thread = new std::thread(IoThreadLoop);
+}
+
+void WebSocketModule::SignalTerminate()
+{
+    ToolboxModule::SignalTerminate();
+    stopping = true;
+    Wake();
+}
+
+bool WebSocketModule::CanTerminate()
+{
+    return !running;
+}
+
+void WebSocketModule::Terminate()
+{
+    ToolboxModule::Terminate();
+    stopping = true;
+    Wake();
+    if (io_thread) {
+        ASSERT(io_thread->joinable());
+        io_thread->join();
+        delete io_thread;
+        io_thread = nullptr;
+    }
+    if (const SOCKET s = wake_socket.exchange(INVALID_SOCKET); s != INVALID_SOCKET) {
+        closesocket(s);
+    }
+    if (wsaData.wVersion) {
+        WSACleanup();
+        wsaData = {0};
+    }
+}
+
+WebSocketModule::Stats WebSocketModule::GetStats()
+{
+    return {stat_connections, stat_open, stat_received, stat_sent, stat_reconnects};
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <ToolboxModule.h>
+
+// A websocket owned by a module, run by WebSocketModule's I/O thread.
+// Send() can be called from any thread; callbacks are called on the game's main update loop.
+// Opened with reconnect, the connection is re-established with exponential backoff whenever it drops or fails to connect, until Close()
+// is called. Without it, the connection stays closed and it's up to the owner to open it again.
+class WebSocketConnection {
+public:
+    enum class State : uint8_t {
+        Closed,     // Not opened, closed by the owner, or dropped without reconnecting
+        Connecting, // Connect in flight, or waiting to retry
+        Open
+    };
+
+    struct Callbacks {
+        std::function<void(const std::string& message)> on_message;
+        std::function<void()> on_open;
+        // Called when a connect attempt fails, or an open connection drops; not called after Close().
+        std::function<void(bool was_open)> on_close;
+    };
+
+    struct Shared;
+
+    WebSocketConnection() = default;
+    WebSocketConnection(const WebSocketConnection&) = delete;
+    WebSocketConnection& operator=(const WebSocketConnection&) = delete;
+    ~WebSocketConnection();
+
+    // Closes any existing connection first
+    void Open(const std::string& url, Callbacks callbacks, easywsclient::HeaderKeyValuePair headers = {}, bool reconnect = true);
+    // Anything already passed to Send() is still flushed before the socket is closed.
+    void Close();
+    // Queued until the connection is open; dropped if the connection closes first.
+    void Send(std::string message);
+
+    [[nodiscard]] State GetState() const;
+    [[nodiscard]] bool IsOpen() const { return GetState() == State::Open; }
+    [[nodiscard]] bool IsConnecting() const { return GetState() == State::Connecting; }
+    [[nodiscard]] bool IsClosed() const { return GetState() == State::Closed; }
+
+private:
+    std::shared_ptr<Shared> shared;
+};
+
+// Multiplexes every WebSocketConnection with a single select() on one thread, instead of each module polling its own socket.
+class WebSocketModule : public ToolboxModule {
+    WebSocketModule() = default;
+    ~WebSocketModule() override = default;
+
+public:
+    static WebSocketModule& Instance()
+    {
+        static WebSocketModule instance;
+        return instance;
+    }
+
+    [[nodiscard]] const char* Name() const override { return "WebSockets"; }
+    bool HasSettings() override { return false; }
+
+    void Initialize() override;
+    void Terminate() override;
+    void SignalTerminate() override;
+    bool CanTerminate() override;
+
+    struct Stats {
+        size_t connections = 0;
+        size_t open = 0;
+        uint64_t messages_received = 0;
+        uint64_t messages_sent = 0;
+        uint64_t reconnects = 0;
+    };
+    static Stats GetStats();
+};
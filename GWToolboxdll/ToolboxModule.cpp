@@ -22,6 +22,7 @@ void ToolboxModule::Initialize()
 
 void ToolboxModule::Terminate()
 {
+    CancelAsyncWork();
     // Remove any settings draw callbacks associated with this module
     auto callbacks_it = settings_draw_callbacks.begin();
     while (callbacks_it != settings_draw_callbacks.end()) {
@@ -43,6 +44,12 @@ void ToolboxModule::Terminate()
     }
 }
 
+void ToolboxModule::CancelAsyncWork()
+{
+    async_work.Cancel();
+    async_work = {};
+}
+
 void ToolboxModule::RegisterSettingsContent()
 {
     if (!HasSettings()) {
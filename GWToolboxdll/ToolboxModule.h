@@ -1,5 +1,7 @@
 #pragma once
 
+#include <Utils/CancellationToken.h>
+
 using SectionDrawCallback = std::function<void(const std::string& section, bool is_showing)>;
 class ToolboxModule;
 
@@ -84,7 +86,15 @@ public:
     void RegisterSettingsContent(
         const char* section, const char* icon, const SectionDrawCallback& callback, float weighting);
 
+    // Token for async work done on behalf of this module e.g. Resources::Download. Fires when the module is terminated, or on CancelAsyncWork().
+    [[nodiscard]] Async::CancellationToken GetCancellationToken() const { return async_work.Token(); }
+    // Drop any pending or in-flight work started with a token from GetCancellationToken(); their callbacks won't be called.
+    void CancelAsyncWork();
+
 protected:
     // Weighting used to decide where to position the DrawSettingInternal() for this module. Useful when more than 1 module has the same SettingsName().
     virtual float SettingsWeighting() { return 1.0f; }
+
+private:
+    Async::CancellationSource async_work;
 };
@@ -0,0 +1,137 @@
+#pragma once
+
+// Multi-pattern substring search. Add() every pattern, Build() once, then any text can be searched for all of them in a single pass,
+// however many patterns there are.
+// Matching is exact; for case-insensitive search, add folded patterns and pass the same fold to Contains()/Scan().
+template <typename CharT>
+class AhoCorasick {
+public:
+    using State = uint32_t;
+    static constexpr uint32_t NoPattern = 0xffffffff;
+
+    struct NoFold {
+        constexpr CharT operator()(const CharT c) const { return c; }
+    };
+
+    void Clear()
+    {
+        nodes.assign(1, {});
+        pattern_lengths.clear();
+    }
+
+    // Returns the pattern's id; adding the same pattern twice returns the same id. Empty patterns are ignored and return NoPattern.
+    uint32_t Add(const std::basic_string_view<CharT> pattern)
+    {
+        if (pattern.empty()) return NoPattern;
+        State state = Root();
+        for (const auto c : pattern) {
+            auto& edges = nodes[state].edges;
+            const auto it = std::ranges::lower_bound(edges, c, {}, &Edge::first);
+            if (it != edges.end() && it->first == c) {
+                state = it->second;
+                continue;
+            }
+            const auto next = static_cast<State>(nodes.size());
+            edges.insert(it, {c, next});
+            nodes.emplace_back(); // Invalidates edges
+            state = next;
+        }
+        auto& node = nodes[state];
+        if (node.pattern == NoPattern) {
+            node.pattern = static_cast<uint32_t>(pattern_lengths.size());
+            pattern_lengths.push_back(pattern.size());
+        }
+        return node.pattern;
+    }
+
+    // Links up the patterns added so far; call again after adding more
+    void Build()
+    {
+        std::vector<State> queue;
+        queue.reserve(nodes.size());
+        for (const auto& [c, child] : nodes[Root()].edges) {
+            nodes[child].fail = Root();
+            nodes[child].output = NoState;
+            queue.push_back(child);
+        }
+        for (size_t i = 0; i < queue.size(); i++) {
+            const auto parent = queue[i];
+            for (const auto& [c, child] : nodes[parent].edges) {
+                const auto fail = Next(nodes[parent].fail, c);
+                nodes[child].fail = fail;
+                nodes[child].output = nodes[fail].pattern != NoPattern ? fail : nodes[fail].output;
+                queue.push_back(child);
+            }
+        }
+    }
+
+    [[nodiscard]] bool empty() const { return pattern_lengths.empty(); }
+    [[nodiscard]] size_t size() const { return pattern_lengths.size(); }
+    [[nodiscard]] size_t PatternLength(const uint32_t id) const { return pattern_lengths[id]; }
+
+    // Step-by-step interface, for callers that fold or decode the text as they go
+    [[nodiscard]] static constexpr State Root() { return 0; }
+
+    [[nodiscard]] State Next(State state, const CharT c) const
+    {
+        while (true) {
+            const auto& edges = nodes[state].edges;
+            const auto it = std::ranges::lower_bound(edges, c, {}, &Edge::first);
+            if (it != edges.end() && it->first == c) return it->second;
+            if (state == Root()) return Root();
+            state = nodes[state].fail;
+        }
+    }
+
+    // True if any pattern ends after the character that led to this state
+    [[nodiscard]] bool IsMatch(const State state) const { return nodes[state].pattern != NoPattern || nodes[state].output != NoState; }
+
+    // Calls fn(pattern_id) for each pattern ending at this state, longest first; fn returns false to stop. Returns false if stopped.
+    template <typename Fn>
+    bool ForEachMatch(const State state, Fn&& fn) const
+    {
+        if (nodes[state].pattern != NoPattern && !fn(nodes[state].pattern)) return false;
+        for (auto s = nodes[state].output; s != NoState; s = nodes[s].output) {
+            if (!fn(nodes[s].pattern)) return false;
+        }
+        return true;
+    }
+
+    template <typename Fold = NoFold>
+    [[nodiscard]] bool Contains(const std::basic_string_view<CharT> text, Fold fold = {}) const
+    {
+        if (empty()) return false;
+        State state = Root();
+        for (const auto c : text) {
+            state = Next(state, fold(c));
+            if (IsMatch(state)) return true;
+        }
+        return false;
+    }
+
+    // Calls fn(pattern_id, end) for every occurrence in text, where end is the offset just past the occurrence; fn returns false to stop.
+    template <typename Fn, typename Fold = NoFold>
+    void Scan(const std::basic_string_view<CharT> text, Fn&& fn, Fold fold = {}) const
+    {
+        if (empty()) return;
+        State state = Root();
+        for (size_t i = 0; i < text.size(); i++) {
+            state = Next(state, fold(text[i]));
+            if (IsMatch(state) && !ForEachMatch(state, [&fn, i](const uint32_t id) { return fn(id, i + 1); })) return;
+        }
+    }
+
+private:
+    static constexpr State NoState = 0xffffffff;
+    using Edge = std::pair<CharT, State>;
+
+    struct Node {
+        std::vector<Edge> edges; // Sorted by character
+        State fail = 0;
+        State output = NoState;        // Next state along the fail links where a pattern ends
+        uint32_t pattern = NoPattern;  // Pattern ending exactly here
+    };
+
+    std::vector<Node> nodes = std::vector<Node>(1);
+    std::vector<size_t> pattern_lengths;
+};
@@ -0,0 +1,47 @@
+#include "stdafx.h"
+
+#include "AlertList.h"
+
+namespace {
+    char FoldAscii(const char c)
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    bool IsRegexLine(const std::string_view line)
+    {
+        const auto last_slash = line.rfind('/');
+        return line.starts_with('/') && last_slash != 0
+               && (last_slash + 1 == line.size() || (last_slash + 2 == line.size() && isalpha(static_cast<unsigned char>(line.back()))));
+    }
+}
+
+void AlertList::Compile(const std::string_view text)
+{
+    words.Clear();
+    regexes.Clear();
+    std::istringstream stream{std::string(text)};
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        if (IsRegexLine(line)) {
+            // Left as typed: folding it would turn \W \D \S \B into \w \d \s \b. RegexSet ignores case itself.
+            try {
+                regexes.Add(std::string_view(line).substr(1, line.rfind('/') - 1), RegexSet::IgnoreCase);
+            } catch (const std::regex_error&) {
+                // Silent fail; invalid regex
+            }
+            continue;
+        }
+        std::ranges::transform(line, line.begin(), FoldAscii);
+        words.Add(line);
+    }
+    words.Build();
+}
+
+bool AlertList::Matches(const std::string_view message) const
+{
+    return words.Contains(message, FoldAscii) || regexes.Search(message);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "AhoCorasick.h"
+#include "RegexSet.h"
+
+// The alert keywords typed into TradeWindow and PartySearchWindow, compiled once so each message is checked in one pass for the plain
+// words and one for the regular expressions, however long the list is.
+// One alert per line. "/pattern/", with an optional flag letter after it that's ignored, is a regular expression; anything else is a
+// substring. Both are case-insensitive. Blank lines and invalid regular expressions are skipped.
+class AlertList {
+public:
+    // Replaces whatever was compiled before
+    void Compile(std::string_view text);
+
+    // True if any alert is found in message
+    [[nodiscard]] bool Matches(std::string_view message) const;
+
+    [[nodiscard]] bool empty() const { return words.empty() && regexes.empty(); }
+
+private:
+    AhoCorasick<char> words; // Case-folded
+    RegexSet regexes;
+};
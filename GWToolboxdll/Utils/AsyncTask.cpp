@@ -0,0 +1,42 @@
+#include "stdafx.h"
+
+#include <Logger.h>
+
+#include "AsyncTask.h"
+
+void Async::Detail::PromiseBase::ReportDetachedError() const noexcept
+{
+    if (!error) {
+        return;
+    }
+    try {
+        std::rethrow_exception(error);
+    }
+    catch (const OperationCancelled&) {
+        // Expected; whoever cancelled it no longer wants the result
+    }
+    catch (const std::exception& e) {
+        Log::Error("Unhandled exception in async task: %s", e.what());
+    }
+    catch (...) {
+        Log::Error("Unhandled exception in async task");
+    }
+}
+
+Async::Task<Async::HttpResult> Async::Download(std::string url, CancellationToken token, const WorkerPriority priority)
+{
+    co_await ResumeOnWorker{token, priority};
+    HttpResult result;
+    result.ok = Resources::Download(url, result.body, result.status_code, token);
+    token.ThrowIfCancelled();
+    co_return std::move(result);
+}
+
+Async::Task<Async::HttpResult> Async::Post(std::string url, std::string payload, CancellationToken token, const WorkerPriority priority)
+{
+    co_await ResumeOnWorker{token, priority};
+    HttpResult result;
+    result.ok = Resources::Post(url, payload, result.body, token);
+    token.ThrowIfCancelled();
+    co_return std::move(result);
+}
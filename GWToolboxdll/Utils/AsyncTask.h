@@ -0,0 +1,230 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+
+#include <Modules/Resources.h>
+#include <Utils/CancellationToken.h>
+
+// Coroutine support for chaining work across the worker pool, the game loop and the render loop without nesting callbacks.
+//
+//  Async::Task<> LoadThing(std::string url, Async::CancellationToken token) {
+//      auto page = co_await Async::Download(url, token); // Runs on a worker thread
+//      ... parse page.body here, still on the worker ...
+//      co_await Async::ResumeOnMain{token};             // Continue in the game loop
+//      ...
+//  }
+//  LoadThing(url, token).Detach();
+//
+// Tasks are lazy; nothing runs until the task is awaited or detached. Exceptions propagate to whoever awaits the task.
+// Take coroutine parameters by value; references are not kept alive across a suspension.
+namespace Async {
+    template <typename T = void>
+    class Task;
+
+    namespace Detail {
+        struct PromiseBase {
+            std::coroutine_handle<> continuation;
+            std::exception_ptr error;
+            bool detached = false;
+
+            struct FinalAwaiter {
+                [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+                template <typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+                {
+                    auto& promise = handle.promise();
+                    if (promise.continuation) {
+                        return promise.continuation;
+                    }
+                    if (promise.detached) {
+                        promise.ReportDetachedError();
+                        handle.destroy();
+                    }
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept { }
+            };
+
+            [[nodiscard]] std::suspend_always initial_suspend() const noexcept { return {}; }
+            [[nodiscard]] FinalAwaiter final_suspend() const noexcept { return {}; }
+            void unhandled_exception() noexcept { error = std::current_exception(); }
+
+            // Logs any error that escaped a detached task, other than cancellation
+            void ReportDetachedError() const noexcept;
+        };
+
+        template <typename T>
+        struct Promise : PromiseBase {
+            std::optional<T> value;
+
+            Task<T> get_return_object() noexcept;
+
+            template <typename U>
+            void return_value(U&& result) { value.emplace(std::forward<U>(result)); }
+
+            T TakeResult()
+            {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+                return std::move(*value);
+            }
+        };
+
+        template <>
+        struct Promise<void> : PromiseBase {
+            Task<void> get_return_object() noexcept;
+
+            void return_void() const noexcept { }
+
+            void TakeResult() const
+            {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+            }
+        };
+    }
+
+    template <typename T>
+    class [[nodiscard]] Task {
+    public:
+        using promise_type = Detail::Promise<T>;
+
+        explicit Task(std::coroutine_handle<promise_type> _handle)
+            : handle(_handle) { }
+
+        Task(Task&& other) noexcept
+            : handle(std::exchange(other.handle, {})) { }
+
+        Task& operator=(Task&& other) noexcept
+        {
+            if (this != &other) {
+                if (handle) {
+                    handle.destroy();
+                }
+                handle = std::exchange(other.handle, {});
+            }
+            return *this;
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        ~Task()
+        {
+            if (handle) {
+                handle.destroy();
+            }
+        }
+
+        auto operator co_await() && noexcept
+        {
+            struct Awaiter {
+                std::coroutine_handle<promise_type> handle;
+
+                [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) const noexcept
+                {
+                    handle.promise().continuation = awaiting;
+                    return handle;
+                }
+
+                T await_resume() const { return handle.promise().TakeResult(); }
+            };
+            return Awaiter{handle};
+        }
+
+        // Start the task without anyone awaiting it; the coroutine frees itself when it finishes.
+        void Detach() &&
+        {
+            const auto h = std::exchange(handle, {});
+            h.promise().detached = true;
+            h.resume();
+        }
+
+    private:
+        std::coroutine_handle<promise_type> handle;
+    };
+
+    template <typename T>
+    Task<T> Detail::Promise<T>::get_return_object() noexcept
+    {
+        return Task<T>(std::coroutine_handle<Promise>::from_promise(*this));
+    }
+
+    inline Task<void> Detail::Promise<void>::get_return_object() noexcept
+    {
+        return Task<void>(std::coroutine_handle<Promise>::from_promise(*this));
+    }
+
+    // co_await to continue on a Resources worker thread
+    struct ResumeOnWorker {
+        CancellationToken token;
+        WorkerPriority priority = WorkerPriority::Background;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) const
+        {
+            Resources::EnqueueWorkerTask([handle] { handle.resume(); }, priority);
+        }
+
+        void await_resume() const { token.ThrowIfCancelled(); }
+    };
+
+    // co_await to continue in the game's main update loop
+    struct ResumeOnMain {
+        CancellationToken token;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle) const
+        {
+            Resources::EnqueueMainTask([handle] { handle.resume(); });
+        }
+
+        void await_resume() const { token.ThrowIfCancelled(); }
+    };
+
+    // co_await to continue in the render loop; evaluates to the DirectX device
+    struct ResumeOnDx {
+        CancellationToken token;
+        IDirect3DDevice9* device = nullptr;
+
+        [[nodiscard]] bool await_ready() const noexcept { return false; }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            Resources::EnqueueDxTask([this, handle](IDirect3DDevice9* _device) {
+                device = _device;
+                handle.resume();
+            });
+        }
+
+        IDirect3DDevice9* await_resume() const
+        {
+            token.ThrowIfCancelled();
+            return device;
+        }
+    };
+
+    struct HttpResult {
+        bool ok = false;
+        int status_code = 0;
+        // Response body, or error details if !ok
+        std::string body;
+    };
+
+    // Blocking download performed on a worker thread; the body is moved through to the awaiting coroutine, never copied.
+    // The transfer is aborted if token fires, and any deadline on token becomes the request timeout.
+    // The awaiting coroutine continues on that worker thread.
+    Task<HttpResult> Download(std::string url, CancellationToken token = {}, WorkerPriority priority = WorkerPriority::Background);
+    // As above, but POSTs payload
+    Task<HttpResult> Post(std::string url, std::string payload, CancellationToken token = {}, WorkerPriority priority = WorkerPriority::Background);
+}
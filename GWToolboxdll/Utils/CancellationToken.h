@@ -0,0 +1,68 @@
+#pragma once
+
+// Lets the owner of some async work tell it to stop, e.g. a window that has closed or a map that has changed.
+// A token can also carry a deadline, after which it counts as cancelled.
+namespace Async {
+    // Thrown from an awaiter when its cancellation token has fired; detached tasks swallow it silently.
+    struct OperationCancelled : std::exception {
+        [[nodiscard]] const char* what() const noexcept override { return "Operation cancelled"; }
+    };
+
+    class CancellationToken {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        // A default constructed token is never cancelled
+        CancellationToken() = default;
+
+        [[nodiscard]] bool IsCancelled() const
+        {
+            if (state && state->load()) {
+                return true;
+            }
+            return deadline != Clock::time_point::max() && Clock::now() >= deadline;
+        }
+
+        void ThrowIfCancelled() const
+        {
+            if (IsCancelled()) {
+                throw OperationCancelled();
+            }
+        }
+
+        // Copy of this token that also fires once timeout has passed
+        [[nodiscard]] CancellationToken WithTimeout(const Clock::duration timeout) const
+        {
+            auto out = *this;
+            out.deadline = std::min(deadline, Clock::now() + timeout);
+            return out;
+        }
+
+        // False for a default constructed token, which never fires
+        [[nodiscard]] bool CanBeCancelled() const { return state || HasDeadline(); }
+        [[nodiscard]] bool HasDeadline() const { return deadline != Clock::time_point::max(); }
+        [[nodiscard]] Clock::time_point GetDeadline() const { return deadline; }
+
+    private:
+        friend class CancellationSource;
+
+        explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> _state)
+            : state(std::move(_state)) { }
+
+        std::shared_ptr<const std::atomic<bool>> state;
+        Clock::time_point deadline = Clock::time_point::max();
+    };
+
+    // Owner side of a cancellation token; hand out Token() to the work you may want to stop.
+    class CancellationSource {
+    public:
+        void Cancel() const { *state = true; }
+        [[nodiscard]] bool IsCancelled() const { return *state; }
+        [[nodiscard]] CancellationToken Token() const { return CancellationToken(state); }
+        // Whether token was handed out by this source
+        [[nodiscard]] bool Issued(const CancellationToken& token) const { return token.state == state; }
+
+    private:
+        std::shared_ptr<std::atomic<bool>> state = std::make_shared<std::atomic<bool>>(false);
+    };
+}
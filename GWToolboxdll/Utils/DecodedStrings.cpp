@@ -0,0 +1,278 @@
+#include "stdafx.h"
+
+#include <shared_mutex>
+
+#include <GWCA/Constants/Constants.h>
+#include <GWCA/Managers/MemoryMgr.h>
+
+#include "DecodedStrings.h"
+
+namespace {
+    constexpr uint32_t FILE_MAGIC = 'SDWG';
+    constexpr uint32_t FILE_VERSION = 1;
+    constexpr size_t CHUNK_SIZE = 0x10000;
+    // Plenty for every name in the game in a couple of languages; stops the file growing without bound
+    constexpr size_t MAX_ENTRIES = 0x40000;
+    constexpr uint8_t NO_LANGUAGE = 0xff;
+
+    // File layout: FileHeader, then the offset just past each string in the pool, then the entries, then the pool itself.
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t gw_version;
+        uint32_t string_count;
+        uint32_t entry_count;
+        uint32_t pool_length; // In wchar_t
+    };
+
+    struct FileEntry {
+        uint32_t encoded; // String index
+        uint32_t decoded; // String index
+        uint32_t language;
+    };
+
+    std::shared_mutex mutex;
+    // Interned strings point into these; a chunk is never moved or freed until Clear()
+    std::vector<std::unique_ptr<wchar_t[]>> chunks;
+    wchar_t* chunk_next = nullptr; // Free space at the end of the last chunk
+    size_t chunk_remaining = 0;
+    std::vector<std::wstring_view> strings;
+    std::unordered_map<std::wstring_view, uint32_t> string_ids;
+    // Encoded string index and language -> decoded string index
+    std::unordered_map<uint64_t, uint32_t> decoded_by_key;
+    std::atomic_bool dirty = false;
+
+    uint64_t Key(const uint32_t encoded, const uint8_t language)
+    {
+        return static_cast<uint64_t>(encoded) << 8 | language;
+    }
+
+    uint32_t Intern(const std::wstring_view str)
+    {
+        const auto found = string_ids.find(str);
+        if (found != string_ids.end()) {
+            return found->second;
+        }
+        if (str.size() > chunk_remaining) {
+            const auto capacity = std::max(str.size(), CHUNK_SIZE);
+            chunks.push_back(std::make_unique<wchar_t[]>(capacity));
+            chunk_next = chunks.back().get();
+            chunk_remaining = capacity;
+        }
+        const std::wstring_view interned(chunk_next, str.size());
+        std::ranges::copy(str, chunk_next);
+        chunk_next += str.size();
+        chunk_remaining -= str.size();
+        const auto id = static_cast<uint32_t>(strings.size());
+        strings.push_back(interned);
+        string_ids.emplace(interned, id);
+        return id;
+    }
+
+    void ClearUnlocked()
+    {
+        decoded_by_key.clear();
+        string_ids.clear();
+        strings.clear();
+        chunks.clear();
+        chunk_next = nullptr;
+        chunk_remaining = 0;
+        dirty = false;
+    }
+
+    bool Parse(const uint8_t* data, const size_t size)
+    {
+        FileHeader header{};
+        if (size < sizeof(header)) {
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+        if (header.magic != FILE_MAGIC || header.version != FILE_VERSION || header.gw_version != GW::MemoryMgr::GetGWVersion()) {
+            return false;
+        }
+        const auto ends_size = static_cast<uint64_t>(header.string_count) * sizeof(uint32_t);
+        const auto entries_size = static_cast<uint64_t>(header.entry_count) * sizeof(FileEntry);
+        const auto pool_size = static_cast<uint64_t>(header.pool_length) * sizeof(wchar_t);
+        if (sizeof(header) + ends_size + entries_size + pool_size != size) {
+            return false;
+        }
+        const auto ends = reinterpret_cast<const uint32_t*>(data + sizeof(header));
+        const auto entries = reinterpret_cast<const FileEntry*>(data + sizeof(header) + ends_size);
+        const auto pool = reinterpret_cast<const wchar_t*>(data + sizeof(header) + ends_size + entries_size);
+
+        // The whole pool is one chunk; interned strings point straight into it
+        auto chunk = std::make_unique<wchar_t[]>(std::max<size_t>(header.pool_length, 1));
+        std::copy_n(pool, header.pool_length, chunk.get());
+        strings.reserve(header.string_count);
+        string_ids.reserve(header.string_count);
+        uint32_t start = 0;
+        for (uint32_t i = 0; i < header.string_count; i++) {
+            if (ends[i] < start || ends[i] > header.pool_length) {
+                return false;
+            }
+            const std::wstring_view str(chunk.get() + start, ends[i] - start);
+            if (!string_ids.emplace(str, i).second) {
+                return false;
+            }
+            strings.push_back(str);
+            start = ends[i];
+        }
+        chunks.push_back(std::move(chunk));
+        chunk_next = nullptr;
+        chunk_remaining = 0;
+
+        decoded_by_key.reserve(header.entry_count);
+        for (uint32_t i = 0; i < header.entry_count; i++) {
+            const auto& entry = entries[i];
+            if (entry.encoded >= header.string_count || entry.decoded >= header.string_count || entry.language >= NO_LANGUAGE) {
+                return false;
+            }
+            decoded_by_key[Key(entry.encoded, static_cast<uint8_t>(entry.language))] = entry.decoded;
+        }
+        return true;
+    }
+}
+
+bool DecodedStrings::Find(const std::wstring_view encoded, const GW::Constants::Language language, std::wstring& out)
+{
+    const auto language_id = static_cast<uint32_t>(language);
+    if (language_id >= NO_LANGUAGE) {
+        return false;
+    }
+    std::shared_lock lock(mutex);
+    const auto encoded_id = string_ids.find(encoded);
+    if (encoded_id == string_ids.end()) {
+        return false;
+    }
+    const auto found = decoded_by_key.find(Key(encoded_id->second, static_cast<uint8_t>(language_id)));
+    if (found == decoded_by_key.end()) {
+        return false;
+    }
+    out.assign(strings[found->second]);
+    return true;
+}
+
+void DecodedStrings::Add(const std::wstring_view encoded, const GW::Constants::Language language, const std::wstring_view decoded)
+{
+    const auto language_id = static_cast<uint32_t>(language);
+    if (language_id >= NO_LANGUAGE || encoded.empty() || decoded.empty()) {
+        return;
+    }
+    if (encoded.find(static_cast<wchar_t>(0x107)) != std::wstring_view::npos) {
+        return; // Contains literal text
+    }
+    std::unique_lock lock(mutex);
+    if (decoded_by_key.size() >= MAX_ENTRIES) {
+        return;
+    }
+    const auto key = Key(Intern(encoded), static_cast<uint8_t>(language_id));
+    const auto decoded_id = Intern(decoded);
+    const auto [it, inserted] = decoded_by_key.emplace(key, decoded_id);
+    if (inserted || it->second != decoded_id) {
+        it->second = decoded_id;
+        dirty = true;
+    }
+}
+
+bool DecodedStrings::Load(const std::filesystem::path& path)
+{
+    const auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER file_size{};
+    HANDLE mapping = nullptr;
+    const void* view = nullptr;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart >= static_cast<LONGLONG>(sizeof(FileHeader))) {
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    if (mapping) {
+        view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+    bool ok = false;
+    if (view) {
+        std::unique_lock lock(mutex);
+        ClearUnlocked();
+        ok = Parse(static_cast<const uint8_t*>(view), static_cast<size_t>(file_size.QuadPart));
+        if (!ok) {
+            ClearUnlocked();
+        }
+        UnmapViewOfFile(view);
+    }
+    if (mapping) {
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+    if (!ok) {
+        Log::Log("Decoded string cache %ls is out of date or invalid, ignoring it", path.filename().c_str());
+    }
+    return ok;
+}
+
+bool DecodedStrings::Save(const std::filesystem::path& path)
+{
+    std::shared_lock lock(mutex);
+    if (!dirty.exchange(false)) {
+        return true;
+    }
+    FileHeader header{
+        .magic = FILE_MAGIC,
+        .version = FILE_VERSION,
+        .gw_version = GW::MemoryMgr::GetGWVersion(),
+        .string_count = static_cast<uint32_t>(strings.size()),
+        .entry_count = static_cast<uint32_t>(decoded_by_key.size()),
+        .pool_length = 0
+    };
+    std::vector<uint32_t> ends;
+    ends.reserve(strings.size());
+    for (const auto& str : strings) {
+        header.pool_length += static_cast<uint32_t>(str.size());
+        ends.push_back(header.pool_length);
+    }
+    std::vector<FileEntry> entries;
+    entries.reserve(decoded_by_key.size());
+    for (const auto& [key, decoded] : decoded_by_key) {
+        entries.push_back({static_cast<uint32_t>(key >> 8), decoded, static_cast<uint32_t>(key & 0xff)});
+    }
+
+    // Written alongside and moved into place, so a crash part way through leaves the old file
+    auto tmp_path = path;
+    tmp_path += L".tmp";
+    const auto file = _wfopen(tmp_path.c_str(), L"wb");
+    if (!file) {
+        Log::Log("Failed to open decoded string cache for writing, %d", errno);
+        dirty = true;
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+              && fwrite(ends.data(), sizeof(uint32_t), ends.size(), file) == ends.size()
+              && fwrite(entries.data(), sizeof(FileEntry), entries.size(), file) == entries.size();
+    for (size_t i = 0; ok && i < strings.size(); i++) {
+        ok = fwrite(strings[i].data(), sizeof(wchar_t), strings[i].size(), file) == strings[i].size();
+    }
+    ok = fclose(file) == 0 && ok;
+    std::error_code ec;
+    if (ok) {
+        std::filesystem::rename(tmp_path, path, ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        std::filesystem::remove(tmp_path, ec);
+        Log::Log("Failed to write decoded string cache");
+        dirty = true;
+        return false;
+    }
+    return true;
+}
+
+void DecodedStrings::Clear()
+{
+    std::unique_lock lock(mutex);
+    ClearUnlocked();
+}
+
+size_t DecodedStrings::size()
+{
+    std::shared_lock lock(mutex);
+    return decoded_by_key.size();
+}
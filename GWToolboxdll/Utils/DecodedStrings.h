@@ -0,0 +1,24 @@
+#pragma once
+
+namespace GW::Constants {
+    enum class Language;
+}
+
+// Decoded text of encoded strings, by language, kept between sessions so map, skill and item names are there from the first frame
+// instead of each one waiting on a round trip through the game's decoder.
+// Encoded and decoded strings are interned, so a name shared by many ids is stored once. Saved to a compact binary file; a file written
+// by a different build of the game is ignored, in case its text has changed.
+// Any function can be called from any thread.
+namespace DecodedStrings {
+    // Returns false if it isn't known; language must be an actual language, not 0xff
+    bool Find(std::wstring_view encoded, GW::Constants::Language language, std::wstring& out);
+    // Strings containing literal text (player names, chat) aren't kept
+    void Add(std::wstring_view encoded, GW::Constants::Language language, std::wstring_view decoded);
+
+    bool Load(const std::filesystem::path& path);
+    // Does nothing if nothing has been added since the last load or save
+    bool Save(const std::filesystem::path& path);
+    void Clear();
+
+    [[nodiscard]] size_t size();
+}
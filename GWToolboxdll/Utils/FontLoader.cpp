@@ -481,7 +481,7 @@ namespace FontLoader {
         fonts_loading = true;
         fonts_loaded = false;
 
-        Resources::EnqueueWorkerTask(LoadFontsThread);
+        Resources::EnqueueWorkerTask(LoadFontsThread, WorkerPriority::Bulk);
     }
 
     void Terminate()
@@ -10,6 +10,7 @@
 #include <Modules/Resources.h>
 
 #include "GuiUtils.h"
+#include <Utils/DecodedStrings.h>
 #include <Utils/TextUtils.h>
 
 namespace {
@@ -496,6 +497,11 @@ namespace GuiUtils {
 
     void EncString::decode() {
         if (!decoded && !decoding && !encoded_ws.empty()) {
+            decoding_language = language_id == static_cast<GW::Constants::Language>(0xff) ? GW::UI::GetTextLanguage() : language_id;
+            if (DecodedStrings::Find(encoded_ws, decoding_language, decoded_ws)) {
+                decoded = true;
+                return;
+            }
             decoding = true;
             GW::GameThread::Enqueue([&] {
                 GW::UI::AsyncDecodeStr(encoded_ws.c_str(), OnStringDecoded, this, language_id);
@@ -540,6 +546,7 @@ namespace GuiUtils {
         }
         if (decoded && decoded[0]) {
             context->decoded_ws = decoded;
+            DecodedStrings::Add(context->encoded_ws, context->decoding_language, context->decoded_ws);
         }
         context->decoded = true;
         context->decoding = false;
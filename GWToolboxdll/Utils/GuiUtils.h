@@ -99,6 +99,8 @@ namespace GuiUtils {
         virtual void sanitise();
         virtual void decode();
         GW::Constants::Language language_id = static_cast<GW::Constants::Language>(0xff);
+        // language_id, or the game's language if that's 0xff, when decode() was called
+        GW::Constants::Language decoding_language = static_cast<GW::Constants::Language>(0xff);
         static void OnStringDecoded(void* param, const wchar_t* decoded);
 
     public:
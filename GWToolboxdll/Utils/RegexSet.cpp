@@ -0,0 +1,786 @@
+#include "stdafx.h"
+
+#include "RegexSet.h"
+
+namespace {
+    namespace regex_constants = std::regex_constants;
+
+    constexpr uint32_t Unbounded = 0xffffffff;
+    constexpr uint32_t MAX_REPEAT = 1000;         // e.g. a{1000}
+    constexpr size_t MAX_PROGRAM_SIZE = 1 << 17; // Instructions, across every pattern in the set
+    constexpr size_t MAX_NESTING = 256;
+    constexpr size_t MAX_DFA_STATES = 1024; // The cache starts over once it has this many
+
+    template <typename CharT>
+    uint32_t CodeUnit(const CharT c)
+    {
+        return static_cast<std::make_unsigned_t<CharT>>(c);
+    }
+
+    // Narrow text is UTF-8 or the like, so only ASCII has case there; the same as std::regex under the "C" locale
+    template <typename CharT>
+    uint32_t Lower(const uint32_t c)
+    {
+        if constexpr (sizeof(CharT) == 1) {
+            return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+        }
+        else {
+            return c <= 0xffff ? towlower(static_cast<wint_t>(c)) : c;
+        }
+    }
+
+    template <typename CharT>
+    uint32_t Upper(const uint32_t c)
+    {
+        if constexpr (sizeof(CharT) == 1) {
+            return c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c;
+        }
+        else {
+            return c <= 0xffff ? towupper(static_cast<wint_t>(c)) : c;
+        }
+    }
+
+    bool IsWordChar(const uint32_t c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    bool IsLineTerminator(const uint32_t c)
+    {
+        return c == '\n' || c == '\r' || c == 0x2028 || c == 0x2029;
+    }
+
+    using Range = std::pair<uint32_t, uint32_t>; // Inclusive
+
+    constexpr auto digit_ranges = std::to_array<Range>({{'0', '9'}});
+    constexpr auto word_ranges = std::to_array<Range>({{'0', '9'}, {'A', 'Z'}, {'_', '_'}, {'a', 'z'}});
+    constexpr auto space_ranges = std::to_array<Range>({
+        {'\t', '\r'}, {' ', ' '}, {0xa0, 0xa0}, {0x1680, 0x1680}, {0x2000, 0x200a}, {0x2028, 0x2029}, {0x202f, 0x202f}, {0x205f, 0x205f},
+        {0x3000, 0x3000}, {0xfeff, 0xfeff}
+    });
+
+    struct CharClass {
+        std::vector<Range> ranges; // Sorted and merged once parsed
+        bool negated = false;
+        bool icase = false;
+
+        void Normalize()
+        {
+            std::ranges::sort(ranges);
+            std::vector<Range> merged;
+            for (const auto& range : ranges) {
+                if (!merged.empty() && range.first <= merged.back().second + 1) {
+                    merged.back().second = std::max(merged.back().second, range.second);
+                }
+                else {
+                    merged.push_back(range);
+                }
+            }
+            ranges = std::move(merged);
+        }
+
+        [[nodiscard]] bool Contains(const uint32_t c) const
+        {
+            const auto it = std::ranges::upper_bound(ranges, c, {}, &Range::first);
+            return it != ranges.begin() && std::prev(it)->second >= c;
+        }
+
+        template <typename CharT>
+        [[nodiscard]] bool Matches(const uint32_t c) const
+        {
+            const bool found = Contains(c) || (icase && (Contains(Lower<CharT>(c)) || Contains(Upper<CharT>(c))));
+            return found != negated;
+        }
+    };
+
+    struct Node {
+        enum class Kind : uint8_t { Empty, Char, Any, Class, Begin, End, WordBoundary, NotWordBoundary, Concat, Alternate, Repeat };
+        Kind kind = Kind::Empty;
+        uint32_t value = 0; // Char: the character; Class: index into the program's classes
+        uint32_t min = 0;   // Repeat
+        uint32_t max = 0;
+        std::vector<Node> children;
+
+        // Initializes every member; braces around just the first few leave the rest out, which -Wextra warns about
+        static Node Make(const Kind kind, const uint32_t value = 0, const uint32_t min = 0, const uint32_t max = 0)
+        {
+            return {kind, value, min, max, {}};
+        }
+
+        [[nodiscard]] bool IsAssertion() const
+        {
+            return kind == Kind::Begin || kind == Kind::End || kind == Kind::WordBoundary || kind == Kind::NotWordBoundary;
+        }
+    };
+
+    // Recursive descent over the ECMAScript grammar, minus what can't be matched without backtracking
+    class Parser {
+    public:
+        Parser(std::vector<uint32_t>&& _pattern, std::vector<CharClass>& _classes, const bool _icase)
+            : pattern(std::move(_pattern)),
+              classes(_classes),
+              icase(_icase) {}
+
+        Node Parse()
+        {
+            auto node = ParseAlternate();
+            if (!AtEnd()) throw std::regex_error(regex_constants::error_paren); // Unmatched )
+            return node;
+        }
+
+    private:
+        std::vector<uint32_t> pattern;
+        std::vector<CharClass>& classes;
+        bool icase;
+        size_t pos = 0;
+        size_t depth = 0;
+
+        [[nodiscard]] bool AtEnd() const { return pos >= pattern.size(); }
+        [[nodiscard]] uint32_t Peek(const size_t ahead = 0) const { return pos + ahead < pattern.size() ? pattern[pos + ahead] : 0; }
+        uint32_t Next() { return pattern[pos++]; }
+
+        bool Consume(const uint32_t c)
+        {
+            if (AtEnd() || pattern[pos] != c) return false;
+            pos++;
+            return true;
+        }
+
+        Node ParseAlternate()
+        {
+            if (++depth > MAX_NESTING) throw std::regex_error(regex_constants::error_stack);
+            auto first = ParseConcat();
+            if (Consume('|')) {
+                auto alternate = Node::Make(Node::Kind::Alternate);
+                alternate.children.push_back(std::move(first));
+                do {
+                    alternate.children.push_back(ParseConcat());
+                } while (Consume('|'));
+                first = std::move(alternate);
+            }
+            depth--;
+            return first;
+        }
+
+        Node ParseConcat()
+        {
+            auto concat = Node::Make(Node::Kind::Concat);
+            while (!AtEnd() && Peek() != '|' && Peek() != ')') {
+                concat.children.push_back(ParseRepeat());
+            }
+            if (concat.children.size() == 1) return std::move(concat.children[0]);
+            return concat;
+        }
+
+        static bool IsQuantifier(const uint32_t c) { return c == '*' || c == '+' || c == '?' || c == '{'; }
+
+        uint32_t ParseNumber()
+        {
+            if (AtEnd() || Peek() < '0' || Peek() > '9') throw std::regex_error(regex_constants::error_badbrace);
+            uint32_t n = 0;
+            while (!AtEnd() && Peek() >= '0' && Peek() <= '9') {
+                n = std::min(n * 10 + (Next() - '0'), MAX_REPEAT + 1);
+            }
+            return n;
+        }
+
+        Node ParseRepeat()
+        {
+            const bool grouped = Peek() == '(';
+            auto atom = ParseAtom();
+            if (AtEnd() || !IsQuantifier(Peek())) return atom;
+
+            uint32_t min = 0, max = Unbounded;
+            switch (Next()) {
+                case '*':
+                    break;
+                case '+':
+                    min = 1;
+                    break;
+                case '?':
+                    max = 1;
+                    break;
+                default: // {n}, {n,}, {n,m}
+                    min = max = ParseNumber();
+                    if (Consume(',')) {
+                        max = Peek() == '}' ? Unbounded : ParseNumber();
+                    }
+                    if (!Consume('}')) throw std::regex_error(regex_constants::error_brace);
+                    if (max < min) throw std::regex_error(regex_constants::error_badbrace);
+                    if (min > MAX_REPEAT || (max != Unbounded && max > MAX_REPEAT)) throw std::regex_error(regex_constants::error_complexity);
+                    break;
+            }
+            // \b* is a syntax error, but (?:\b)* isn't
+            if (atom.IsAssertion() && !grouped) throw std::regex_error(regex_constants::error_badrepeat);
+            Consume('?'); // Lazy; matches the same
+            if (!AtEnd() && IsQuantifier(Peek())) throw std::regex_error(regex_constants::error_badrepeat);
+
+            auto repeat = Node::Make(Node::Kind::Repeat, 0, min, max);
+            repeat.children.push_back(std::move(atom));
+            return repeat;
+        }
+
+        Node ParseAtom()
+        {
+            const auto c = Next();
+            switch (c) {
+                case '(': {
+                    if (Consume('?') && !Consume(':')) throw std::regex_error(regex_constants::error_complexity); // Lookaround
+                    auto inner = ParseAlternate();
+                    if (!Consume(')')) throw std::regex_error(regex_constants::error_paren);
+                    return inner;
+                }
+                case '[':
+                    return ParseClass();
+                case '.':
+                    return Node::Make(Node::Kind::Any);
+                case '^':
+                    return Node::Make(Node::Kind::Begin);
+                case '$':
+                    return Node::Make(Node::Kind::End);
+                case '\\':
+                    return ParseEscape();
+                case '*':
+                case '+':
+                case '?':
+                case '{':
+                    throw std::regex_error(regex_constants::error_badrepeat);
+                default:
+                    return Node::Make(Node::Kind::Char, c);
+            }
+        }
+
+        Node ClassNode(CharClass&& cls)
+        {
+            cls.icase = icase;
+            cls.Normalize();
+            classes.push_back(std::move(cls));
+            return Node::Make(Node::Kind::Class, static_cast<uint32_t>(classes.size() - 1));
+        }
+
+        static std::span<const Range> Shorthand(const uint32_t c)
+        {
+            switch (c) {
+                case 'd':
+                case 'D':
+                    return digit_ranges;
+                case 'w':
+                case 'W':
+                    return word_ranges;
+                case 's':
+                case 'S':
+                    return space_ranges;
+                default:
+                    return {};
+            }
+        }
+
+        static bool IsShorthand(const uint32_t c) { return !Shorthand(c).empty(); }
+
+        Node ParseEscape()
+        {
+            if (AtEnd()) throw std::regex_error(regex_constants::error_escape);
+            const auto c = Next();
+            if (c == 'b') return Node::Make(Node::Kind::WordBoundary);
+            if (c == 'B') return Node::Make(Node::Kind::NotWordBoundary);
+            if (IsShorthand(c)) {
+                const auto ranges = Shorthand(c);
+                CharClass cls;
+                cls.ranges.assign(ranges.begin(), ranges.end());
+                cls.negated = c == 'D' || c == 'W' || c == 'S';
+                return ClassNode(std::move(cls));
+            }
+            if (c >= '1' && c <= '9') throw std::regex_error(regex_constants::error_backref);
+            return Node::Make(Node::Kind::Char, ParseCharacterEscape(c));
+        }
+
+        uint32_t ParseHex(const size_t digits)
+        {
+            uint32_t value = 0;
+            for (size_t i = 0; i < digits; i++) {
+                const auto c = AtEnd() ? 0 : Next();
+                value <<= 4;
+                if (c >= '0' && c <= '9') value |= c - '0';
+                else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+                else throw std::regex_error(regex_constants::error_escape);
+            }
+            return value;
+        }
+
+        // The character after a backslash that isn't a class or assertion
+        uint32_t ParseCharacterEscape(const uint32_t c)
+        {
+            switch (c) {
+                case 't':
+                    return '\t';
+                case 'n':
+                    return '\n';
+                case 'r':
+                    return '\r';
+                case 'f':
+                    return '\f';
+                case 'v':
+                    return '\v';
+                case '0':
+                    if (Peek() >= '0' && Peek() <= '9') throw std::regex_error(regex_constants::error_escape);
+                    return 0;
+                case 'x':
+                    return ParseHex(2);
+                case 'u':
+                    return ParseHex(4);
+                case 'c': {
+                    const auto letter = Peek();
+                    if (!((letter >= 'a' && letter <= 'z') || (letter >= 'A' && letter <= 'Z'))) throw std::regex_error(regex_constants::error_escape);
+                    return Next() % 32;
+                }
+                default:
+                    return c; // Identity escape
+            }
+        }
+
+        // Returns false if the atom was a class escape, which has already been added to cls
+        bool ParseClassAtom(CharClass& cls, uint32_t& c)
+        {
+            c = Next();
+            if (c != '\\') return true;
+            if (AtEnd()) throw std::regex_error(regex_constants::error_escape);
+            c = Next();
+            if (IsShorthand(c)) {
+                const auto ranges = Shorthand(c);
+                if (c == 'd' || c == 'w' || c == 's') {
+                    cls.ranges.insert(cls.ranges.end(), ranges.begin(), ranges.end());
+                    return false;
+                }
+                // Complement
+                uint32_t from = 0;
+                for (const auto& [first, last] : ranges) {
+                    if (first > from) cls.ranges.emplace_back(from, first - 1);
+                    from = last + 1;
+                }
+                cls.ranges.emplace_back(from, Unbounded - 1);
+                return false;
+            }
+            if (c == 'b') {
+                c = '\b';
+                return true;
+            }
+            if (c >= '1' && c <= '9') throw std::regex_error(regex_constants::error_escape);
+            c = ParseCharacterEscape(c);
+            return true;
+        }
+
+        Node ParseClass()
+        {
+            CharClass cls;
+            cls.negated = Consume('^');
+            // [] never matches and [^] matches anything, as in ECMAScript
+            while (true) {
+                if (AtEnd()) throw std::regex_error(regex_constants::error_brack);
+                if (Consume(']')) break;
+                uint32_t first;
+                if (!ParseClassAtom(cls, first)) {
+                    continue;
+                }
+                if (Peek() == '-' && pos + 1 < pattern.size() && Peek(1) != ']') {
+                    Next();
+                    uint32_t last;
+                    if (!ParseClassAtom(cls, last)) {
+                        // e.g. [a-\d]; the - is literal
+                        cls.ranges.emplace_back(first, first);
+                        cls.ranges.emplace_back('-', '-');
+                        continue;
+                    }
+                    if (last < first) throw std::regex_error(regex_constants::error_range);
+                    cls.ranges.emplace_back(first, last);
+                    continue;
+                }
+                cls.ranges.emplace_back(first, first);
+            }
+            return ClassNode(std::move(cls));
+        }
+    };
+
+    enum class Op : uint8_t {
+        Char,
+        CharIgnoreCase,
+        Any,
+        Class,
+        Split, // Continue at both x and y
+        Jump,  // Continue at x
+        Match,
+        Begin,
+        End,
+        WordBoundary,
+        NotWordBoundary
+    };
+
+    struct Inst {
+        Op op;
+        uint32_t x = 0;
+        uint32_t y = 0;
+    };
+}
+
+struct RegexSet::Program {
+    std::vector<Inst> insts;
+    std::vector<CharClass> classes;
+    std::vector<uint32_t> starts; // First instruction of each pattern
+
+    // Reused between steps so they don't allocate
+    struct Scratch {
+        std::vector<uint32_t> marks; // Generation an instruction was last visited in
+        uint32_t generation = 0;
+        std::vector<uint32_t> stack;
+        std::vector<uint32_t> consuming;
+    };
+
+    // Where in the text a step is being taken
+    struct Position {
+        bool at_start;
+        bool prev_word;
+    };
+
+    static constexpr int32_t Unknown = -1;
+    static constexpr int32_t Matched = -2;
+
+    struct DfaState {
+        std::vector<uint32_t> kernel; // Instructions reached by the last character; every pattern's start is implied
+        Position position;
+        std::array<int32_t, 128> ascii_next;
+        std::unordered_map<uint32_t, int32_t> other_next;
+        int32_t match_at_end = Unknown;
+    };
+
+    // One per character width, since case folding differs
+    struct Dfa {
+        std::vector<std::unique_ptr<DfaState>> states;
+        std::map<std::vector<uint32_t>, int32_t> ids; // Kernel + position -> state
+        Scratch scratch;
+
+        void Reset()
+        {
+            states.clear();
+            ids.clear();
+        }
+    };
+
+    mutable std::mutex dfa_mutex;
+    mutable Dfa narrow_dfa;
+    mutable Dfa wide_dfa;
+
+    void Emit(const Node& node, const bool icase)
+    {
+        const auto push = [this](const Inst& inst) {
+            if (insts.size() >= MAX_PROGRAM_SIZE) throw std::regex_error(regex_constants::error_complexity);
+            insts.push_back(inst);
+            return static_cast<uint32_t>(insts.size() - 1);
+        };
+        switch (node.kind) {
+            case Node::Kind::Empty:
+                break;
+            case Node::Kind::Char:
+                push({icase && Lower<wchar_t>(node.value) != Upper<wchar_t>(node.value) ? Op::CharIgnoreCase : Op::Char, node.value});
+                break;
+            case Node::Kind::Any:
+                push({Op::Any});
+                break;
+            case Node::Kind::Class:
+                push({Op::Class, node.value});
+                break;
+            case Node::Kind::Begin:
+                push({Op::Begin});
+                break;
+            case Node::Kind::End:
+                push({Op::End});
+                break;
+            case Node::Kind::WordBoundary:
+                push({Op::WordBoundary});
+                break;
+            case Node::Kind::NotWordBoundary:
+                push({Op::NotWordBoundary});
+                break;
+            case Node::Kind::Concat:
+                for (const auto& child : node.children) {
+                    Emit(child, icase);
+                }
+                break;
+            case Node::Kind::Alternate: {
+                std::vector<uint32_t> jumps;
+                for (size_t i = 0; i < node.children.size(); i++) {
+                    if (i + 1 == node.children.size()) {
+                        Emit(node.children[i], icase);
+                        break;
+                    }
+                    const auto split = push({Op::Split});
+                    insts[split].x = split + 1;
+                    Emit(node.children[i], icase);
+                    jumps.push_back(push({Op::Jump}));
+                    insts[split].y = static_cast<uint32_t>(insts.size());
+                }
+                for (const auto jump : jumps) {
+                    insts[jump].x = static_cast<uint32_t>(insts.size());
+                }
+            } break;
+            case Node::Kind::Repeat: {
+                const auto& child = node.children[0];
+                for (uint32_t i = 0; i < node.min; i++) {
+                    Emit(child, icase);
+                }
+                if (node.max == Unbounded) {
+                    const auto split = push({Op::Split});
+                    insts[split].x = split + 1;
+                    Emit(child, icase);
+                    push({Op::Jump, split});
+                    insts[split].y = static_cast<uint32_t>(insts.size());
+                    break;
+                }
+                std::vector<uint32_t> splits;
+                for (uint32_t i = node.min; i < node.max; i++) {
+                    const auto split = push({Op::Split});
+                    insts[split].x = split + 1;
+                    splits.push_back(split);
+                    Emit(child, icase);
+                }
+                for (const auto split : splits) {
+                    insts[split].y = static_cast<uint32_t>(insts.size());
+                }
+            } break;
+        }
+    }
+
+    void Add(std::vector<uint32_t>&& pattern, const uint8_t flags)
+    {
+        const bool icase = flags & IgnoreCase;
+        const auto classes_before = classes.size();
+        const auto insts_before = insts.size();
+        try {
+            const auto root = Parser(std::move(pattern), classes, icase).Parse();
+            const auto start = static_cast<uint32_t>(insts.size());
+            Emit(root, icase);
+            insts.push_back({Op::Match});
+            starts.push_back(start);
+        } catch (const std::regex_error&) {
+            classes.resize(classes_before);
+            insts.resize(insts_before);
+            throw;
+        }
+        std::lock_guard lock(dfa_mutex);
+        narrow_dfa.Reset();
+        wide_dfa.Reset();
+    }
+
+    template <typename CharT>
+    [[nodiscard]] bool Consumes(const Inst& inst, const uint32_t c) const
+    {
+        switch (inst.op) {
+            case Op::Char:
+                return c == inst.x;
+            case Op::CharIgnoreCase:
+                return c == inst.x || Lower<CharT>(c) == Lower<CharT>(inst.x);
+            case Op::Any:
+                return !IsLineTerminator(c);
+            case Op::Class:
+                return classes[inst.x].Matches<CharT>(c);
+            default:
+                return false;
+        }
+    }
+
+    // Follows every split, jump and assertion from the kernel; fills scratch.consuming with the instructions that consume a character.
+    // Returns true if a pattern matches here.
+    bool Closure(const std::vector<uint32_t>& kernel, const Position& position, const bool at_end, const bool next_word, Scratch& scratch) const
+    {
+        if (scratch.marks.size() < insts.size()) {
+            scratch.marks.resize(insts.size());
+        }
+        if (++scratch.generation == 0) {
+            std::ranges::fill(scratch.marks, 0u);
+            scratch.generation = 1;
+        }
+        scratch.consuming.clear();
+        scratch.stack.assign(kernel.begin(), kernel.end());
+        scratch.stack.insert(scratch.stack.end(), starts.begin(), starts.end());
+        while (!scratch.stack.empty()) {
+            const auto pc = scratch.stack.back();
+            scratch.stack.pop_back();
+            if (scratch.marks[pc] == scratch.generation) continue;
+            scratch.marks[pc] = scratch.generation;
+            const auto& inst = insts[pc];
+            switch (inst.op) {
+                case Op::Split:
+                    scratch.stack.push_back(inst.y);
+                    scratch.stack.push_back(inst.x);
+                    break;
+                case Op::Jump:
+                    scratch.stack.push_back(inst.x);
+                    break;
+                case Op::Match:
+                    return true;
+                case Op::Begin:
+                    if (position.at_start) scratch.stack.push_back(pc + 1);
+                    break;
+                case Op::End:
+                    if (at_end) scratch.stack.push_back(pc + 1);
+                    break;
+                case Op::WordBoundary:
+                    if (position.prev_word != next_word) scratch.stack.push_back(pc + 1);
+                    break;
+                case Op::NotWordBoundary:
+                    if (position.prev_word == next_word) scratch.stack.push_back(pc + 1);
+                    break;
+                default:
+                    scratch.consuming.push_back(pc);
+                    break;
+            }
+        }
+        return false;
+    }
+
+    // Advances over c; returns false if a pattern matched before it
+    template <typename CharT>
+    bool Step(const std::vector<uint32_t>& kernel, const Position& position, const uint32_t c, Scratch& scratch, std::vector<uint32_t>& next_kernel) const
+    {
+        if (Closure(kernel, position, false, IsWordChar(c), scratch)) {
+            return false;
+        }
+        next_kernel.clear();
+        for (const auto pc : scratch.consuming) {
+            if (Consumes<CharT>(insts[pc], c)) next_kernel.push_back(pc + 1);
+        }
+        std::ranges::sort(next_kernel);
+        next_kernel.erase(std::ranges::unique(next_kernel).begin(), next_kernel.end());
+        return true;
+    }
+
+    bool MatchesAtEnd(const std::vector<uint32_t>& kernel, const Position& position, Scratch& scratch) const
+    {
+        return Closure(kernel, position, true, false, scratch);
+    }
+
+    // Without the DFA cache, for when another thread is using it
+    template <typename CharT>
+    bool SearchNfa(const std::basic_string_view<CharT> text) const
+    {
+        Scratch scratch;
+        std::vector<uint32_t> kernel, next_kernel;
+        Position position{true, false};
+        for (const auto ch : text) {
+            const auto c = CodeUnit(ch);
+            if (!Step<CharT>(kernel, position, c, scratch, next_kernel)) return true;
+            kernel.swap(next_kernel);
+            position = {false, IsWordChar(c)};
+        }
+        return MatchesAtEnd(kernel, position, scratch);
+    }
+
+    static int32_t GetState(Dfa& dfa, std::vector<uint32_t>&& kernel, const Position& position)
+    {
+        auto key = kernel;
+        key.push_back(position.at_start | (position.prev_word << 1));
+        const auto [it, inserted] = dfa.ids.try_emplace(std::move(key), static_cast<int32_t>(dfa.states.size()));
+        if (inserted) {
+            auto state = std::make_unique<DfaState>();
+            state->kernel = std::move(kernel);
+            state->position = position;
+            state->ascii_next.fill(Unknown);
+            dfa.states.push_back(std::move(state));
+        }
+        return it->second;
+    }
+
+    template <typename CharT>
+    bool Search(const std::basic_string_view<CharT> text) const
+    {
+        std::unique_lock lock(dfa_mutex, std::try_to_lock);
+        if (!lock) {
+            return SearchNfa(text);
+        }
+        auto& dfa = sizeof(CharT) == 1 ? narrow_dfa : wide_dfa;
+        if (dfa.states.empty()) {
+            GetState(dfa, {}, {true, false});
+        }
+        std::vector<uint32_t> next_kernel;
+        int32_t state = 0;
+        for (const auto ch : text) {
+            const auto c = CodeUnit(ch);
+            const auto& current = *dfa.states[state];
+            int32_t next = Unknown;
+            if (c < 0x80) {
+                next = current.ascii_next[c];
+            }
+            else if (const auto found = current.other_next.find(c); found != current.other_next.end()) {
+                next = found->second;
+            }
+            if (next == Matched) return true;
+            if (next != Unknown) {
+                state = next;
+                continue;
+            }
+            if (dfa.states.size() >= MAX_DFA_STATES) {
+                // Start the cache over from here
+                auto kernel = std::move(dfa.states[state]->kernel);
+                const auto position = dfa.states[state]->position;
+                dfa.Reset();
+                state = GetState(dfa, std::move(kernel), position);
+            }
+            const auto& from = *dfa.states[state];
+            int32_t to = Matched;
+            if (Step<CharT>(from.kernel, from.position, c, dfa.scratch, next_kernel)) {
+                to = GetState(dfa, std::move(next_kernel), {false, IsWordChar(c)});
+            }
+            auto& cached = *dfa.states[state];
+            if (c < 0x80) cached.ascii_next[c] = to;
+            else cached.other_next[c] = to;
+            if (to == Matched) return true;
+            state = to;
+        }
+        auto& last = *dfa.states[state];
+        if (last.match_at_end == Unknown) {
+            last.match_at_end = MatchesAtEnd(last.kernel, last.position, dfa.scratch);
+        }
+        return last.match_at_end;
+    }
+};
+
+RegexSet::RegexSet() : program(std::make_unique<Program>()) {}
+
+RegexSet::~RegexSet() = default;
+
+void RegexSet::Clear()
+{
+    program = std::make_unique<Program>();
+    patterns = 0;
+}
+
+void RegexSet::Add(const std::wstring_view pattern, const uint8_t flags)
+{
+    std::vector<uint32_t> code_units;
+    code_units.reserve(pattern.size());
+    for (const auto c : pattern) {
+        code_units.push_back(CodeUnit(c));
+    }
+    program->Add(std::move(code_units), flags);
+    patterns++;
+}
+
+void RegexSet::Add(const std::string_view pattern, const uint8_t flags)
+{
+    std::vector<uint32_t> code_units;
+    code_units.reserve(pattern.size());
+    for (const auto c : pattern) {
+        code_units.push_back(CodeUnit(c));
+    }
+    program->Add(std::move(code_units), flags);
+    patterns++;
+}
+
+bool RegexSet::Search(const std::wstring_view text) const
+{
+    return patterns && program->Search(text);
+}
+
+bool RegexSet::Search(const std::string_view text) const
+{
+    return patterns && program->Search(text);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+// Regular expressions typed in by users: chat filters and trade/party alerts.
+// std::regex backtracks, so a pattern like (a*)*b can take exponential time on a line of chat, on the game thread. These are compiled together
+// into one Thompson NFA, which is run as a DFA built lazily as text is searched: a search is O(text length * size of the patterns) at worst,
+// and usually one table lookup per character.
+// Supports the ECMAScript syntax that gets used: literals, ., classes, \d \w \s \b, ^ $, groups, alternation and every quantifier. Only whether
+// there's a match is reported, so lazy quantifiers are the same as greedy ones. Backreferences and lookarounds can't be matched in linear time,
+// and are rejected.
+// Search() can be called from any thread, but not while the set is being changed.
+class RegexSet {
+public:
+    enum Flags : uint8_t {
+        Default = 0,
+        IgnoreCase = 1 << 0, // As std::regex_constants::icase
+    };
+
+    RegexSet();
+    RegexSet(const RegexSet&) = delete;
+    RegexSet& operator=(const RegexSet&) = delete;
+    ~RegexSet();
+
+    void Clear();
+    // Throws std::regex_error if the pattern is invalid, or uses something that isn't supported; the set is left as it was.
+    void Add(std::wstring_view pattern, uint8_t flags = Default);
+    void Add(std::string_view pattern, uint8_t flags = Default);
+
+    [[nodiscard]] bool empty() const { return !patterns; }
+    [[nodiscard]] size_t size() const { return patterns; }
+
+    // True if any pattern matches somewhere in text
+    [[nodiscard]] bool Search(std::wstring_view text) const;
+    [[nodiscard]] bool Search(std::string_view text) const;
+
+    struct Program;
+
+private:
+    std::unique_ptr<Program> program;
+    size_t patterns = 0;
+};
@@ -0,0 +1,259 @@
+#pragma once
+
+#include <immintrin.h>
+
+// The loops behind TextUtils' folding and UTF-8/UTF-16 conversion. Nothing here needs Windows, and they take any 16-bit code unit (wchar_t
+// in the game, char16_t where wchar_t is wider), so tests/TextKernelsBench.cpp and tests/TranscodeBench.cpp can check and time them outside
+// the game.
+
+// The dll is built for baseline x86, so AVX2 code is compiled per function and only called when the CPU has it
+#ifdef _MSC_VER
+#define TEXTKERNELS_AVX2
+#else
+#define TEXTKERNELS_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace TextUtils {
+    constexpr size_t InvalidEncoding = static_cast<size_t>(-1);
+
+    enum FoldFlags : uint8_t {
+        FoldCase = 1 << 0,        // As ToLower
+        FoldDiacritics = 1 << 1,  // As RemoveDiacritics
+        FoldPunctuation = 1 << 2, // Drop it, as RemovePunctuation
+    };
+
+    namespace detail {
+        template <typename CharT>
+        concept CodeUnit16 = sizeof(CharT) == sizeof(uint16_t);
+
+        // Direct lookup for every BMP character, for each way text gets folded
+        struct FoldTables {
+            std::array<uint16_t, 0x10000> diacritics; // RemoveDiacritics
+            std::array<uint16_t, 0x10000> lower;      // ToLower
+            std::array<uint16_t, 0x10000> folded;     // Both
+            std::bitset<0x10000> punctuation;         // RemovePunctuation
+        };
+        const FoldTables& GetFoldTables();
+
+        // 8 characters at a time while they're all ASCII, which has no diacritics to remove; returns how many were done
+        template <CodeUnit16 CharT>
+        size_t FoldAscii(const std::basic_string_view<CharT> s, CharT* out, const bool fold_case)
+        {
+            const auto non_ascii = _mm_set1_epi16(static_cast<short>(0xff80));
+            const auto before_upper = _mm_set1_epi16('A' - 1);
+            const auto after_upper = _mm_set1_epi16('Z' + 1);
+            const auto case_bit = _mm_set1_epi16(0x20);
+            size_t i = 0;
+            for (; i + 8 <= s.size(); i += 8) {
+                auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.data() + i));
+                if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(chars, non_ascii), _mm_setzero_si128())) != 0xffff) {
+                    break;
+                }
+                if (fold_case) {
+                    const auto upper = _mm_and_si128(_mm_cmpgt_epi16(chars, before_upper), _mm_cmplt_epi16(chars, after_upper));
+                    chars = _mm_or_si128(chars, _mm_and_si128(upper, case_bit));
+                }
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), chars);
+            }
+            return i;
+        }
+
+        // TextUtils::Fold; out needs room for s.size() characters, and can be s itself. Returns how many characters were written.
+        template <CodeUnit16 CharT>
+        size_t Fold(const std::basic_string_view<CharT> s, CharT* out, const uint8_t flags)
+        {
+            const auto& tables = GetFoldTables();
+            const uint16_t* table = nullptr;
+            if (flags & FoldCase) {
+                table = flags & FoldDiacritics ? tables.folded.data() : tables.lower.data();
+            }
+            else if (flags & FoldDiacritics) {
+                table = tables.diacritics.data();
+            }
+            if (!(flags & FoldPunctuation)) {
+                // Same length in and out
+                size_t i = FoldAscii(s, out, flags & FoldCase);
+                for (; i < s.size(); i++) {
+                    out[i] = table ? static_cast<CharT>(table[static_cast<uint16_t>(s[i])]) : s[i];
+                }
+                return s.size();
+            }
+            size_t written = 0;
+            for (const auto c : s) {
+                if (tables.punctuation[static_cast<uint16_t>(c)]) continue;
+                out[written++] = table ? static_cast<CharT>(table[static_cast<uint16_t>(c)]) : c;
+            }
+            return written;
+        }
+
+        enum class Simd : uint8_t { None, Sse2, Avx2 };
+        // AVX2 if this CPU has it; SSE2 otherwise, which the dll already assumes
+        Simd BestSimd();
+
+        // Runs of ASCII, 32 bytes at a time; returns how many were done
+        template <bool Write, CodeUnit16 CharT>
+        TEXTKERNELS_AVX2 size_t WidenAsciiAvx2(const uint8_t* in, const size_t size, CharT* dst)
+        {
+            size_t i = 0;
+            for (; i + 32 <= size; i += 32) {
+                const auto bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+                if (_mm256_movemask_epi8(bytes)) break;
+                if constexpr (Write) {
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(bytes)));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(bytes, 1)));
+                }
+            }
+            return i;
+        }
+
+        // Runs of ASCII, 16 code units at a time; returns how many were done
+        template <bool Write, CodeUnit16 CharT>
+        TEXTKERNELS_AVX2 size_t NarrowAsciiAvx2(const CharT* src, const size_t size, char* dst)
+        {
+            const auto non_ascii = _mm256_set1_epi16(static_cast<short>(0xff80));
+            size_t i = 0;
+            for (; i + 16 <= size; i += 16) {
+                const auto chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+                if (!_mm256_testz_si256(chars, non_ascii)) break;
+                if constexpr (Write) {
+                    // Packing works within each 128-bit lane; gather the two low halves
+                    const auto packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(chars, chars), 0b1000);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm256_castsi256_si128(packed));
+                }
+            }
+            return i;
+        }
+
+        // Validating transcoders; with Write false, only counts. Runs of ASCII are done with AVX2 or SSE2, as simd allows.
+        template <bool Write, CodeUnit16 CharT>
+        size_t TranscodeUtf8ToUtf16(const std::string_view src, CharT* dst, const Simd simd)
+        {
+            const auto* in = reinterpret_cast<const uint8_t*>(src.data());
+            const size_t size = src.size();
+            size_t i = 0, n = 0;
+            size_t next_probe = 0; // The rest of a block that wasn't all ASCII goes through the scalar path, rather than being probed per character
+            while (i < size) {
+                if (simd != Simd::None && i >= next_probe) {
+                    if (simd == Simd::Avx2 && size - i >= 32) {
+                        const auto done = WidenAsciiAvx2<Write>(in + i, size - i, Write ? dst + n : dst);
+                        i += done;
+                        n += done;
+                    }
+                    for (; i + 16 <= size; i += 16, n += 16) {
+                        const auto bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                        if (_mm_movemask_epi8(bytes)) break;
+                        if constexpr (Write) {
+                            const auto zero = _mm_setzero_si128();
+                            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + n), _mm_unpacklo_epi8(bytes, zero));
+                            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + n + 8), _mm_unpackhi_epi8(bytes, zero));
+                        }
+                    }
+                    if (i >= size) break;
+                    next_probe = i + 16;
+                }
+                const uint8_t lead = in[i];
+                if (lead < 0x80) {
+                    if constexpr (Write) dst[n] = static_cast<CharT>(lead);
+                    i++;
+                    n++;
+                    continue;
+                }
+                size_t length;
+                uint32_t cp;
+                if (lead >= 0xc2 && lead <= 0xdf) {
+                    length = 2;
+                    cp = lead & 0x1f;
+                }
+                else if (lead >= 0xe0 && lead <= 0xef) {
+                    length = 3;
+                    cp = lead & 0x0f;
+                }
+                else if (lead >= 0xf0 && lead <= 0xf4) {
+                    length = 4;
+                    cp = lead & 0x07;
+                }
+                else {
+                    return InvalidEncoding; // Continuation byte, or a lead that can only start an overlong or out of range sequence
+                }
+                if (size - i < length) return InvalidEncoding;
+                for (size_t k = 1; k < length; k++) {
+                    const auto continuation = in[i + k];
+                    if ((continuation & 0xc0) != 0x80) return InvalidEncoding;
+                    cp = (cp << 6) | (continuation & 0x3f);
+                }
+                if ((length == 3 && (cp < 0x800 || (cp >= 0xd800 && cp <= 0xdfff))) || (length == 4 && (cp < 0x10000 || cp > 0x10ffff))) {
+                    return InvalidEncoding;
+                }
+                i += length;
+                if (cp >= 0x10000) {
+                    if constexpr (Write) {
+                        dst[n] = static_cast<CharT>(0xd800 + ((cp - 0x10000) >> 10));
+                        dst[n + 1] = static_cast<CharT>(0xdc00 + ((cp - 0x10000) & 0x3ff));
+                    }
+                    n += 2;
+                    continue;
+                }
+                if constexpr (Write) dst[n] = static_cast<CharT>(cp);
+                n++;
+            }
+            return n;
+        }
+
+        template <bool Write, CodeUnit16 CharT>
+        size_t TranscodeUtf16ToUtf8(const std::basic_string_view<CharT> src, char* dst, const Simd simd)
+        {
+            const size_t size = src.size();
+            size_t i = 0, n = 0;
+            const auto put = [dst, &n](const uint32_t byte) {
+                if constexpr (Write) dst[n] = static_cast<char>(byte);
+                n++;
+            };
+            size_t next_probe = 0; // As above
+            while (i < size) {
+                if (simd != Simd::None && i >= next_probe) {
+                    if (simd == Simd::Avx2 && size - i >= 16) {
+                        const auto done = NarrowAsciiAvx2<Write>(src.data() + i, size - i, Write ? dst + n : dst);
+                        i += done;
+                        n += done;
+                    }
+                    const auto non_ascii = _mm_set1_epi16(static_cast<short>(0xff80));
+                    for (; i + 8 <= size; i += 8, n += 8) {
+                        const auto chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src.data() + i));
+                        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(chars, non_ascii), _mm_setzero_si128())) != 0xffff) break;
+                        if constexpr (Write) {
+                            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + n), _mm_packus_epi16(chars, chars));
+                        }
+                    }
+                    if (i >= size) break;
+                    next_probe = i + 8;
+                }
+                uint32_t cp = static_cast<uint16_t>(src[i++]);
+                if (cp >= 0xd800 && cp <= 0xdfff) {
+                    if (cp >= 0xdc00 || i >= size) return InvalidEncoding; // Unpaired surrogate
+                    const uint32_t low = static_cast<uint16_t>(src[i++]);
+                    if (low < 0xdc00 || low > 0xdfff) return InvalidEncoding;
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                }
+                if (cp < 0x80) {
+                    put(cp);
+                }
+                else if (cp < 0x800) {
+                    put(0xc0 | (cp >> 6));
+                    put(0x80 | (cp & 0x3f));
+                }
+                else if (cp < 0x10000) {
+                    put(0xe0 | (cp >> 12));
+                    put(0x80 | ((cp >> 6) & 0x3f));
+                    put(0x80 | (cp & 0x3f));
+                }
+                else {
+                    put(0xf0 | (cp >> 18));
+                    put(0x80 | ((cp >> 12) & 0x3f));
+                    put(0x80 | ((cp >> 6) & 0x3f));
+                    put(0x80 | (cp & 0x3f));
+                }
+            }
+            return n;
+        }
+    }
+}
@@ -4,12 +4,19 @@
 #include <ctre.hpp>
 #undef __forceinline
 
+#include "TextKernels.h"
+
 
 bool wcseq(const wchar_t* a, const wchar_t* b);
 
 namespace TextUtils {
+    // Both try UTF-8 first, then the system code page
     std::string WStringToString(std::wstring_view str);
     std::wstring StringToWString(std::string_view str);
+    // Validating UTF-8 <-> UTF-16 into the caller's buffer, or only measuring if dst is nullptr.
+    // Returns how many code units were (or would be) written, or InvalidEncoding if src isn't well formed.
+    size_t Utf8ToUtf16(std::string_view src, wchar_t* dst);
+    size_t Utf16ToUtf8(std::wstring_view src, char* dst);
     std::string UrlEncode(std::string_view s, char space_token = '+');
     std::string HtmlEncode(std::string_view s);
     std::string SanitiseFilename(std::string_view str);
@@ -34,6 +41,15 @@ namespace TextUtils {
     std::string ToLower(std::string s);
     std::wstring ToLower(std::wstring s);
     std::wstring RemoveDiacritics(std::wstring_view s);
+    wchar_t RemoveDiacritics(wchar_t c);
+    // Same as ToLower(RemoveDiacritics(c)), for folding text one character at a time as it's searched
+    wchar_t FoldForSearch(wchar_t c);
+
+    // Applies every fold in flags in one pass over s, with table lookups; out needs room for s.size() characters, and can be s itself.
+    // Returns how many characters were written.
+    size_t Fold(std::wstring_view s, wchar_t* out, uint8_t flags);
+    // Same, into out's existing storage
+    void Fold(std::wstring_view s, std::wstring& out, uint8_t flags);
 
     std::wstring SanitizePlayerName(std::wstring_view str);
     std::wstring SanitizeForCSV(const std::wstring_view str);
@@ -70,160 +86,163 @@ namespace TextUtils {
         return r | std::views::as_rvalue | std::views::join_with(replacement) | std::ranges::to<std::basic_string<CharT>>();
     }
 
-    template <ctll::fixed_string Pattern, ctll::fixed_string Replacement, typename... Modifiers>
-    constexpr std::string ctre_regex_replace(const std::string_view subject)
-    {
-        // this is actually SLOWER than the string appending version, so don't use it.
-        static constexpr ctll::fixed_string special_tokens = R"(\$(\d+|'|&|`|\$))";
-        if constexpr (!ctre::search<special_tokens>(Replacement) && false) {
-            return ctre_simple_regex_replace<char, Pattern, Modifiers...>(subject, Replacement);
-        }
+    namespace detail {
+        // One piece of a replacement string: literal text, or $&, $1-$9, $` or $'
+        struct ReplacementSegment {
+            enum class Kind : uint8_t { Literal, Group, Prefix, Suffix };
+            Kind kind = Kind::Literal;
+            size_t begin = 0;  // Literal: offset into the replacement's text; Group: the group number (0 for $&)
+            size_t length = 0; // Literal only
+            size_t source = 0; // Group: offset of the "$n" in the text, used as-is if the pattern doesn't have that many groups
+        };
 
-        std::string result;
-        result.reserve(subject.size() * 2);
-        auto search_start = subject.begin();
-#pragma warning(push)
-#pragma warning(disable: 4244)
-        const auto replacement = Replacement | std::ranges::to<std::string>();
-#pragma warning(pop)
-
-        for (auto match : ctre::search_all<Pattern, Modifiers...>(subject)) {
-            result.append(&*search_start, match.begin() - search_start);
-            std::string replaced_match(replacement);
-        struct Pair {
-            std::string key;
-            std::string value;
+        template <typename CharT, size_t N>
+        struct ParsedReplacement {
+            std::array<CharT, N * 4 + 1> text{}; // The replacement, re-encoded as CharT
+            std::array<ReplacementSegment, N + 1> segments{};
+            size_t segment_count = 0;
         };
-        std::vector<Pair> replacements;
-
-        constexpr auto cnt = decltype(match)::count();
-        static_assert(cnt < 10, "Only up to 9 capture groups are supported");
-        constexpr auto has_escaped_dollar = ctre::search<R"(\$\$)">(Replacement);
-        if constexpr (has_escaped_dollar)
-            replacements.emplace_back("$$", "###ESCAPED_DOLLAR###");
-        if constexpr (ctre::search<R"(\$&)">(Replacement))
-            replacements.emplace_back("$&", match.to_string());
-        if constexpr (ctre::search<R"(\$')">(Replacement))
-            replacements.emplace_back("$'", std::string(match.end(), subject.end()));
-        if constexpr (ctre::search<R"(\$`)">(Replacement))
-            replacements.emplace_back("$`", std::string(subject.begin(), match.begin()));
-        // if constexpr (ctre::search<R"(\$0)">(Replacement))
-        //     replacements.emplace_back("$0", match.to_string());
-        if constexpr (ctre::search<R"(\$1)">(Replacement) && cnt > 1)
-            replacements.emplace_back("$1", match.template get<1>().to_string());
-        if constexpr (ctre::search<R"(\$2)">(Replacement) && cnt > 2)
-            replacements.emplace_back("$2", match.template get<2>().to_string());
-        if constexpr (ctre::search<R"(\$3)">(Replacement) && cnt > 3)
-            replacements.emplace_back("$3", match.template get<3>().to_string());
-        if constexpr (ctre::search<R"(\$4)">(Replacement) && cnt > 4)
-            replacements.emplace_back("$4", match.template get<4>().to_string());
-        if constexpr (ctre::search<R"(\$5)">(Replacement) && cnt > 5)
-            replacements.emplace_back("$5", match.template get<5>().to_string());
-        if constexpr (ctre::search<R"(\$6)">(Replacement) && cnt > 6)
-            replacements.emplace_back("$6", match.template get<6>().to_string());
-        if constexpr (ctre::search<R"(\$7)">(Replacement) && cnt > 7)
-            replacements.emplace_back("$7", match.template get<7>().to_string());
-        if constexpr (ctre::search<R"(\$8)">(Replacement) && cnt > 8)
-            replacements.emplace_back("$8", match.template get<8>().to_string());
-        if constexpr (ctre::search<R"(\$9)">(Replacement) && cnt > 9)
-            replacements.emplace_back("$9", match.template get<9>().to_string());
-        if constexpr (has_escaped_dollar)
-            replacements.emplace_back("###ESCAPED_DOLLAR###", "$");
-
-            for (const auto& [key, value] : replacements) {
-                size_t pos = 0;
-                while ((pos = replaced_match.find(key, pos)) != std::string::npos) {
-                    replaced_match.replace(pos, key.length(), value);
-                    pos += value.length();
+
+        // Splits the replacement into segments at compile time, so applying it is just appends
+        template <typename CharT, ctll::fixed_string Replacement>
+        consteval auto ParseReplacement()
+        {
+            ParsedReplacement<CharT, Replacement.size()> parsed;
+            using Kind = ReplacementSegment::Kind;
+            size_t text_size = 0;
+            const auto encode = [&](const char32_t c) {
+                if constexpr (sizeof(CharT) == 1) {
+                    // ctll keeps a narrow literal's bytes as they are (already UTF-8, with /utf-8), so only wider code points get encoded
+                    if (c < 0x100) {
+                        parsed.text[text_size++] = static_cast<CharT>(c);
+                    }
+                    else if (c < 0x800) {
+                        parsed.text[text_size++] = static_cast<CharT>(0xc0 | (c >> 6));
+                        parsed.text[text_size++] = static_cast<CharT>(0x80 | (c & 0x3f));
+                    }
+                    else if (c < 0x10000) {
+                        parsed.text[text_size++] = static_cast<CharT>(0xe0 | (c >> 12));
+                        parsed.text[text_size++] = static_cast<CharT>(0x80 | ((c >> 6) & 0x3f));
+                        parsed.text[text_size++] = static_cast<CharT>(0x80 | (c & 0x3f));
+                    }
+                    else {
+                        parsed.text[text_size++] = static_cast<CharT>(0xf0 | (c >> 18));
+                        parsed.text[text_size++] = static_cast<CharT>(0x80 | ((c >> 12) & 0x3f));
+                        parsed.text[text_size++] = static_cast<CharT>(0x80 | ((c >> 6) & 0x3f));
+                        parsed.text[text_size++] = static_cast<CharT>(0x80 | (c & 0x3f));
+                    }
+                }
+                else if (sizeof(CharT) == 2 && c >= 0x10000) {
+                    parsed.text[text_size++] = static_cast<CharT>(0xd800 + ((c - 0x10000) >> 10));
+                    parsed.text[text_size++] = static_cast<CharT>(0xdc00 + ((c - 0x10000) & 0x3ff));
+                }
+                else {
+                    parsed.text[text_size++] = static_cast<CharT>(c);
+                }
+            };
+            const auto add = [&](const ReplacementSegment& segment) {
+                if (parsed.segment_count && segment.kind == Kind::Literal) {
+                    auto& last = parsed.segments[parsed.segment_count - 1];
+                    if (last.kind == Kind::Literal && last.begin + last.length == segment.begin) {
+                        last.length += segment.length;
+                        return;
+                    }
+                }
+                parsed.segments[parsed.segment_count++] = segment;
+            };
+            for (size_t i = 0; i < Replacement.size(); i++) {
+                const auto c = Replacement[i];
+                const auto next = i + 1 < Replacement.size() ? Replacement[i + 1] : U'\0';
+                const auto literal_begin = text_size;
+                if (c == U'$' && next == U'$') {
+                    encode(U'$');
+                    add({Kind::Literal, literal_begin, 1});
+                    i++;
+                }
+                else if (c == U'$' && next == U'&') {
+                    add({Kind::Group, 0});
+                    i++;
+                }
+                else if (c == U'$' && next == U'`') {
+                    add({Kind::Prefix});
+                    i++;
+                }
+                else if (c == U'$' && next == U'\'') {
+                    add({Kind::Suffix});
+                    i++;
+                }
+                else if (c == U'$' && next >= U'1' && next <= U'9') {
+                    encode(c);
+                    encode(next);
+                    add({Kind::Group, static_cast<size_t>(next - U'0'), 0, literal_begin});
+                    i++;
+                }
+                else {
+                    encode(c);
+                    add({Kind::Literal, literal_begin, text_size - literal_begin});
                 }
             }
-
-            result.append(replaced_match);
-            search_start = match.end();
+            return parsed;
         }
 
-        if (search_start != subject.end()) {
-            result.append(&*search_start, std::distance(search_start, subject.end()));
+        template <typename CharT, ctll::fixed_string Replacement>
+        constexpr auto parsed_replacement = ParseReplacement<CharT, Replacement>();
+
+        template <typename CharT, ctll::fixed_string Pattern, ctll::fixed_string Replacement, typename... Modifiers>
+        constexpr std::basic_string<CharT> ctre_regex_replace(const std::basic_string_view<CharT> subject)
+        {
+            using Kind = ReplacementSegment::Kind;
+
+            std::basic_string<CharT> result;
+            result.reserve(subject.size());
+            auto search_start = subject.begin();
+            for (const auto& match : ctre::search_all<Pattern, Modifiers...>(subject)) {
+                result.append(search_start, match.begin());
+                // Unrolled over the segments, so each one is a single append
+                const auto append_segment = [&]<size_t I>() {
+                    constexpr auto& parsed = parsed_replacement<CharT, Replacement>;
+                    constexpr auto segment = parsed.segments[I];
+                    if constexpr (segment.kind == Kind::Literal) {
+                        result.append(parsed.text.data() + segment.begin, segment.length);
+                    }
+                    else if constexpr (segment.kind == Kind::Prefix) {
+                        result.append(subject.begin(), match.begin());
+                    }
+                    else if constexpr (segment.kind == Kind::Suffix) {
+                        result.append(match.end(), subject.end());
+                    }
+                    else if constexpr (segment.begin < std::remove_cvref_t<decltype(match)>::count()) {
+                        if (const auto group = match.template get<segment.begin>()) {
+                            result.append(group.to_view());
+                        }
+                    }
+                    else {
+                        result.append(parsed.text.data() + segment.source, 2);
+                    }
+                };
+                [&]<size_t... I>(std::index_sequence<I...>) {
+                    (append_segment.template operator()<I>(), ...);
+                }(std::make_index_sequence<parsed_replacement<CharT, Replacement>.segment_count>{});
+                search_start = match.end();
+            }
+            result.append(search_start, subject.end());
+            return result;
         }
-        return result;
     }
 
+    // Replaces every match of Pattern with Replacement, which can use $&, $1-$9, $`, $' and $$ as in ECMAScript.
+    // Replacement is parsed at compile time; a $n past the pattern's groups is kept as written, as ECMAScript does.
+    // A narrow subject gets a narrow Replacement's bytes as written (UTF-8, with /utf-8).
     template <ctll::fixed_string Pattern, ctll::fixed_string Replacement, typename... Modifiers>
-    constexpr std::wstring ctre_regex_replace(const std::wstring_view subject)
+    constexpr std::string ctre_regex_replace(const std::string_view subject)
     {
-        // this is actually SLOWER than the string appending version, so don't use it.
-        static constexpr ctll::fixed_string special_tokens = LR"(\$(\d+|'|&|`|\$))";
-        if constexpr (!ctre::search<special_tokens>(Replacement) && false) {
-            return ctre_simple_regex_replace<char, Pattern, Modifiers...>(subject, Replacement);
-        }
-
-        std::wstring result;
-        result.reserve(subject.size() * 2);
-        auto search_start = subject.begin();
-#pragma warning(push)
-#pragma warning(disable: 4244)
-        const auto replacement = Replacement | std::ranges::to<std::wstring>();
-#pragma warning(pop)
-
-        for (auto match : ctre::search_all<Pattern, Modifiers...>(subject)) {
-            result.append(&*search_start, match.begin() - search_start);
-            std::wstring replaced_match(replacement);
-        struct Pair {
-            std::wstring key;
-            std::wstring value;
-        };
-        std::vector<Pair> replacements;
-
-        constexpr auto cnt = decltype(match)::count();
-        static_assert(cnt < 10, "Only up to 9 capture groups are supported");
-        constexpr auto has_escaped_dollar = ctre::search<LR"(\$\$)">(Replacement);
-        if constexpr (has_escaped_dollar)
-            replacements.emplace_back(L"$$", L"###ESCAPED_DOLLAR###");
-        if constexpr (ctre::search<LR"(\$&)">(Replacement))
-            replacements.emplace_back(L"$&", match.to_string());
-        if constexpr (ctre::search<LR"(\$')">(Replacement))
-            replacements.emplace_back(L"$'", std::string(match.end(), subject.end()));
-        if constexpr (ctre::search<LR"(\$`)">(Replacement))
-            replacements.emplace_back(L"$`", std::string(subject.begin(), match.begin()));
-        // if constexpr (ctre::search<LR"(\$0)">(Replacement))
-        //     replacements.emplace_back(L"$0", match.to_string());
-        if constexpr (ctre::search<LR"(\$1)">(Replacement) && cnt > 1)
-            replacements.emplace_back(L"$1", match.template get<1>().to_string());
-        if constexpr (ctre::search<LR"(\$2)">(Replacement) && cnt > 2)
-            replacements.emplace_back(L"$2", match.template get<2>().to_string());
-        if constexpr (ctre::search<LR"(\$3)">(Replacement) && cnt > 3)
-            replacements.emplace_back(L"$3", match.template get<3>().to_string());
-        if constexpr (ctre::search<LR"(\$4)">(Replacement) && cnt > 4)
-            replacements.emplace_back(L"$4", match.template get<4>().to_string());
-        if constexpr (ctre::search<LR"(\$5)">(Replacement) && cnt > 5)
-            replacements.emplace_back(L"$5", match.template get<5>().to_string());
-        if constexpr (ctre::search<LR"(\$6)">(Replacement) && cnt > 6)
-            replacements.emplace_back(L"$6", match.template get<6>().to_string());
-        if constexpr (ctre::search<LR"(\$7)">(Replacement) && cnt > 7)
-            replacements.emplace_back(L"$7", match.template get<7>().to_string());
-        if constexpr (ctre::search<LR"(\$8)">(Replacement) && cnt > 8)
-            replacements.emplace_back(L"$8", match.template get<8>().to_string());
-        if constexpr (ctre::search<LR"(\$9)">(Replacement) && cnt > 9)
-            replacements.emplace_back(L"$9", match.template get<9>().to_string());
-        if constexpr (has_escaped_dollar)
-            replacements.emplace_back(L"###ESCAPED_DOLLAR###", L"$");
-
-            for (const auto& [key, value] : replacements) {
-                size_t pos = 0;
-                while ((pos = replaced_match.find(key, pos)) != std::wstring::npos) {
-                    replaced_match.replace(pos, key.length(), value);
-                    pos += value.length();
-                }
-            }
-
-            result.append(replaced_match);
-            search_start = match.end();
-        }
+        return detail::ctre_regex_replace<char, Pattern, Replacement, Modifiers...>(subject);
+    }
 
-        if (search_start != subject.end()) {
-            result.append(&*search_start, std::distance(search_start, subject.end()));
-        }
-        return result;
+    template <ctll::fixed_string Pattern, ctll::fixed_string Replacement, typename... Modifiers>
+    constexpr std::wstring ctre_regex_replace(const std::wstring_view subject)
+    {
+        return detail::ctre_regex_replace<wchar_t, Pattern, Replacement, Modifiers...>(subject);
     }
 
     template <ctll::fixed_string Pattern, typename Formatter, typename... Modifiers>
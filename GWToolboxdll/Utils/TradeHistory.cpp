@@ -0,0 +1,355 @@
+#include "stdafx.h"
+
+#include <charconv>
+#include <numeric>
+
+#include <Modules/Resources.h>
+
+#include "TradeHistory.h"
+
+namespace {
+    constexpr uint32_t SECONDS_PER_DAY = 24 * 60 * 60;
+    // The same player saying the same thing within this many seconds is treated as one message; the kamadan feed and local chat overlap
+    constexpr uint32_t REPEAT_WINDOW_SECONDS = 120;
+
+    char FoldAscii(const char c)
+    {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    bool IsWordChar(const char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || static_cast<uint8_t>(c) >= 0x80;
+    }
+
+    // Calls fn with each case-folded word in text
+    template <typename Fn>
+    void ForEachWord(const std::string_view text, Fn&& fn)
+    {
+        std::string word;
+        for (size_t i = 0; i <= text.size(); i++) {
+            if (i < text.size() && IsWordChar(text[i])) {
+                word.push_back(FoldAscii(text[i]));
+                continue;
+            }
+            if (!word.empty()) {
+                fn(word);
+                word.clear();
+            }
+        }
+    }
+
+    uint64_t HashSaid(const std::string_view name, const std::string_view message)
+    {
+        const auto h = std::hash<std::string_view>{}(name);
+        return (static_cast<uint64_t>(h) << 32) ^ std::hash<std::string_view>{}(message);
+    }
+
+    uint64_t HashRecorded(const TradeHistory::Message& msg)
+    {
+        return HashSaid(msg.name, msg.message) ^ (static_cast<uint64_t>(msg.timestamp) * 0x9E3779B97F4A7C15ull);
+    }
+
+    std::filesystem::path SegmentPath(const std::filesystem::path& folder, const uint32_t day)
+    {
+        const time_t t = static_cast<time_t>(day) * SECONDS_PER_DAY;
+        tm utc{};
+        gmtime_s(&utc, &t);
+        return folder / std::format(L"trade-{:04}-{:02}-{:02}.txt", utc.tm_year + 1900, utc.tm_mon + 1, utc.tm_mday);
+    }
+
+    // Returns 0 if the filename isn't a history segment
+    uint32_t SegmentDay(const std::filesystem::path& path)
+    {
+        int year = 0, month = 0, day = 0;
+        if (swscanf(path.filename().c_str(), L"trade-%4d-%2d-%2d.txt", &year, &month, &day) != 3) {
+            return 0;
+        }
+        tm utc{};
+        utc.tm_year = year - 1900;
+        utc.tm_mon = month - 1;
+        utc.tm_mday = day;
+        const auto t = _mkgmtime(&utc);
+        return t > 0 ? static_cast<uint32_t>(t / SECONDS_PER_DAY) : 0;
+    }
+
+    // Tabs and newlines separate fields and records
+    void AppendField(std::string& line, const std::string_view field)
+    {
+        for (const auto c : field) {
+            line.push_back(c == '\t' || c == '\n' || c == '\r' ? ' ' : c);
+        }
+    }
+
+    std::string ToLine(const TradeHistory::Message& msg)
+    {
+        std::string line = std::format("{}\t{}\t", msg.timestamp, msg.map_id);
+        AppendField(line, msg.name);
+        line.push_back('\t');
+        AppendField(line, msg.message);
+        line.push_back('\n');
+        return line;
+    }
+
+    bool FromLine(const std::string_view line, TradeHistory::Message& msg)
+    {
+        const auto tab1 = line.find('\t');
+        const auto tab2 = tab1 == std::string_view::npos ? tab1 : line.find('\t', tab1 + 1);
+        const auto tab3 = tab2 == std::string_view::npos ? tab2 : line.find('\t', tab2 + 1);
+        if (tab3 == std::string_view::npos) {
+            return false;
+        }
+        const auto timestamp = line.substr(0, tab1);
+        const auto map_id = line.substr(tab1 + 1, tab2 - tab1 - 1);
+        if (std::from_chars(timestamp.data(), timestamp.data() + timestamp.size(), msg.timestamp).ec != std::errc{}
+            || std::from_chars(map_id.data(), map_id.data() + map_id.size(), msg.map_id).ec != std::errc{}) {
+            return false;
+        }
+        msg.name = line.substr(tab2 + 1, tab3 - tab2 - 1);
+        msg.message = line.substr(tab3 + 1);
+        return msg.timestamp && !msg.name.empty();
+    }
+}
+
+struct TradeHistory::Segment {
+    std::vector<Message> messages;
+    // Folded word -> indexes into messages, ascending. Ordered, so every word starting with a prefix is one contiguous range.
+    std::map<std::string, std::vector<uint32_t>, std::less<>> words;
+    std::unordered_set<uint64_t> recorded;
+
+    // Returns false if this exact message is already in the segment
+    bool Insert(Message msg)
+    {
+        if (!recorded.insert(HashRecorded(msg)).second) {
+            return false;
+        }
+        const auto id = static_cast<uint32_t>(messages.size());
+        ForEachWord(msg.message, [this, id](const std::string& word) {
+            auto& postings = words[word];
+            if (postings.empty() || postings.back() != id) {
+                postings.push_back(id);
+            }
+        });
+        messages.push_back(std::move(msg));
+        return true;
+    }
+
+    // Indexes of messages containing a word starting with every term, ascending
+    std::vector<uint32_t> Match(const std::vector<std::string>& terms) const
+    {
+        std::vector<uint32_t> result;
+        if (terms.empty()) {
+            result.resize(messages.size());
+            std::iota(result.begin(), result.end(), 0u);
+            return result;
+        }
+        std::vector<uint32_t> term_ids;
+        std::vector<uint32_t> intersected;
+        for (size_t i = 0; i < terms.size(); i++) {
+            const auto& term = terms[i];
+            term_ids.clear();
+            size_t ranges = 0;
+            for (auto it = words.lower_bound(term); it != words.end() && it->first.starts_with(term); ++it) {
+                term_ids.insert(term_ids.end(), it->second.begin(), it->second.end());
+                ranges++;
+            }
+            if (ranges > 1) {
+                std::ranges::sort(term_ids);
+                term_ids.erase(std::ranges::unique(term_ids).begin(), term_ids.end());
+            }
+            if (i == 0) {
+                result.swap(term_ids);
+            }
+            else {
+                intersected.clear();
+                std::ranges::set_intersection(result, term_ids, std::back_inserter(intersected));
+                result.swap(intersected);
+            }
+            if (result.empty()) {
+                break;
+            }
+        }
+        return result;
+    }
+};
+
+TradeHistory::~TradeHistory() = default;
+
+void TradeHistory::Load(const std::filesystem::path& _folder)
+{
+    folder = _folder;
+    Resources::EnqueueWorkerTask([this] {
+        Resources::EnsureFolderExists(folder);
+        const auto oldest_day = static_cast<uint32_t>(time(nullptr) / SECONDS_PER_DAY) - HISTORY_DAYS;
+
+        std::map<uint32_t, std::unique_ptr<Segment>> loaded_segments;
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(folder, ec)) {
+            const auto day = SegmentDay(entry.path());
+            if (!day) {
+                continue;
+            }
+            if (day < oldest_day) {
+                std::filesystem::remove(entry.path(), ec);
+                continue;
+            }
+            std::ifstream file(entry.path(), std::ios::binary);
+            if (!file.is_open()) {
+                continue;
+            }
+            auto& segment = loaded_segments[day];
+            if (!segment) {
+                segment = std::make_unique<Segment>();
+            }
+            std::string line;
+            Message msg;
+            // A line cut short by a crash has fewer fields, and is skipped
+            while (std::getline(file, line)) {
+                if (FromLine(line, msg)) {
+                    segment->Insert(std::move(msg));
+                }
+            }
+        }
+
+        std::unique_lock lock(mutex);
+        // Anything recorded while loading goes on the end
+        for (auto& [day, segment] : segments) {
+            auto& into = loaded_segments[day];
+            if (!into) {
+                into = std::make_unique<Segment>();
+            }
+            for (auto& msg : segment->messages) {
+                into->Insert(std::move(msg));
+            }
+        }
+        segments = std::move(loaded_segments);
+        for (const auto& segment : segments | std::views::values) {
+            for (const auto& msg : segment->messages) {
+                auto& last = last_said[HashSaid(msg.name, msg.message)];
+                last = std::max(last, msg.timestamp);
+            }
+        }
+        loaded = true;
+    }, WorkerPriority::Bulk);
+}
+
+bool TradeHistory::Add(const Message& msg)
+{
+    if (!msg.timestamp || msg.name.empty() || msg.message.empty()) {
+        return false;
+    }
+    const auto day = msg.timestamp / SECONDS_PER_DAY;
+    const auto today = static_cast<uint32_t>(time(nullptr) / SECONDS_PER_DAY);
+    if (day < today - HISTORY_DAYS) {
+        return false; // Would be dropped on the next load anyway
+    }
+    {
+        std::unique_lock lock(mutex);
+        if (today != current_day) {
+            // New day; forget whatever has fallen out of the window, the same as Load() would
+            current_day = today;
+            const auto oldest_day = today - HISTORY_DAYS;
+            segments.erase(segments.begin(), segments.lower_bound(oldest_day));
+            std::erase_if(last_said, [oldest_day](const auto& said) {
+                return said.second / SECONDS_PER_DAY < oldest_day;
+            });
+        }
+        auto& last = last_said[HashSaid(msg.name, msg.message)];
+        const auto since = msg.timestamp > last ? msg.timestamp - last : last - msg.timestamp;
+        if (last && since < REPEAT_WINDOW_SECONDS) {
+            return false;
+        }
+        auto& segment = segments[day];
+        if (!segment) {
+            segment = std::make_unique<Segment>();
+        }
+        if (!segment->Insert(msg)) {
+            return false;
+        }
+        last = std::max(last, msg.timestamp);
+    }
+    std::lock_guard lock(pending_mutex);
+    pending_writes.emplace_back(day, ToLine(msg));
+    return true;
+}
+
+bool TradeHistory::HasPendingWrites() const
+{
+    std::lock_guard lock(pending_mutex);
+    return !pending_writes.empty();
+}
+
+void TradeHistory::Flush()
+{
+    std::lock_guard write_lock(write_mutex);
+    std::vector<std::pair<uint32_t, std::string>> to_write;
+    {
+        std::lock_guard lock(pending_mutex);
+        to_write.swap(pending_writes);
+    }
+    if (to_write.empty() || folder.empty()) {
+        return;
+    }
+    // Mostly all for the same day; keep the order they were added in within each file
+    std::ranges::stable_sort(to_write, {}, &std::pair<uint32_t, std::string>::first);
+    Resources::EnsureFolderExists(folder);
+    FILE* file = nullptr;
+    uint32_t file_day = 0;
+    for (const auto& [day, line] : to_write) {
+        if (!file || day != file_day) {
+            if (file) {
+                fclose(file);
+            }
+            file_day = day;
+            file = _wfopen(SegmentPath(folder, day).c_str(), L"ab");
+            if (!file) {
+                Log::Log("Failed to open trade history for writing, %d", errno);
+                continue;
+            }
+        }
+        fwrite(line.data(), 1, line.size(), file);
+    }
+    if (file) {
+        fclose(file);
+    }
+}
+
+std::vector<TradeHistory::Message> TradeHistory::Search(const std::string_view query, const size_t max_results, const std::function<bool(const Message&)>& filter) const
+{
+    std::vector<std::string> terms;
+    ForEachWord(query, [&terms](const std::string& word) {
+        terms.push_back(word);
+    });
+
+    std::vector<Message> results;
+    std::vector<const Message*> matches;
+    std::shared_lock lock(mutex);
+    for (const auto& segment : segments | std::views::values | std::views::reverse) {
+        matches.clear();
+        for (const auto id : segment->Match(terms)) {
+            const auto& msg = segment->messages[id];
+            if (!filter || filter(msg)) {
+                matches.push_back(&msg);
+            }
+        }
+        // Usually already in order, but search results from the server are recorded after the fact
+        std::ranges::stable_sort(matches, std::greater{}, &Message::timestamp);
+        for (const auto msg : matches) {
+            if (results.size() >= max_results) {
+                return results;
+            }
+            results.push_back(*msg);
+        }
+    }
+    return results;
+}
+
+size_t TradeHistory::size() const
+{
+    std::shared_lock lock(mutex);
+    size_t count = 0;
+    for (const auto& segment : segments | std::views::values) {
+        count += segment->messages.size();
+    }
+    return count;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <shared_mutex>
+
+// Local archive of every trade message seen, so searches work offline and reach back further than the trade window's last 100 messages.
+// Messages are appended to one file per day (UTC); the last HISTORY_DAYS days are loaded and indexed by word on a worker thread.
+// Older files are deleted on load, and older messages are dropped from memory when the day rolls over.
+// Add() and Search() can be called from any thread.
+class TradeHistory {
+public:
+    struct Message {
+        uint32_t timestamp = 0; // Unix time
+        uint32_t map_id = 0;    // Where it was said
+        std::string name;
+        std::string message;
+    };
+
+    static constexpr uint32_t HISTORY_DAYS = 30;
+
+    TradeHistory() = default;
+    TradeHistory(const TradeHistory&) = delete;
+    ~TradeHistory();
+
+    // Loads saved history from folder in the background; messages added before it finishes are kept
+    void Load(const std::filesystem::path& folder);
+    // Records a message; returns false if the same player said the same thing within a couple of minutes of it, or it's already recorded
+    bool Add(const Message& msg);
+    // Writes out anything added since the last flush
+    void Flush();
+    [[nodiscard]] bool HasPendingWrites() const;
+
+    // Newest first. Every word in the query must be the start of a word in the message, case-insensitively; an empty query matches everything.
+    [[nodiscard]] std::vector<Message> Search(std::string_view query, size_t max_results, const std::function<bool(const Message&)>& filter = nullptr) const;
+
+    [[nodiscard]] size_t size() const;
+    [[nodiscard]] bool IsLoaded() const { return loaded; }
+
+    struct Segment;
+
+private:
+    std::filesystem::path folder;
+    std::atomic_bool loaded = false;
+
+    mutable std::shared_mutex mutex;
+    std::map<uint32_t, std::unique_ptr<Segment>> segments; // By day
+    std::unordered_map<uint64_t, uint32_t> last_said;      // Hash of name and message -> newest timestamp, for dropping repeats
+    uint32_t current_day = 0;                              // When expired segments were last dropped
+
+    mutable std::mutex pending_mutex;
+    std::vector<std::pair<uint32_t, std::string>> pending_writes; // Day, line
+    std::mutex write_mutex;
+};
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 
 #include "GWMarketWindow.h"
+#include "GWMarketWindow_Protocol.h"
 
 #include <GWCA/Constants/Constants.h>
 
@@ -26,6 +27,7 @@
 #include <Modules/GwDatTextureModule.h>
 #include <Modules/InventoryManager.h>
 #include <Modules/Resources.h>
+#include <Modules/WebSocketModule.h>
 
 #include <GWCA/Context/CharContext.h>
 #include <Timer.h>
@@ -34,16 +36,14 @@
 #include <algorithm>
 #include <chrono>
 #include <iomanip>
-#include <queue>
 #include <sstream>
-#include <thread>
 #include <unordered_set>
 
 // API for shops isn't good enough, stick to browsing for now.
 #define GWMARKET_SELLING_ENABLED 0
 
 namespace {
-    using easywsclient::WebSocket;
+    using namespace GWMarket;
     using json = nlohmann::json;
 
     const char* market_host = "gwmarket.net";
@@ -57,52 +57,9 @@ namespace {
     constexpr uint32_t COST_PER_CONNECTION_MS = 30 * 1000;
     constexpr uint32_t COST_PER_CONNECTION_MAX_MS = 60 * 1000;
 
-    // Enums for type-safe representations
-    enum class Currency : uint32_t { Platinum = 0, Ecto = 1, Zkeys = 2, Arms = 3, Count = 4, All = 0xf };
-
-    enum class OrderType : uint8_t { Sell = 0, Buy = 1 };
-
     enum class OrderSortMode : uint8_t { MostRecent = 0, Currency = 1 };
     Currency order_view_currency = Currency::All;
 
-    // Safe string extraction helper
-    std::string parseStringFromJson(const json& j, const char* key, const std::string& default_val)
-    {
-        if (!j.is_discarded() && j.contains(key) && j[key].is_string()) {
-            return j[key].get<std::string>();
-        }
-        return default_val;
-    };
-    int parseIntFromJson(const json& j, const char* key, const int& default_val)
-    {
-        if (!j.is_discarded() && j.contains(key) && j[key].is_number_integer()) {
-            return j[key].get<int>();
-        }
-        return default_val;
-    };
-    bool parseBoolFromJson(const json& j, const char* key, const bool& default_val)
-    {
-        if (!j.is_discarded() && j.contains(key) && j[key].is_boolean()) {
-            return j[key].get<bool>();
-        }
-        return default_val;
-    };
-    uint64_t parseUint64FromJson(const json& j, const char* key, const uint64_t& default_val)
-    {
-        if (!j.is_discarded() && j.contains(key) && j[key].is_number_unsigned()) {
-            return j[key].get<uint64_t>();
-        }
-        return default_val;
-    };
-    float parseFloatFromJson(const json& j, const char* key, const float& default_val)
-    {
-        if (!j.is_discarded() && j.contains(key)) {
-            if (j[key].is_number_float()) return j[key].get<float>();
-            if (j[key].is_number_integer()) return (float)j[key].get<int>();
-        }
-        return default_val;
-    };
-
     const char* GetPriceTypeString(Currency currency)
     {
         switch (currency) {
@@ -146,16 +103,6 @@ namespace {
         }
     }
 
-    // String interning to reduce memory footprint
-    std::unordered_set<std::string> string_pool;
-
-    const std::string* InternString(const std::string& str)
-    {
-        auto it = string_pool.insert(str);
-        return &(*it.first);
-    }
-
-
     std::string* GetAttributeName(GW::Constants::Attribute attribute)
     {
         const auto attrib_data = GW::SkillbarMgr::GetAttributeConstantData(attribute);
@@ -164,210 +111,156 @@ namespace {
         }
         return nullptr;
     }
+}
 
-    GW::Constants::Attribute AttributeFromString(const std::string& str)
-    {
-        using namespace GW::Constants;
-        // Mesmer
-        if (str == "Fast Casting") return Attribute::FastCasting;
-        if (str == "Illusion Magic") return Attribute::IllusionMagic;
-        if (str == "Domination Magic") return Attribute::DominationMagic;
-        if (str == "Inspiration Magic") return Attribute::InspirationMagic;
-
-        // Necromancer
-        if (str == "Blood Magic") return Attribute::BloodMagic;
-        if (str == "Death Magic") return Attribute::DeathMagic;
-        if (str == "Soul Reaping") return Attribute::SoulReaping;
-        if (str == "Curses") return Attribute::Curses;
-
-        // Elementalist
-        if (str == "Air Magic") return Attribute::AirMagic;
-        if (str == "Earth Magic") return Attribute::EarthMagic;
-        if (str == "Fire Magic") return Attribute::FireMagic;
-        if (str == "Water Magic") return Attribute::WaterMagic;
-        if (str == "Energy Storage") return Attribute::EnergyStorage;
-
-        // Monk
-        if (str == "Healing Prayers") return Attribute::HealingPrayers;
-        if (str == "Smiting Prayers") return Attribute::SmitingPrayers;
-        if (str == "Protection Prayers") return Attribute::ProtectionPrayers;
-        if (str == "Divine Favor") return Attribute::DivineFavor;
-
-        // Warrior
-        if (str == "Strength") return Attribute::Strength;
-        if (str == "Axe Mastery") return Attribute::AxeMastery;
-        if (str == "Hammer Mastery") return Attribute::HammerMastery;
-        if (str == "Swordsmanship") return Attribute::Swordsmanship;
-        if (str == "Tactics") return Attribute::Tactics;
-
-        // Ranger
-        if (str == "Beast Mastery") return Attribute::BeastMastery;
-        if (str == "Expertise") return Attribute::Expertise;
-        if (str == "Wilderness Survival") return Attribute::WildernessSurvival;
-        if (str == "Marksmanship") return Attribute::Marksmanship;
-
-        // Assassin
-        if (str == "Dagger Mastery") return Attribute::DaggerMastery;
-        if (str == "Deadly Arts") return Attribute::DeadlyArts;
-        if (str == "Shadow Arts") return Attribute::ShadowArts;
-        if (str == "Critical Strikes") return Attribute::CriticalStrikes;
-
-        // Ritualist
-        if (str == "Communing") return Attribute::Communing;
-        if (str == "Restoration Magic") return Attribute::RestorationMagic;
-        if (str == "Channeling Magic") return Attribute::ChannelingMagic;
-        if (str == "Spawning Power") return Attribute::SpawningPower;
-
-        // Paragon
-        if (str == "Spear Mastery") return Attribute::SpearMastery;
-        if (str == "Command") return Attribute::Command;
-        if (str == "Motivation") return Attribute::Motivation;
-        if (str == "Leadership") return Attribute::Leadership;
-
-        // Dervish
-        if (str == "Scythe Mastery") return Attribute::ScytheMastery;
-        if (str == "Wind Prayers") return Attribute::WindPrayers;
-        if (str == "Earth Prayers") return Attribute::EarthPrayers;
-        if (str == "Mysticism") return Attribute::Mysticism;
-
-        return Attribute::None;
+std::string GWMarket::WeaponDetails::toString() const
+{
+    std::string out;
+    const auto attrib_data = GW::SkillbarMgr::GetAttributeConstantData(attribute);
+    if (attrib_data) {
+        out += std::format("Req.{} {}", requirement, Resources::DecodeStringId(attrib_data->name_id, GW::Constants::Language::English)->string().c_str());
     }
+    if (inscribable) {
+        if (!out.empty()) out += ", ";
+        out += "Inscribable";
+    }
+    return out;
+}
 
-    // Data structures
-    struct Price {
-        Currency type = Currency::Platinum;
-        float quantity = 1.f;
-        float price = 5.f;
+bool GWMarket::WeaponDetails::valid() const
+{
+    return GetAttributeName(attribute) != nullptr;
+}
 
-        static Price FromJson(const json& j)
-        {
-            Price p;
-            p.type = static_cast<Currency>(parseIntFromJson(j, "type", 0));
-            p.quantity = (float)parseIntFromJson(j, "quantity", 0);
-            p.quantity = parseFloatFromJson(j, "unit", p.quantity);
-            p.price = parseFloatFromJson(j, "price", 0.f);
-            return p;
-        }
-        json ToJson() const
-        {
-            json j;
-            if (!valid()) return j;
-            j["type"] = static_cast<int>(type);
-            j["quantity"] = quantity;
-            j["unit"] = quantity;
-            j["price"] = price;
-            return j;
-        }
-        bool valid() const { return quantity && price; }
-    };
-    struct WeaponDetails {
-        // "weaponDetails":{"attribute":"Tactics","requirement":9,"inscription":true,"oldschool":false,"core":null,"prefix":null,"suffix":null},
-        GW::Constants::Attribute attribute = GW::Constants::Attribute::None;
-        uint8_t requirement = 0;
-        bool inscribable = false;
-        bool oldschool = false;
-        static WeaponDetails FromJson(const json& j)
-        {
-            WeaponDetails p;
-            p.attribute = AttributeFromString(parseStringFromJson(j, "attribute", ""));
+GWMarket::json GWMarket::WeaponDetails::ToJson() const
+{
+    if (!valid()) return {};
+    json j;
+    j["attribute"] = *GetAttributeName(attribute);
+    j["requirement"] = requirement;
+    j["inscription"] = inscribable;
+    return j;
+}
 
+namespace {
+    // Orders for a single item, indexed by recency and by price.
+    // Each getItemOrders snapshot is diffed against the book, so only orders that actually changed are moved within the indexes, and drawing never sorts.
+    class OrderBook {
+        struct ByRecency {
+            bool operator()(const MarketItem* a, const MarketItem* b) const
+            {
+                if (a->lastRefresh != b->lastRefresh) return a->lastRefresh > b->lastRefresh;
+                return std::less<>{}(a, b);
+            }
+        };
+        struct ByPrice {
+            bool operator()(const MarketItem* a, const MarketItem* b) const
+            {
+                if (a->prices.empty() != b->prices.empty()) return b->prices.empty();
+                if (a->currency() != b->currency()) return a->currency() < b->currency();
+                if (a->price_per() != b->price_per()) return a->price_per() < b->price_per();
+                return std::less<>{}(a, b);
+            }
+        };
 
+        std::string name;
+        // The API doesn't give orders an id, so they're keyed by what identifies a listing
+        std::map<std::string, MarketItem> orders;
+        std::set<const MarketItem*, ByRecency> by_recency;
+        std::set<const MarketItem*, ByPrice> by_price;
 
-            p.requirement = parseIntFromJson(j, "requirement", 0) & 0xf;
-            p.inscribable = parseBoolFromJson(j, "inscription", false);
-            return p;
+        static std::string OrderKey(const MarketItem& order)
+        {
+            const auto& wd = order.weaponDetails;
+            return std::format("{}|{}|{}|{}|{}|{}", order.player, (int)order.orderType, (int)wd.attribute, wd.requirement, wd.inscribable, order.description);
         }
 
-        std::string toString() const
+        static bool SamePrices(const MarketItem& a, const MarketItem& b)
         {
-            std::string out;
-            const auto attrib_data = GW::SkillbarMgr::GetAttributeConstantData(attribute);
-            if (attrib_data) {
-                out += std::format("Req.{} {}", requirement, Resources::DecodeStringId(attrib_data->name_id, GW::Constants::Language::English)->string().c_str());
-            }
-            if (inscribable) {
-                if (!out.empty()) out += ", ";
-                out += "Inscribable";
-            }
-            return out;
+            return std::ranges::equal(a.prices, b.prices, [](const Price& l, const Price& r) {
+                return l.type == r.type && l.quantity == r.quantity && l.price == r.price;
+            });
         }
-        bool valid() const { return GetAttributeName(attribute) != nullptr; }
-        json ToJson() const
+
+        void AddToIndexes(const MarketItem* order)
         {
-            if (!valid()) return {};
-            json j;
-            j["attribute"] = *GetAttributeName(attribute);
-            j["requirement"] = requirement;
-            j["inscription"] = inscribable;
-            return j;
+            by_recency.insert(order);
+            by_price.insert(order);
         }
-    };
-
-    struct MarketItem {
-        std::string name;
-        std::string player;
-        OrderType orderType;
-        int quantity;
-        std::vector<Price> prices;
-        time_t lastRefresh = 0;
-        WeaponDetails weaponDetails;
-        std::string description;
-        float price_per() const { return prices.empty() ? 0.f : prices[0].price / quantity; }
-        Currency currency() const { return prices.empty() ? Currency::All : prices[0].type; }
 
-        bool valid() const { return !prices.empty() && lastRefresh && !name.empty(); }
-
-        static MarketItem FromJson(const json& j)
+        void RemoveFromIndexes(const MarketItem* order)
         {
-            MarketItem item;
-            if (j.is_discarded()) return item;
-
-            item.name = parseStringFromJson(j, "name", "");
-            item.player = parseStringFromJson(j, "player", "");
-            item.description = parseStringFromJson(j, "description", "");
-            item.orderType = static_cast<OrderType>(parseIntFromJson(j, "orderType", 0));
-            item.quantity = parseIntFromJson(j, "quantity", 0);
+            by_recency.erase(order);
+            by_price.erase(order);
+        }
 
-            if (j.contains("weaponDetails") && j["weaponDetails"].is_object()) {
-                item.weaponDetails = WeaponDetails::FromJson(j["weaponDetails"]);
-            }
+    public:
+        [[nodiscard]] const std::string& item_name() const { return name; }
+        [[nodiscard]] bool empty() const { return orders.empty(); }
 
-            uint64_t lastRefresh_ms = parseUint64FromJson(j, "lastRefresh", 0ULL);
-            item.lastRefresh = lastRefresh_ms ? lastRefresh_ms / 1000 : 0;
+        void Clear()
+        {
+            by_recency.clear();
+            by_price.clear();
+            orders.clear();
+            name.clear();
+        }
 
-            if (j.contains("prices") && j["prices"].is_array()) {
-                for (const auto& price_json : j["prices"]) {
-                    auto p = Price::FromJson(price_json);
-                    if (p.valid()) item.prices.push_back(p);
+        // Brings the book in line with a full list of orders for one item; a list for a different item replaces the book.
+        void Apply(const std::vector<MarketItem>& snapshot)
+        {
+            if (snapshot.empty()) return;
+            if (snapshot[0].name != name) {
+                Clear();
+                name = snapshot[0].name;
+            }
+            std::unordered_set<std::string> seen;
+            seen.reserve(snapshot.size());
+            for (const auto& order : snapshot) {
+                auto key = OrderKey(order);
+                // Duplicate listings from the same player are kept apart
+                while (seen.contains(key)) {
+                    key += '+';
+                }
+                seen.insert(key);
+                const auto found = orders.find(key);
+                if (found == orders.end()) {
+                    AddToIndexes(&orders.emplace(std::move(key), order).first->second);
+                    continue;
                 }
+                auto& existing = found->second;
+                if (existing.quantity == order.quantity && existing.lastRefresh == order.lastRefresh && SamePrices(existing, order)) {
+                    continue;
+                }
+                RemoveFromIndexes(&existing);
+                existing = order;
+                AddToIndexes(&existing);
+            }
+            for (auto it = orders.begin(); it != orders.end();) {
+                if (seen.contains(it->first)) {
+                    ++it;
+                    continue;
+                }
+                RemoveFromIndexes(&it->second);
+                it = orders.erase(it);
             }
-
-            return item;
         }
-        json ToJson() const
-        {
-            json j;
-            if (!valid()) return j;
-            j["name"] = name;
-            j["player"] = player;
-            j["description"] = description;
-            j["orderType"] = static_cast<int>(orderType);
-            j["quantity"] = quantity;
-            j["lastRefresh"] = static_cast<uint64_t>(lastRefresh) * 1000; // Convert to milliseconds
 
-            if (has_weapon_details()) {
-                j["weaponDetails"] = weaponDetails.ToJson();
+        // Calls fn with each order, most recent or cheapest first
+        template <typename Fn>
+        void ForEach(const OrderSortMode mode, Fn&& fn) const
+        {
+            if (mode == OrderSortMode::Currency) {
+                for (const auto order : by_price) {
+                    fn(*order);
+                }
             }
-
-            j["prices"] = json::array();
-            for (const auto& price : prices) {
-                j["prices"].push_back(price.ToJson());
+            else {
+                for (const auto order : by_recency) {
+                    fn(*order);
+                }
             }
-
-            return j;
         }
-
-        bool has_weapon_details() const { return weaponDetails.attribute != GW::Constants::Attribute::None; }
     };
 
     bool collapsed = false;
@@ -376,9 +269,8 @@ namespace {
     size_t editing_item_index = 0;
 
     // Edit window - matching item orders
-    std::vector<MarketItem> edit_window_matching_orders;
+    OrderBook edit_window_book;
     std::string edit_window_matching_item_name;
-    bool edit_window_orders_needs_sort = true;
 
     struct ShopItem : MarketItem {
         bool hidden = false;
@@ -465,31 +357,19 @@ namespace {
     };
     MarketShop my_shop;
 
-    struct AvailableItem {
-        const std::string* name;
-        int sellOrders = 0;
-        int buyOrders = 0;
-    };
-
     // Settings
     bool auto_refresh = true;
     int refresh_interval = 60;
 
     // WebSocket
-    WebSocket* ws = nullptr;
-    bool ws_connecting = false;
-    WSAData wsaData = {0};
+    WebSocketConnection ws;
     RateLimiter ws_rate_limiter;
 
-    // Thread
-    std::queue<std::function<void()>> thread_jobs{};
-    bool should_stop = false;
-    std::thread* worker = nullptr;
-
     // Data
-    std::vector<AvailableItem> available_items;
+    // Keyed by interned name, so it stays sorted and can be looked up by name
+    std::map<std::string_view, AvailableItem> available_items;
     std::vector<MarketItem> last_items;
-    std::vector<MarketItem> current_item_orders;
+    OrderBook current_item_book;
     std::string current_viewing_item;
     std::map<std::string, AvailableItem> favorite_items;
 
@@ -506,8 +386,12 @@ namespace {
     int ping_timeout = 20000;
 
     OrderSortMode order_sort_mode = OrderSortMode::MostRecent;
-    bool available_items_needs_sort = true;
-    bool current_orders_needs_sort = true;
+
+    // Filtered view of available_items; only rebuilt when the listings, search text or filter change
+    std::vector<const AvailableItem*> visible_items;
+    bool visible_items_dirty = true;
+    std::string visible_items_search;
+    FilterMode visible_items_filter = SHOW_ALL;
 
     // Forward declarations
     void SendSocketStarted();
@@ -515,13 +399,12 @@ namespace {
     void SendGetLastItemsByFamily(const std::string& family);
     void SendGetItemOrders(const std::string& item_name);
     void SendPing();
-    void OnGetAvailableOrders(const json& orders);
-    void OnGetLastItems(const json& items);
-    void OnGetItemOrders(const json& orders);
+    void OnGetAvailableOrders(std::string_view payload);
+    void OnGetLastItems(std::string_view payload);
+    void OnGetItemOrders(std::string_view payload);
     void HandleSocketIOHandshake(const std::string& message);
     void OnNamespaceConnected();
     void OnWebSocketMessage(const std::string& message);
-    void DeleteWebSocket(WebSocket* socket);
     void ConnectWebSocket(const bool force);
     void DrawItemList();
     void DrawFavoritesList();
@@ -603,7 +486,7 @@ namespace {
 
     bool IsSocketIOReady()
     {
-        return ws && ws->getReadyState() == WebSocket::OPEN && socket_io_ready;
+        return ws.IsOpen() && socket_io_ready;
     }
 
     std::string EncodeSocketIOMessage(const std::string& event, const std::string& data = "")
@@ -624,79 +507,61 @@ namespace {
         return "42" + msg.dump();
     }
 
-    bool ParseSocketIOMessage(const std::string& message, std::string& event, json& data)
+    void OnGetAvailableOrders(const std::string_view payload)
     {
-        if (message.length() < 2 || message.substr(0, 2) != "42") return false;
-
-        json parsed = json::parse(message.substr(2), nullptr, false);
-        if (!parsed.is_discarded() && parsed.is_array() && parsed.size() >= 1) {
-            if (!parsed[0].is_string()) return false;
-            event = parsed[0].get<std::string>();
-            if (parsed.size() >= 2) {
-                data = parsed[1];
-                return true;
+        std::vector<AvailableItem> incoming_items;
+        if (!ParseAvailableOrders(payload, incoming_items)) {
+            return;
+        }
+        // Merge into the existing listings rather than rebuilding them, so an unchanged list doesn't invalidate the filtered view
+        std::unordered_set<std::string_view> seen;
+        seen.reserve(incoming_items.size());
+        for (const auto& incoming : incoming_items) {
+            const auto name = incoming.name;
+            seen.insert(*name);
+            auto& item = available_items[*name];
+            if (!item.name) {
+                item.name = name;
+                item.name_lower = TextUtils::ToLower(*name);
+                visible_items_dirty = true;
+            }
+            if (item.sellOrders != incoming.sellOrders || item.buyOrders != incoming.buyOrders) {
+                item.sellOrders = incoming.sellOrders;
+                item.buyOrders = incoming.buyOrders;
+                visible_items_dirty = true;
             }
         }
-        return true;
-    }
-
-    void OnGetAvailableOrders(const json& orders)
-    {
-        available_items.clear();
-        available_items.reserve(orders.size());
-        for (auto& i : favorite_items) {
-            i.second = {};
-        }
-        for (auto it = orders.begin(); it != orders.end(); ++it) {
-            AvailableItem item;
-            const auto& j = it.value();
-            item.name = InternString(it.key());
-            item.sellOrders = parseIntFromJson(j, "sellWeek", 0);
-            item.buyOrders = parseIntFromJson(j, "buyWeek", 0);
-            available_items.push_back(item);
-            if (favorite_items.contains(*item.name)) {
-                favorite_items[*item.name] = item;
-            }
-        }
-        available_items_needs_sort = true;
+        if (std::erase_if(available_items, [&seen](const auto& entry) { return !seen.contains(entry.first); })) {
+            visible_items_dirty = true;
+        }
+        for (auto& [name, favorite] : favorite_items) {
+            const auto found = available_items.find(name);
+            favorite = found != available_items.end() ? found->second : AvailableItem{};
+        }
         Log::Log("Received %zu available items", available_items.size());
     }
 
-    void OnGetLastItems(const json& items)
+    void OnGetLastItems(const std::string_view payload)
     {
-        last_items.clear();
-        if (items.is_array()) {
-            last_items.reserve(items.size());
-            for (const auto& item_json : items) {
-                last_items.push_back(MarketItem::FromJson(item_json));
-            }
-        }
+        last_items = ParseMarketItems(payload);
         Log::Log("Received %zu recent listings", last_items.size());
     }
 
-    void OnGetItemOrders(const json& orders)
+    void OnGetItemOrders(const std::string_view payload)
     {
-        std::vector<MarketItem> _orders;
-        if (orders.is_array()) {
-            _orders.reserve(orders.size());
-            for (const auto& order_json : orders) {
-                _orders.push_back(MarketItem::FromJson(order_json));
-            }
-        }
+        const auto _orders = ParseMarketItems(payload);
 
         if (!_orders.empty()) {
             const auto& item_name = _orders[0].name;
 
             // Update current viewing orders
             if (item_name == current_viewing_item) {
-                current_item_orders = _orders;
-                current_orders_needs_sort = true;
+                current_item_book.Apply(_orders);
             }
 
             // Update edit window matching orders
             if (item_name == edit_window_matching_item_name) {
-                edit_window_matching_orders = _orders;
-                edit_window_orders_needs_sort = true;
+                edit_window_book.Apply(_orders);
             }
         }
 
@@ -707,7 +572,7 @@ namespace {
     {
         if (!IsSocketIOReady()) return;
         std::string msg = EncodeSocketIOMessage("getPublicShop", uuid);
-        ws->send(msg);
+        ws.Send(msg);
         Log::Log("[SEND] %s", msg.c_str());
     }
     void OnShopInfo(const json& data)
@@ -751,8 +616,8 @@ namespace {
 
         Log::Log("Handshake: ping %dms, timeout %dms", ping_interval, ping_timeout);
 
-        if (ws && ws->getReadyState() == WebSocket::OPEN) {
-            ws->send("40");
+        if (ws.IsOpen()) {
+            ws.Send("40");
             Log::Log("[SEND] 40 (connecting to namespace)");
         }
 
@@ -772,7 +637,9 @@ namespace {
     {
         if (message.empty()) return;
 
-        Log::Log("[RECV] %s", message.c_str());
+        // Order snapshots can be hundreds of kilobytes
+        constexpr size_t max_logged = 256;
+        Log::Log("[RECV] %.*s%s", static_cast<int>(std::min(message.size(), max_logged)), message.data(), message.size() > max_logged ? "..." : "");
 
         char type = message[0];
 
@@ -784,8 +651,8 @@ namespace {
                 Log::Warning("Server close");
                 break;
             case '2':
-                if (ws && ws->getReadyState() == WebSocket::OPEN) {
-                    ws->send("3");
+                if (ws.IsOpen()) {
+                    ws.Send("3");
                     Log::Log("[SEND] 3");
                 }
                 break;
@@ -799,17 +666,25 @@ namespace {
                         OnNamespaceConnected();
                     }
                     else if (message[1] == '2') {
-                        std::string event;
-                        json data;
-                        if (!ParseSocketIOMessage(message, event, data)) break;
-
-                        if (event == "GetAvailableOrders")
-                            OnGetAvailableOrders(data);
-                        else if (event == "GetLastItems")
-                            OnGetLastItems(data);
-                        else if (event == "GetItemOrders")
-                            OnGetItemOrders(data);
-                        else if (event == "ShopCertificationSecret")
+                        std::string_view event;
+                        std::string_view payload;
+                        if (!ParseSocketIOMessage(message, event, payload)) break;
+
+                        // The big snapshots are parsed straight into our structs
+                        if (event == "GetAvailableOrders") {
+                            OnGetAvailableOrders(payload);
+                            break;
+                        }
+                        if (event == "GetLastItems") {
+                            OnGetLastItems(payload);
+                            break;
+                        }
+                        if (event == "GetItemOrders") {
+                            OnGetItemOrders(payload);
+                            break;
+                        }
+                        const json data = payload.empty() ? json() : json::parse(payload, nullptr, false);
+                        if (event == "ShopCertificationSecret")
                             OnShopCertificationSecret(data);
                         else if (event == "RefreshShop")
                             OnMyShopInfo(data);
@@ -825,7 +700,7 @@ namespace {
     {
         if (!IsSocketIOReady()) return;
         std::string msg = EncodeSocketIOMessage("SocketStarted");
-        ws->send(msg);
+        ws.Send(msg);
         Log::Log("[SEND] %s", msg.c_str());
     }
 
@@ -833,7 +708,7 @@ namespace {
     {
         if (!IsSocketIOReady()) return;
         std::string msg = EncodeSocketIOMessage("getAvailableOrders");
-        ws->send(msg);
+        ws.Send(msg);
         Log::Log("[SEND] %s", msg.c_str());
     }
 
@@ -841,7 +716,7 @@ namespace {
     {
         if (!IsSocketIOReady()) return;
         std::string msg = EncodeSocketIOMessage("getLastItemsByFamily", family);
-        ws->send(msg);
+        ws.Send(msg);
         Log::Log("[SEND] %s", msg.c_str());
     }
 
@@ -849,7 +724,7 @@ namespace {
     {
         if (!IsSocketIOReady()) return;
         std::string msg = EncodeSocketIOMessage("askPlayerCertification", std::string("some-garbage-id"));
-        ws->send(msg);
+        ws.Send(msg);
         Log::Log("[SEND] %s", msg.c_str());
     }
     void OnShopCertificationSecret(const json& data)
@@ -870,14 +745,14 @@ namespace {
     {
         if (!IsSocketIOReady()) return;
         std::string msg = EncodeSocketIOMessage("getItemOrders", item_name);
-        ws->send(msg);
+        ws.Send(msg);
         Log::Log("[SEND] %s", msg.c_str());
     }
 
     void SendPing()
     {
-        if (ws && ws->getReadyState() == WebSocket::OPEN) {
-            ws->send("2");
+        if (ws.IsOpen()) {
+            ws.Send("2");
             last_ping_time = clock();
             Log::Log("[SEND] 2");
         }
@@ -909,7 +784,7 @@ namespace {
         json data = shop.ToJson();
 
         std::string msg = EncodeSocketIOMessage("refreshShop", data);
-        ws->send(msg);
+        ws.Send(msg);
 
         Log::Log("[SEND] %s", msg.c_str());
     }
@@ -925,95 +800,61 @@ namespace {
     {
         if (!IsSocketIOReady() || shop.uuid.empty()) return;
         std::string msg = EncodeSocketIOMessage("closeShop", shop.uuid);
-        ws->send(msg);
+        ws.Send(msg);
         Log::Log("[SEND] %s", msg.c_str());
     }
 
-    void DeleteWebSocket(WebSocket* socket)
-    {
-        if (!socket) return;
-        if (socket->getReadyState() == WebSocket::OPEN) socket->close();
-        while (socket->getReadyState() != WebSocket::CLOSED)
-            socket->poll();
-        delete socket;
-    }
-
     void ConnectWebSocket(const bool force = false)
     {
-        if (ws || ws_connecting) return;
+        if (!ws.IsClosed()) return;
 
         if (!force && !ws_rate_limiter.AddTime(COST_PER_CONNECTION_MS, COST_PER_CONNECTION_MAX_MS)) {
             return;
         }
-        should_stop = true;
-        if (worker && worker->joinable()) worker->join();
-        delete worker;
-        should_stop = false;
-        worker = new std::thread([] {
-            while (!should_stop) {
-                std::function<void()> job;
-                bool found = false;
-
-                if (!thread_jobs.empty()) {
-                    job = thread_jobs.front();
-                    thread_jobs.pop();
-                    found = true;
-                }
-
-                if (found) job();
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            }
-        });
-
-        int res;
-        if (!wsaData.wVersion && (res = WSAStartup(MAKEWORD(2, 2), &wsaData)) != 0) {
-            Log::Error("WSAStartup failed: %d", res);
-            return;
-        }
 
-        ws_connecting = true;
-        thread_jobs.push([] {
-            std::string ws_host = std::format("wss://{}/socket.io/?EIO=4&transport=websocket", market_host);
-            ws = WebSocket::from_url(ws_host);
-            if (ws) {
-                Log::Log("Connected");
-                socket_io_ready = false;
-                last_ping_time = clock();
+        WebSocketConnection::Callbacks callbacks;
+        callbacks.on_message = OnWebSocketMessage;
+        callbacks.on_open = [] {
+            Log::Log("Connected");
+            socket_io_ready = false;
+            last_ping_time = clock();
+        };
+        callbacks.on_close = [](const bool was_open) {
+            // The websocket module reconnects by itself; socket.io handshakes again once it does
+            socket_io_ready = false;
+            if (was_open) {
+                Log::Warning("Disconnected");
             }
             else {
                 Log::Error("Connection failed");
             }
-            ws_connecting = false;
-        });
+        };
+        ws.Open(std::format("wss://{}/socket.io/?EIO=4&transport=websocket", market_host), std::move(callbacks));
     }
 
     void DrawItemList()
     {
         ImGui::Text("Available Listings (%zu)", available_items.size());
         ImGui::Separator();
-        // Sort only when data changes
-        if (available_items_needs_sort) {
-            std::sort(available_items.begin(), available_items.end(), [](const AvailableItem& a, const AvailableItem& b) {
-                return *a.name < *b.name;
-            });
 
-            available_items_needs_sort = false;
-        }
-
-        for (const auto& item : available_items) {
-            // Apply filter mode
-            if (filter_mode == SHOW_SELL_ONLY && item.sellOrders == 0) continue;
-            if (filter_mode == SHOW_BUY_ONLY && item.buyOrders == 0) continue;
-
-            // Apply search filter
-            if (search_buffer[0] != '\0') {
-                std::string search_lower = search_buffer;
-                std::string name_lower = *item.name;
-                std::transform(search_lower.begin(), search_lower.end(), search_lower.begin(), ::tolower);
-                std::transform(name_lower.begin(), name_lower.end(), name_lower.begin(), ::tolower);
-                if (name_lower.find(search_lower) == std::string::npos) continue;
+        auto search_lower = TextUtils::ToLower(search_buffer);
+        if (visible_items_dirty || filter_mode != visible_items_filter || search_lower != visible_items_search) {
+            visible_items.clear();
+            for (const auto& item : available_items | std::views::values) {
+                // Apply filter mode
+                if (filter_mode == SHOW_SELL_ONLY && item.sellOrders == 0) continue;
+                if (filter_mode == SHOW_BUY_ONLY && item.buyOrders == 0) continue;
+                // Apply search filter
+                if (!search_lower.empty() && item.name_lower.find(search_lower) == std::string::npos) continue;
+                visible_items.push_back(&item);
             }
+            visible_items_search = std::move(search_lower);
+            visible_items_filter = filter_mode;
+            visible_items_dirty = false;
+        }
 
+        for (const auto item_ptr : visible_items) {
+            const auto& item = *item_ptr;
             ImGui::PushID(item.name);
 
             bool selected = (current_viewing_item == *item.name);
@@ -1074,12 +915,10 @@ namespace {
             favorite_items.erase(item_name);
         }
         else {
-            const auto found = std::ranges::find_if(available_items.begin(), available_items.end(), [item_name](auto& item) {
-                return *item.name == item_name;
-            });
+            const auto found = available_items.find(item_name);
             favorite_items[item_name] = {};
             if (found != available_items.end()) {
-                favorite_items[item_name] = *found;
+                favorite_items[item_name] = found->second;
             }
         }
     }
@@ -1098,11 +937,9 @@ namespace {
         if (ImGui::BeginCombo("##sort_mode", order_sort_mode == OrderSortMode::MostRecent ? "Most Recent" : "Currency")) {
             if (ImGui::Selectable("Most Recent", order_sort_mode == OrderSortMode::MostRecent)) {
                 order_sort_mode = OrderSortMode::MostRecent;
-                current_orders_needs_sort = true;
             }
             if (ImGui::Selectable("Currency", order_sort_mode == OrderSortMode::Currency)) {
                 order_sort_mode = OrderSortMode::Currency;
-                current_orders_needs_sort = true;
             }
             ImGui::EndCombo();
         }
@@ -1149,30 +986,11 @@ namespace {
             ImGui::Separator();
         }
 
-        if (current_item_orders.empty()) {
+        if (current_item_book.empty() || current_item_book.item_name() != current_viewing_item) {
             ImGui::Text("Loading...");
             return;
         }
 
-        // Sort orders only when data changes or sort mode changes
-        if (current_orders_needs_sort) {
-            if (order_sort_mode == OrderSortMode::Currency) {
-                // Sort by price (cheapest first)
-                std::sort(current_item_orders.begin(), current_item_orders.end(), [](const MarketItem& a, const MarketItem& b) {
-                    if (a.prices.empty() || b.prices.empty()) return false;
-                    if (a.currency() != b.currency()) return a.currency() < b.currency();
-                    return a.price_per() < b.price_per();
-                });
-            }
-            else {
-                // Sort by most recent
-                std::sort(current_item_orders.begin(), current_item_orders.end(), [](const MarketItem& a, const MarketItem& b) {
-                    return a.lastRefresh > b.lastRefresh;
-                });
-            }
-            current_orders_needs_sort = false;
-        }
-
         const auto font_size = ImGui::CalcTextSize(" ");
         auto DrawOrder = [font_size](const MarketItem& order) {
             // NB: Seems to be an array of prices given by the API, but the website only shows the first one?
@@ -1233,16 +1051,16 @@ namespace {
         ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "SELL ORDERS:");
         ImGui::Separator();
 
-        for (const auto& order : current_item_orders) {
+        current_item_book.ForEach(order_sort_mode, [&DrawOrder](const MarketItem& order) {
             if (order.orderType == OrderType::Sell && order.valid()) DrawOrder(order);
-        }
+        });
 
         ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.0f, 1.0f), "BUY ORDERS:");
         ImGui::Separator();
 
-        for (const auto& order : current_item_orders) {
+        current_item_book.ForEach(order_sort_mode, [&DrawOrder](const MarketItem& order) {
             if (order.orderType == OrderType::Buy && order.valid()) DrawOrder(order);
-        }
+        });
     }
 
     void DrawEditWindowMatchingOrders()
@@ -1256,22 +1074,11 @@ namespace {
         ImGui::TextWrapped("%s", edit_window_matching_item_name.c_str());
         ImGui::Separator();
 
-        if (edit_window_matching_orders.empty()) {
+        if (edit_window_book.empty()) {
             ImGui::Text("Loading...");
             return;
         }
 
-        // Sort orders only when data changes
-        if (edit_window_orders_needs_sort) {
-            // Sort by price (cheapest first)
-            std::sort(edit_window_matching_orders.begin(), edit_window_matching_orders.end(), [](const MarketItem& a, const MarketItem& b) {
-                if (a.prices.empty() || b.prices.empty()) return false;
-                if (a.currency() != b.currency()) return a.currency() < b.currency();
-                return a.price_per() < b.price_per();
-            });
-            edit_window_orders_needs_sort = false;
-        }
-
         const auto font_size = ImGui::CalcTextSize(" ");
         auto DrawOrder = [font_size](const MarketItem& order) {
             if (order.prices.empty()) return;
@@ -1324,7 +1131,7 @@ namespace {
 
         // Show sell orders first
         bool has_sell_orders = false;
-        for (const auto& order : edit_window_matching_orders) {
+        edit_window_book.ForEach(OrderSortMode::Currency, [&](const MarketItem& order) {
             if (order.orderType == OrderType::Sell && order.valid()) {
                 if (!has_sell_orders) {
                     ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "SELL ORDERS:");
@@ -1333,11 +1140,11 @@ namespace {
                 }
                 DrawOrder(order);
             }
-        }
+        });
 
         // Show buy orders
         bool has_buy_orders = false;
-        for (const auto& order : edit_window_matching_orders) {
+        edit_window_book.ForEach(OrderSortMode::Currency, [&](const MarketItem& order) {
             if (order.orderType == OrderType::Buy && order.valid()) {
                 if (!has_buy_orders) {
                     ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.0f, 1.0f), "BUY ORDERS:");
@@ -1346,7 +1153,7 @@ namespace {
                 }
                 DrawOrder(order);
             }
-        }
+        });
 
         if (!has_sell_orders && !has_buy_orders) {
             ImGui::TextDisabled("No active orders found");
@@ -1502,21 +1309,18 @@ namespace {
                 strncpy(last_search_name, editing_item.name_buffer, sizeof(last_search_name) - 1);
 
                 // Find matching item in available_items
-                const auto found = std::ranges::find_if(available_items.begin(), available_items.end(), [](const AvailableItem& item) {
-                    return *item.name == last_search_name;
-                });
+                const auto found = available_items.find(last_search_name);
 
                 if (found != available_items.end()) {
                     // Found a match, request order info
-                    edit_window_matching_item_name = *found->name;
-                    edit_window_matching_orders.clear();
-                    edit_window_orders_needs_sort = true;
+                    edit_window_matching_item_name = *found->second.name;
+                    edit_window_book.Clear();
                     SendGetItemOrders(edit_window_matching_item_name);
                 }
                 else {
                     // No match found
                     edit_window_matching_item_name.clear();
-                    edit_window_matching_orders.clear();
+                    edit_window_book.Clear();
                 }
             }
 
@@ -1599,7 +1403,7 @@ namespace {
 
                 editing_item.Reset();
                 edit_window_matching_item_name.clear();
-                edit_window_matching_orders.clear();
+                edit_window_book.Clear();
                 memset(last_search_name, 0, sizeof(last_search_name));
                 show_edit_item_window = false;
             }
@@ -1608,7 +1412,7 @@ namespace {
             if (ImGui::Button("Cancel", ImVec2(120, 0))) {
                 editing_item.Reset();
                 edit_window_matching_item_name.clear();
-                edit_window_matching_orders.clear();
+                edit_window_book.Clear();
                 memset(last_search_name, 0, sizeof(last_search_name));
                 show_edit_item_window = false;
             }
@@ -1623,7 +1427,7 @@ namespace {
                     }
                     editing_item.Reset();
                     edit_window_matching_item_name.clear();
-                    edit_window_matching_orders.clear();
+                    edit_window_book.Clear();
                     memset(last_search_name, 0, sizeof(last_search_name));
                     show_edit_item_window = false;
                 }
@@ -1634,15 +1438,10 @@ namespace {
 
     void Disconnect()
     {
-        if (!ws) return;
-        should_stop = true;
-        CloseShop(my_shop);
-        if (worker && worker->joinable()) worker->join();
-        delete worker;
-        worker = 0;
-        DeleteWebSocket(ws);
-        ws = nullptr;
-        ws_connecting = socket_io_ready = false;
+        if (ws.IsClosed()) return;
+        CloseShop(my_shop); // Still goes out; Close() flushes anything already sent
+        ws.Close();
+        socket_io_ready = false;
     }
 
     GW::HookEntry OnPostUIMessage_HookEntry;
@@ -1757,25 +1556,16 @@ void GWMarketWindow::Update(float delta)
 {
     ToolboxWindow::Update(delta);
 
-    if (ws) {
+    if (!ws.IsClosed()) {
         if (!ShouldConnect()) {
             Disconnect();
             ws_rate_limiter = {};
             return;
         }
-        ws->poll();
-        ws->dispatch([](const std::string& msg) {
-            OnWebSocketMessage(msg);
-        });
 
         // Don't send our own pings - just respond to server pings with pongs
         // The server will ping us every 25 seconds
 
-        if (ws->getReadyState() == WebSocket::CLOSED) {
-            Log::Warning("Disconnected");
-            Disconnect();
-            return;
-        }
         if (auto_refresh && socket_io_ready) {
             refresh_timer += delta;
             if (refresh_timer >= refresh_interval) {
@@ -1784,7 +1574,7 @@ void GWMarketWindow::Update(float delta)
             }
         }
     }
-    if (!ws && ShouldConnect()) ConnectWebSocket();
+    if (ws.IsClosed() && ShouldConnect()) ConnectWebSocket();
 }
 
 bool GWMarketWindow::CanSellItem(GW::Item* _item)
@@ -1859,7 +1649,7 @@ void GWMarketWindow::DrawSettingsInternal()
     if (socket_io_ready) {
         ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Connected");
     }
-    else if (ws_connecting) {
+    else if (ws.IsConnecting()) {
         ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Connecting...");
     }
     else {
@@ -1887,7 +1677,7 @@ void GWMarketWindow::Draw(IDirect3DDevice9*)
         if (socket_io_ready) {
             ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Connected");
         }
-        else if (ws_connecting) {
+        else if (ws.IsConnecting()) {
             ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Connecting...");
         }
         else {
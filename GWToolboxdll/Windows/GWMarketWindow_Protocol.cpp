@@ -0,0 +1,419 @@
+#include "stdafx.h"
+
+#include "GWMarketWindow_Protocol.h"
+
+namespace {
+    using namespace GWMarket;
+
+    std::unordered_set<std::string> string_pool;
+
+    // No-op handlers for nlohmann's SAX interface. The parsers below hide whichever events they need, and fill our structs straight from the token
+    // stream, without building a json DOM of what can be a very large snapshot.
+    struct SaxHandler {
+        bool null() { return true; }
+        bool boolean(bool) { return true; }
+        bool number_integer(json::number_integer_t) { return true; }
+        bool number_unsigned(json::number_unsigned_t) { return true; }
+        bool number_float(json::number_float_t, const json::string_t&) { return true; }
+        bool string(json::string_t&) { return true; }
+        bool binary(json::binary_t&) { return true; }
+        bool start_object(size_t) { return true; }
+        bool key(json::string_t&) { return true; }
+        bool end_object() { return true; }
+        bool start_array(size_t) { return true; }
+        bool end_array() { return true; }
+        bool parse_error(size_t, const std::string&, const json::exception&) { return false; }
+    };
+
+    // {"<item name>": {"sellWeek": n, "buyWeek": n, ...}, ...}
+    struct AvailableOrdersSax : SaxHandler {
+        std::vector<AvailableItem> items;
+        size_t depth = 0;
+        int* field = nullptr; // Where the next number at depth 2 goes
+
+        bool start_object(size_t)
+        {
+            depth++;
+            return true;
+        }
+        bool end_object()
+        {
+            depth--;
+            return true;
+        }
+        bool start_array(size_t)
+        {
+            depth++;
+            return true;
+        }
+        bool end_array()
+        {
+            depth--;
+            return true;
+        }
+        bool key(json::string_t& key)
+        {
+            if (depth == 1) {
+                items.push_back({.name = InternString(key), .name_lower = {}, .sellOrders = 0, .buyOrders = 0});
+                field = nullptr;
+            }
+            else if (depth == 2) {
+                auto& item = items.back();
+                field = key == "sellWeek" ? &item.sellOrders : key == "buyWeek" ? &item.buyOrders : nullptr;
+            }
+            return true;
+        }
+        bool number_integer(const json::number_integer_t value)
+        {
+            if (depth == 2 && field) *field = static_cast<int>(value);
+            return true;
+        }
+        bool number_unsigned(const json::number_unsigned_t value)
+        {
+            if (depth == 2 && field) *field = static_cast<int>(value);
+            return true;
+        }
+    };
+
+    // [{"name": ..., "player": ..., "prices": [{...}], "weaponDetails": {...}, ...}, ...]; same rules as MarketItem::FromJson
+    struct MarketItemsSax : SaxHandler {
+        enum class Scope { Items, Item, WeaponDetails, Prices, Price, Skip };
+        std::vector<MarketItem> items;
+        std::vector<Scope> scopes;
+        std::string current_key;
+        Price price;
+        bool price_has_unit = false;
+
+        [[nodiscard]] Scope Current() const { return scopes.empty() ? Scope::Skip : scopes.back(); }
+
+        bool start_array(size_t)
+        {
+            if (scopes.empty()) scopes.push_back(Scope::Items);
+            else if (Current() == Scope::Item && current_key == "prices") scopes.push_back(Scope::Prices);
+            else scopes.push_back(Scope::Skip);
+            return true;
+        }
+        bool end_array()
+        {
+            scopes.pop_back();
+            return true;
+        }
+        bool start_object(size_t)
+        {
+            switch (Current()) {
+                case Scope::Items:
+                    items.emplace_back();
+                    items.back().orderType = OrderType::Sell;
+                    items.back().quantity = 0;
+                    scopes.push_back(Scope::Item);
+                    break;
+                case Scope::Item:
+                    scopes.push_back(current_key == "weaponDetails" ? Scope::WeaponDetails : Scope::Skip);
+                    break;
+                case Scope::Prices:
+                    price = {Currency::Platinum, 0.f, 0.f};
+                    price_has_unit = false;
+                    scopes.push_back(Scope::Price);
+                    break;
+                default:
+                    scopes.push_back(Scope::Skip);
+                    break;
+            }
+            return true;
+        }
+        bool end_object()
+        {
+            if (Current() == Scope::Price && price.valid()) {
+                items.back().prices.push_back(price);
+            }
+            scopes.pop_back();
+            return true;
+        }
+        bool key(json::string_t& key)
+        {
+            current_key = std::move(key);
+            return true;
+        }
+        bool string(json::string_t& value)
+        {
+            switch (Current()) {
+                case Scope::Item: {
+                    auto& item = items.back();
+                    if (current_key == "name") item.name = std::move(value);
+                    else if (current_key == "player") item.player = std::move(value);
+                    else if (current_key == "description") item.description = std::move(value);
+                } break;
+                case Scope::WeaponDetails:
+                    if (current_key == "attribute") items.back().weaponDetails.attribute = AttributeFromString(value);
+                    break;
+                default:
+                    break;
+            }
+            return true;
+        }
+        bool boolean(const bool value)
+        {
+            if (Current() == Scope::WeaponDetails && current_key == "inscription") items.back().weaponDetails.inscribable = value;
+            return true;
+        }
+        bool number_unsigned(const json::number_unsigned_t value)
+        {
+            if (Current() == Scope::Item && current_key == "lastRefresh") {
+                items.back().lastRefresh = value / 1000;
+                return true;
+            }
+            return Integer(static_cast<int>(value));
+        }
+        bool number_integer(const json::number_integer_t value) { return Integer(static_cast<int>(value)); }
+        bool number_float(const json::number_float_t value, const json::string_t&)
+        {
+            if (Current() != Scope::Price) return true;
+            if (current_key == "unit") {
+                price.quantity = static_cast<float>(value);
+                price_has_unit = true;
+            }
+            else if (current_key == "price") price.price = static_cast<float>(value);
+            return true;
+        }
+        bool Integer(const int value)
+        {
+            switch (Current()) {
+                case Scope::Item: {
+                    auto& item = items.back();
+                    if (current_key == "orderType") item.orderType = static_cast<OrderType>(value);
+                    else if (current_key == "quantity") item.quantity = value;
+                } break;
+                case Scope::WeaponDetails:
+                    if (current_key == "requirement") items.back().weaponDetails.requirement = value & 0xf;
+                    break;
+                case Scope::Price:
+                    if (current_key == "type") price.type = static_cast<Currency>(value);
+                    else if (current_key == "quantity" && !price_has_unit) price.quantity = static_cast<float>(value);
+                    else if (current_key == "unit") {
+                        price.quantity = static_cast<float>(value);
+                        price_has_unit = true;
+                    }
+                    else if (current_key == "price") price.price = static_cast<float>(value);
+                    break;
+                default:
+                    break;
+            }
+            return true;
+        }
+    };
+
+    // Length of the json value at the start of s, by matching brackets outside strings; npos if it doesn't end cleanly.
+    // Only finds where it stops: the payload parsers still reject anything malformed inside it.
+    size_t JsonValueLength(const std::string_view s)
+    {
+        size_t depth = 0;
+        bool in_string = false;
+        for (size_t i = 0; i < s.size(); i++) {
+            const char c = s[i];
+            if (in_string) {
+                if (c == '\\') {
+                    i++;
+                }
+                else if (c == '"') {
+                    in_string = false;
+                    if (!depth) return i + 1;
+                }
+                continue;
+            }
+            switch (c) {
+                case '"':
+                    in_string = true;
+                    break;
+                case '[':
+                case '{':
+                    depth++;
+                    break;
+                case ']':
+                case '}':
+                    if (!depth) return std::string_view::npos;
+                    if (!--depth) return i + 1;
+                    break;
+                case ',':
+                    if (!depth) return i; // A number, true, false or null
+                    break;
+                default:
+                    break;
+            }
+        }
+        return depth || in_string ? std::string_view::npos : s.size();
+    }
+}
+
+namespace GWMarket {
+    std::string parseStringFromJson(const json& j, const char* key, const std::string& default_val)
+    {
+        if (!j.is_discarded() && j.contains(key) && j[key].is_string()) {
+            return j[key].get<std::string>();
+        }
+        return default_val;
+    }
+    int parseIntFromJson(const json& j, const char* key, const int& default_val)
+    {
+        if (!j.is_discarded() && j.contains(key) && j[key].is_number_integer()) {
+            return j[key].get<int>();
+        }
+        return default_val;
+    }
+    bool parseBoolFromJson(const json& j, const char* key, const bool& default_val)
+    {
+        if (!j.is_discarded() && j.contains(key) && j[key].is_boolean()) {
+            return j[key].get<bool>();
+        }
+        return default_val;
+    }
+    uint64_t parseUint64FromJson(const json& j, const char* key, const uint64_t& default_val)
+    {
+        if (!j.is_discarded() && j.contains(key) && j[key].is_number_unsigned()) {
+            return j[key].get<uint64_t>();
+        }
+        return default_val;
+    }
+    float parseFloatFromJson(const json& j, const char* key, const float& default_val)
+    {
+        if (!j.is_discarded() && j.contains(key)) {
+            if (j[key].is_number_float()) return j[key].get<float>();
+            if (j[key].is_number_integer()) return (float)j[key].get<int>();
+        }
+        return default_val;
+    }
+
+    const std::string* InternString(const std::string& str)
+    {
+        auto it = string_pool.insert(str);
+        return &(*it.first);
+    }
+
+    GW::Constants::Attribute AttributeFromString(const std::string& str)
+    {
+        using namespace GW::Constants;
+        // Mesmer
+        if (str == "Fast Casting") return Attribute::FastCasting;
+        if (str == "Illusion Magic") return Attribute::IllusionMagic;
+        if (str == "Domination Magic") return Attribute::DominationMagic;
+        if (str == "Inspiration Magic") return Attribute::InspirationMagic;
+
+        // Necromancer
+        if (str == "Blood Magic") return Attribute::BloodMagic;
+        if (str == "Death Magic") return Attribute::DeathMagic;
+        if (str == "Soul Reaping") return Attribute::SoulReaping;
+        if (str == "Curses") return Attribute::Curses;
+
+        // Elementalist
+        if (str == "Air Magic") return Attribute::AirMagic;
+        if (str == "Earth Magic") return Attribute::EarthMagic;
+        if (str == "Fire Magic") return Attribute::FireMagic;
+        if (str == "Water Magic") return Attribute::WaterMagic;
+        if (str == "Energy Storage") return Attribute::EnergyStorage;
+
+        // Monk
+        if (str == "Healing Prayers") return Attribute::HealingPrayers;
+        if (str == "Smiting Prayers") return Attribute::SmitingPrayers;
+        if (str == "Protection Prayers") return Attribute::ProtectionPrayers;
+        if (str == "Divine Favor") return Attribute::DivineFavor;
+
+        // Warrior
+        if (str == "Strength") return Attribute::Strength;
+        if (str == "Axe Mastery") return Attribute::AxeMastery;
+        if (str == "Hammer Mastery") return Attribute::HammerMastery;
+        if (str == "Swordsmanship") return Attribute::Swordsmanship;
+        if (str == "Tactics") return Attribute::Tactics;
+
+        // Ranger
+        if (str == "Beast Mastery") return Attribute::BeastMastery;
+        if (str == "Expertise") return Attribute::Expertise;
+        if (str == "Wilderness Survival") return Attribute::WildernessSurvival;
+        if (str == "Marksmanship") return Attribute::Marksmanship;
+
+        // Assassin
+        if (str == "Dagger Mastery") return Attribute::DaggerMastery;
+        if (str == "Deadly Arts") return Attribute::DeadlyArts;
+        if (str == "Shadow Arts") return Attribute::ShadowArts;
+        if (str == "Critical Strikes") return Attribute::CriticalStrikes;
+
+        // Ritualist
+        if (str == "Communing") return Attribute::Communing;
+        if (str == "Restoration Magic") return Attribute::RestorationMagic;
+        if (str == "Channeling Magic") return Attribute::ChannelingMagic;
+        if (str == "Spawning Power") return Attribute::SpawningPower;
+
+        // Paragon
+        if (str == "Spear Mastery") return Attribute::SpearMastery;
+        if (str == "Command") return Attribute::Command;
+        if (str == "Motivation") return Attribute::Motivation;
+        if (str == "Leadership") return Attribute::Leadership;
+
+        // Dervish
+        if (str == "Scythe Mastery") return Attribute::ScytheMastery;
+        if (str == "Wind Prayers") return Attribute::WindPrayers;
+        if (str == "Earth Prayers") return Attribute::EarthPrayers;
+        if (str == "Mysticism") return Attribute::Mysticism;
+
+        return Attribute::None;
+    }
+
+    bool ParseSocketIOMessage(const std::string_view message, std::string_view& event, std::string_view& payload)
+    {
+        if (!message.starts_with("42")) return false;
+        auto rest = message.substr(2);
+        const auto skip_whitespace = [&rest] {
+            while (!rest.empty() && isspace(static_cast<unsigned char>(rest.front()))) rest.remove_prefix(1);
+        };
+        skip_whitespace();
+        if (!rest.starts_with('[')) return false;
+        rest.remove_prefix(1);
+        skip_whitespace();
+        if (!rest.starts_with('"')) return false;
+        rest.remove_prefix(1);
+        // Event names are plain identifiers; anything escaped isn't one of ours
+        const auto event_end = rest.find_first_of("\"\\");
+        if (event_end == std::string_view::npos || rest[event_end] != '"') return false;
+        event = rest.substr(0, event_end);
+        rest.remove_prefix(event_end + 1);
+
+        while (!rest.empty() && isspace(static_cast<unsigned char>(rest.back()))) rest.remove_suffix(1);
+        if (!rest.ends_with(']')) return false;
+        rest.remove_suffix(1);
+        skip_whitespace();
+        if (rest.empty()) {
+            payload = {};
+            return true;
+        }
+        if (!rest.starts_with(',')) return false;
+        rest.remove_prefix(1);
+        // The payload parsers look at the first character to tell arrays from objects
+        skip_whitespace();
+        const auto length = JsonValueLength(rest);
+        if (length == std::string_view::npos) return false;
+        payload = rest.substr(0, length);
+        while (!payload.empty() && isspace(static_cast<unsigned char>(payload.back()))) payload.remove_suffix(1);
+        rest.remove_prefix(length);
+        skip_whitespace();
+        // Only the first argument is ours; any others are ignored, as long as the frame is valid json
+        if (!rest.empty() && !(rest.starts_with(',') && json::accept("[" + std::string(rest.substr(1)) + "]"))) return false;
+        return true;
+    }
+
+    std::vector<MarketItem> ParseMarketItems(const std::string_view payload)
+    {
+        MarketItemsSax sax;
+        if (!payload.starts_with('[') || !json::sax_parse(payload.begin(), payload.end(), &sax)) {
+            return {};
+        }
+        return std::move(sax.items);
+    }
+
+    bool ParseAvailableOrders(const std::string_view payload, std::vector<AvailableItem>& out)
+    {
+        AvailableOrdersSax sax;
+        if (!payload.starts_with('{') || !json::sax_parse(payload.begin(), payload.end(), &sax)) {
+            return false;
+        }
+        out = std::move(sax.items);
+        return true;
+    }
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <GWCA/Constants/Constants.h>
+
+#include <nlohmann/json.hpp>
+
+// gwmarket.net's socket.io messages and what they're read into. The big snapshots (available orders, item orders, last items) are parsed
+// straight from the frame with SAX handlers; everything else goes through a json DOM and the FromJson functions, which the SAX handlers
+// have to agree with. Nothing here needs the game, so it's built and checked outside of it too; see tests/GWMarketProtocolCheck.cpp.
+namespace GWMarket {
+    using json = nlohmann::json;
+
+    // Enums for type-safe representations
+    enum class Currency : uint32_t { Platinum = 0, Ecto = 1, Zkeys = 2, Arms = 3, Count = 4, All = 0xf };
+
+    enum class OrderType : uint8_t { Sell = 0, Buy = 1 };
+
+    // Safe string extraction helpers
+    std::string parseStringFromJson(const json& j, const char* key, const std::string& default_val);
+    int parseIntFromJson(const json& j, const char* key, const int& default_val);
+    bool parseBoolFromJson(const json& j, const char* key, const bool& default_val);
+    uint64_t parseUint64FromJson(const json& j, const char* key, const uint64_t& default_val);
+    float parseFloatFromJson(const json& j, const char* key, const float& default_val);
+
+    GW::Constants::Attribute AttributeFromString(const std::string& str);
+
+    // String interning to reduce memory footprint
+    const std::string* InternString(const std::string& str);
+
+    struct Price {
+        Currency type = Currency::Platinum;
+        float quantity = 1.f;
+        float price = 5.f;
+
+        static Price FromJson(const json& j)
+        {
+            Price p;
+            p.type = static_cast<Currency>(parseIntFromJson(j, "type", 0));
+            p.quantity = (float)parseIntFromJson(j, "quantity", 0);
+            p.quantity = parseFloatFromJson(j, "unit", p.quantity);
+            p.price = parseFloatFromJson(j, "price", 0.f);
+            return p;
+        }
+        json ToJson() const
+        {
+            json j;
+            if (!valid()) return j;
+            j["type"] = static_cast<int>(type);
+            j["quantity"] = quantity;
+            j["unit"] = quantity;
+            j["price"] = price;
+            return j;
+        }
+        bool valid() const { return quantity && price; }
+    };
+    struct WeaponDetails {
+        // "weaponDetails":{"attribute":"Tactics","requirement":9,"inscription":true,"oldschool":false,"core":null,"prefix":null,"suffix":null},
+        GW::Constants::Attribute attribute = GW::Constants::Attribute::None;
+        uint8_t requirement = 0;
+        bool inscribable = false;
+        bool oldschool = false;
+        static WeaponDetails FromJson(const json& j)
+        {
+            WeaponDetails p;
+            p.attribute = AttributeFromString(parseStringFromJson(j, "attribute", ""));
+            p.requirement = parseIntFromJson(j, "requirement", 0) & 0xf;
+            p.inscribable = parseBoolFromJson(j, "inscription", false);
+            return p;
+        }
+
+        // These need the game's attribute names
+        std::string toString() const;
+        bool valid() const;
+        json ToJson() const;
+    };
+
+    struct MarketItem {
+        std::string name;
+        std::string player;
+        OrderType orderType;
+        int quantity;
+        std::vector<Price> prices;
+        time_t lastRefresh = 0;
+        WeaponDetails weaponDetails;
+        std::string description;
+        float price_per() const { return prices.empty() ? 0.f : prices[0].price / quantity; }
+        Currency currency() const { return prices.empty() ? Currency::All : prices[0].type; }
+
+        bool valid() const { return !prices.empty() && lastRefresh && !name.empty(); }
+
+        static MarketItem FromJson(const json& j)
+        {
+            MarketItem item;
+            if (j.is_discarded()) return item;
+
+            item.name = parseStringFromJson(j, "name", "");
+            item.player = parseStringFromJson(j, "player", "");
+            item.description = parseStringFromJson(j, "description", "");
+            item.orderType = static_cast<OrderType>(parseIntFromJson(j, "orderType", 0));
+            item.quantity = parseIntFromJson(j, "quantity", 0);
+
+            if (j.contains("weaponDetails") && j["weaponDetails"].is_object()) {
+                item.weaponDetails = WeaponDetails::FromJson(j["weaponDetails"]);
+            }
+
+            uint64_t lastRefresh_ms = parseUint64FromJson(j, "lastRefresh", 0ULL);
+            item.lastRefresh = lastRefresh_ms ? lastRefresh_ms / 1000 : 0;
+
+            if (j.contains("prices") && j["prices"].is_array()) {
+                for (const auto& price_json : j["prices"]) {
+                    auto p = Price::FromJson(price_json);
+                    if (p.valid()) item.prices.push_back(p);
+                }
+            }
+
+            return item;
+        }
+        json ToJson() const
+        {
+            json j;
+            if (!valid()) return j;
+            j["name"] = name;
+            j["player"] = player;
+            j["description"] = description;
+            j["orderType"] = static_cast<int>(orderType);
+            j["quantity"] = quantity;
+            j["lastRefresh"] = static_cast<uint64_t>(lastRefresh) * 1000; // Convert to milliseconds
+
+            if (has_weapon_details()) {
+                j["weaponDetails"] = weaponDetails.ToJson();
+            }
+
+            j["prices"] = json::array();
+            for (const auto& price : prices) {
+                j["prices"].push_back(price.ToJson());
+            }
+
+            return j;
+        }
+
+        bool has_weapon_details() const { return weaponDetails.attribute != GW::Constants::Attribute::None; }
+    };
+
+    struct AvailableItem {
+        const std::string* name;
+        std::string name_lower; // For the search filter
+        int sellOrders = 0;
+        int buyOrders = 0;
+    };
+
+    // Splits a "42[event, data, ...]" frame without copying; payload is the raw json of data, or empty if there isn't any.
+    // Arguments after data are ignored.
+    bool ParseSocketIOMessage(std::string_view message, std::string_view& event, std::string_view& payload);
+    // GetItemOrders and GetLastItems: [{"name": ..., "prices": [...], ...}, ...]; empty if the payload isn't valid
+    std::vector<MarketItem> ParseMarketItems(std::string_view payload);
+    // GetAvailableOrders: {"<item name>": {"sellWeek": n, "buyWeek": n, ...}, ...}; names are interned. Returns false if the payload isn't valid.
+    bool ParseAvailableOrders(std::string_view payload, std::vector<AvailableItem>& out);
+}
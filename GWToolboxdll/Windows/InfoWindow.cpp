@@ -55,18 +55,21 @@
 
 #include <Modules/ItemDescriptionHandler.h>
 #include <Modules/ResignLogModule.h>
+#include <Modules/PartyBroadcastModule.h>
 #include <Modules/ToolboxSettings.h>
 #include <Modules/DialogModule.h>
 #include <Modules/GwDatTextureModule.h>
 #include <Modules/HallOfMonumentsModule.h>
 #include <Modules/AudioSettings.h>
 #include <Modules/Resources.h>
+#include <Modules/WebSocketModule.h>
 #include <Utils/ToolboxUtils.h>
 #include <Utils/ArenaNetFileParser.h>
 #include <Utils/TextUtils.h>
 
 #include <Logger.h>
 #include <GWToolbox.h>
+#include <RestClient.h>
 
 #include <CircurlarBuffer.h>
 #include <Widgets/WorldMapWidget.h>
@@ -957,6 +960,67 @@ namespace {
             }
             ImGui::PopID();
         }
+        if (ImGui::CollapsingHeader("Worker Queues")) {
+            constexpr std::array lane_names = {"Interactive", "Background", "Bulk"};
+            for (size_t i = 0; i < lane_names.size(); i++) {
+                const auto stats = Resources::GetWorkerQueueStats(static_cast<WorkerPriority>(i));
+                const auto started = stats.enqueued - stats.queued;
+                ImGui::PushID(static_cast<int>(i));
+                InfoField(lane_names[i], "%zu workers, %zu queued, %llu/%llu done", stats.workers, stats.queued, stats.completed, stats.enqueued);
+                InfoField("Wait (avg/max)", "%.2fms / %.2fms", started ? stats.total_wait_us / 1000.0 / started : 0.0, stats.max_wait_us / 1000.0);
+                InfoField("Run (avg)", "%.2fms", stats.completed ? stats.total_run_us / 1000.0 / stats.completed : 0.0);
+                ImGui::PopID();
+            }
+        }
+        if (ImGui::CollapsingHeader("HTTP Cache")) {
+            const auto stats = Resources::GetHttpCacheStats();
+            const auto lookups = stats.memory_hits + stats.disk_hits + stats.revalidated + stats.misses;
+            const auto hits = stats.memory_hits + stats.disk_hits + stats.revalidated;
+            InfoField("Hit rate", "%.1f%% of %llu", lookups ? hits * 100.0 / lookups : 0.0, lookups);
+            InfoField("Hits (mem/disk/304)", "%llu / %llu / %llu", stats.memory_hits, stats.disk_hits, stats.revalidated);
+            InfoField("Misses", "%llu", stats.misses);
+            InfoField("Size (mem/disk)", "%.1fKB / %.1fKB", stats.memory_bytes / 1024.0, stats.disk_bytes / 1024.0);
+            InfoField("Evictions", "%llu", stats.evictions);
+        }
+        if (ImGui::CollapsingHeader("HTTP Connections")) {
+            const auto stats = GetCurlStats();
+            const auto avg_ms = [&stats](const uint64_t total_us) {
+                return stats.Requests ? total_us / 1000.0 / stats.Requests : 0.0;
+            };
+            InfoField("Requests", "%llu", stats.Requests);
+            InfoField("Connections reused", "%llu", stats.Requests > stats.NewConnections ? stats.Requests - stats.NewConnections : 0);
+            InfoField("Avg DNS/TCP/TLS", "%.1fms / %.1fms / %.1fms", avg_ms(stats.NameLookupUs), avg_ms(stats.ConnectUs), avg_ms(stats.AppConnectUs));
+            InfoField("Avg total", "%.1fms", avg_ms(stats.TotalUs));
+            const auto dedup = Resources::GetDownloadDedupStats();
+            InfoField("Deduplicated", "%llu of %llu (%.1f%%)", dedup.deduplicated, dedup.requests, dedup.requests ? dedup.deduplicated * 100.0 / dedup.requests : 0.0);
+            for (const auto& host : GetCurlHostStats()) {
+                InfoField(host.Host.c_str(), "%llu reqs, %.1fKB on wire, %.1fKB decoded", host.Requests, host.CompressedBytes / 1024.0, host.DecodedBytes / 1024.0);
+            }
+        }
+        if (ImGui::CollapsingHeader("Request Scheduler")) {
+            for (const auto& host : Resources::GetHostRequestStats()) {
+                ImGui::PushID(host.host.c_str());
+                InfoField(host.host.c_str(), "%zu in flight, %zu queued, %.1f tokens", host.in_flight, host.queued, host.tokens);
+                InfoField("Requests", "%llu, %llu throttled, %llu retried, %llu refused", host.requests, host.throttled, host.retried, host.rejected);
+                InfoField("Wait (avg/max)", "%.2fms / %.2fms", host.requests ? host.total_wait_us / 1000.0 / host.requests : 0.0, host.max_wait_us / 1000.0);
+                if (host.backoff_remaining > 0.f) {
+                    InfoField("Backing off", "%.1fs", host.backoff_remaining);
+                }
+                ImGui::PopID();
+            }
+        }
+        if (ImGui::CollapsingHeader("WebSockets")) {
+            const auto stats = WebSocketModule::GetStats();
+            InfoField("Connections", "%zu, %zu open", stats.connections, stats.open);
+            InfoField("Messages", "%llu received, %llu sent", stats.messages_received, stats.messages_sent);
+            InfoField("Reconnects", "%llu", stats.reconnects);
+        }
+        if (ImGui::CollapsingHeader("Party Broadcast")) {
+            const auto stats = PartyBroadcast::GetStats();
+            InfoField("Protocol", "%s", stats.delta_protocol ? "Field deltas" : "Whole entries");
+            InfoField("Sent", "%llu messages (%llu full), %llu bytes", stats.messages_sent, stats.full_updates, stats.bytes_sent);
+            InfoField("Last minute", "%zu messages, %zu bytes", stats.messages_last_minute, stats.bytes_last_minute);
+        }
         const auto target = GW::Agents::GetTarget();
         if (target && ImGui::CollapsingHeader("Props within range of target")) {
             float range = GW::Constants::Range::Area;
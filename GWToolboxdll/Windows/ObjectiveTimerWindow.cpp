@@ -1154,7 +1154,7 @@ void ObjectiveTimerWindow::LoadRuns()
             }
         }
         loading = false;
-    });
+    }, WorkerPriority::Bulk);
 }
 
 void ObjectiveTimerWindow::SaveRuns()
@@ -1201,7 +1201,7 @@ void ObjectiveTimerWindow::SaveRuns()
         }
         runs_dirty = false;
         loading = false;
-    });
+    }, WorkerPriority::Bulk);
 }
 
 void ObjectiveTimerWindow::ClearObjectiveSets()
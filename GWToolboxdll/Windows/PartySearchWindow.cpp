@@ -562,33 +562,12 @@ void PartySearchWindow::fetch()
     });
 }
 
-bool PartySearchWindow::IsLfpAlert(std::string& message) const
+bool PartySearchWindow::IsLfpAlert(const std::string& message) const
 {
     if (!filter_alerts) {
         return true;
     }
-    std::regex word_regex;
-    std::smatch m;
-    static const auto regex_check = std::regex("^/(.*)/[a-z]?$", std::regex::ECMAScript | std::regex::icase);
-    for (const auto& word : alert_words) {
-        if (std::regex_search(word, m, regex_check)) {
-            try {
-                word_regex = std::regex(m._At(1).str(), std::regex::ECMAScript | std::regex::icase);
-            } catch (const std::exception&) {
-                // Silent fail; invalid regex
-            }
-            if (std::regex_search(message, word_regex)) {
-                return true;
-            }
-        }
-        else {
-            auto found = std::ranges::search(message, word, [](const char c1, const char c2) -> bool { return tolower(c1) == c2; }).begin();
-            if (found != message.end()) {
-                return true;
-            }
-        }
-    }
-    return false;
+    return alerts.Matches(message);
 }
 
 void PartySearchWindow::Draw(IDirect3DDevice9*)
@@ -756,7 +735,7 @@ void PartySearchWindow::DrawAlertsWindowContent(bool)
     ImGui::TextDisabled("(Each line is a separate keyword. Not case sensitive.)");
     if (ImGui::InputTextMultiline("##alertfilter", alert_buf, ALERT_BUF_SIZE,
                                   ImVec2(-1.0f, 0.0f))) {
-        ParseBuffer(alert_buf, alert_words);
+        ParseBuffer(alert_buf);
         alertfile_dirty = true;
     }
 }
@@ -777,7 +756,7 @@ void PartySearchWindow::LoadSettings(ToolboxIni* ini)
     if (alert_file.is_open()) {
         alert_file.get(alert_buf, ALERT_BUF_SIZE, '\0');
         alert_file.close();
-        ParseBuffer(alert_buf, alert_words);
+        ParseBuffer(alert_buf);
     }
     alert_file.close();
 }
@@ -800,17 +779,9 @@ void PartySearchWindow::SaveSettings(ToolboxIni* ini)
     }
 }
 
-void PartySearchWindow::ParseBuffer(const char* text, std::vector<std::string>& words)
+void PartySearchWindow::ParseBuffer(const char* text)
 {
-    words.clear();
-    std::istringstream stream(text);
-    std::string word;
-    while (std::getline(stream, word)) {
-        for (size_t i = 0; i < word.length(); i++) {
-            word[i] = static_cast<char>(tolower(word[i]));
-        }
-        words.push_back(word);
-    }
+    alerts.Compile(text);
 }
 
 void PartySearchWindow::AsyncWindowConnect(const bool force)
@@ -2,6 +2,7 @@
 
 #include <CircurlarBuffer.h>
 #include <ToolboxWindow.h>
+#include <Utils/AlertList.h>
 #include <Utils/RateLimiter.h>
 
 class PartySearchWindow : public ToolboxWindow {
@@ -90,7 +91,8 @@ private:
     bool print_game_chat = false;
     bool filter_alerts = false;
     char search_buffer[256] = {0};
-    std::vector<std::string> alert_words{};
+    // Compiled from alert_buf by ParseBuffer
+    AlertList alerts;
     std::vector<std::string> searched_words{};
     // tasks to be done async by the worker thread
     std::queue<std::function<void()>> thread_jobs{};
@@ -118,8 +120,8 @@ private:
     void AsyncWindowConnect(bool force = false);
     void fetch();
     static bool parse_json_message(const nlohmann::json& js, Message* msg);
-    static void ParseBuffer(const char* text, std::vector<std::string>& words);
+    void ParseBuffer(const char* text);
     static void DeleteWebSocket(easywsclient::WebSocket* ws);
-    bool IsLfpAlert(std::string& message) const;
+    bool IsLfpAlert(const std::string& message) const;
     static void OnRegionPartyUpdated(GW::HookStatus*, GW::Packet::StoC::PacketBase* packet);
 };
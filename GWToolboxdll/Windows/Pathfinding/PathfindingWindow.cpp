@@ -273,7 +273,7 @@ bool PathfindingWindow::CalculatePath(const GW::GamePos& from, const GW::GamePos
             });
         }
         pending_worker_task = false;
-    });
+    }, WorkerPriority::Interactive);
     return true;
 }
 
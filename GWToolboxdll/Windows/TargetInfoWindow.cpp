@@ -222,7 +222,9 @@ namespace {
     {
         loop:
         for (auto& agent_info : agent_info_by_name) {
-            if (agent_info.second->state != AgentInfo::TargetInfoState::Done) continue;
+            // Wiki fetches are cancelled before this is called, so their callbacks won't come back for it
+            const auto state = agent_info.second->state;
+            if (state != AgentInfo::TargetInfoState::Done && state != AgentInfo::TargetInfoState::FetchingWikiPage) continue;
             delete agent_info.second;
             agent_info_by_name.erase(agent_info.first);
             goto loop;
@@ -256,6 +258,7 @@ namespace {
             }
             case GW::UI::UIMessage::kMapLoaded: {
                 current_agent_info = nullptr;
+                TargetInfoWindow::Instance().CancelAsyncWork();
                 ClearAgentInfo();
                 break;
             }
@@ -319,7 +322,7 @@ namespace {
                     TextUtils::trim(agent_info->wiki_search_term);
                     std::string wiki_url = "https://wiki.guildwars.com/wiki/?search=";
                     wiki_url.append(TextUtils::UrlEncode(agent_info->wiki_search_term, '_'));
-                    Resources::Download(wiki_url, AgentInfo::OnFetchedWikiPage, agent_info);
+                    Resources::Download(wiki_url, AgentInfo::OnFetchedWikiPage, agent_info, std::chrono::days(1), WorkerPriority::Interactive, TargetInfoWindow::Instance().GetCancellationToken());
                 }
                 break;
             }
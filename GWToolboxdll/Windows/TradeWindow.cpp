@@ -21,9 +21,13 @@
 #include <Utils/GuiUtils.h>
 
 #include <Modules/Resources.h>
+#include <Modules/WebSocketModule.h>
 #include <Windows/TradeWindow.h>
 #include <GWToolbox.h>
+#include <Utils/AlertList.h>
 #include <Utils/TextUtils.h>
+#include <Utils/TradeHistory.h>
+#include <Timer.h>
 
 namespace {
     GW::HookEntry ChatCmd_HookEntry;
@@ -33,7 +37,6 @@ namespace {
     constexpr uint32_t COST_PER_CONNECTION_MS = 30 * 1000;
     constexpr uint32_t COST_PER_CONNECTION_MAX_MS = 60 * 1000;
     static const char* months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
-    using easywsclient::WebSocket;
     using nlohmann::json;
     using json_vec = std::vector<json>;
 
@@ -58,8 +61,6 @@ namespace {
     GW::PartySearch player_party_search = { 0 };
     char player_party_search_text[64] = { 0 };
 
-    WSAData wsaData = { 0 };
-
     bool is_kamadan_chat = true;
     bool refresh_footer = false;
 
@@ -89,21 +90,122 @@ namespace {
 
     char search_buffer[256] = {};
 
-    std::vector<std::string> alert_words{};
+    // Compiled from alert_buf whenever it changes, then swapped in whole; messages are checked from the game thread while the list is edited from the render thread.
+    std::atomic<std::shared_ptr<const AlertList>> trade_alerts;
+
     std::vector<std::string> searched_words{};
 
     CircularBuffer<Message> messages;
 
-    bool ws_window_connecting = false;
-
-    easywsclient::WebSocket* ws_window = nullptr;
+    WebSocketConnection trade_socket;
 
     RateLimiter window_rate_limiter;
 
     bool external_trade_message = false;
 
+    constexpr size_t MAX_MESSAGES = 100;
+    constexpr clock_t HISTORY_FLUSH_INTERVAL_MS = 10 * 1000;
+    TradeHistory trade_history;
+    clock_t last_history_flush = 0;
+    // messages holds results from the local history rather than the server
+    bool showing_history = false;
+
+    bool IsKamadan(const GW::Constants::MapID map_id)
+    {
+        using namespace GW::Constants;
+        switch (map_id) {
+            case MapID::Kamadan_Jewel_of_Istan_outpost:
+            case MapID::Kamadan_Jewel_of_Istan_Halloween_outpost:
+            case MapID::Kamadan_Jewel_of_Istan_Wintersday_outpost:
+            case MapID::Kamadan_Jewel_of_Istan_Canthan_New_Year_outpost:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Map that the connected feed's messages were said in
+    GW::Constants::MapID feed_map_id()
+    {
+        return is_kamadan_chat ? GW::Constants::MapID::Kamadan_Jewel_of_Istan_outpost : GW::Constants::MapID::Ascalon_City_pre_searing;
+    }
+
+    bool is_feed_message(const TradeHistory::Message& msg)
+    {
+        const auto map_id = static_cast<GW::Constants::MapID>(msg.map_id);
+        return is_kamadan_chat ? IsKamadan(map_id) : map_id == GW::Constants::MapID::Ascalon_City_pre_searing;
+    }
+
+    // Whether either feed's history would show trade chat said here; nothing else is worth keeping
+    bool is_feed_map(const GW::Constants::MapID map_id)
+    {
+        return IsKamadan(map_id) || map_id == GW::Constants::MapID::Ascalon_City_pre_searing;
+    }
+
+    void record_message(const Message& msg, const GW::Constants::MapID map_id)
+    {
+        trade_history.Add({msg.timestamp, static_cast<uint32_t>(map_id), msg.name, msg.message});
+    }
+
+    // The player's text from an encoded trade chat message, or empty
+    std::wstring_view get_trade_message_text(const wchar_t* message)
+    {
+        auto start = wcsrchr(message, 0x107);
+        if (!start) {
+            return {};
+        }
+        start++;
+        const auto end = wcschr(start, 0x1);
+        if (!end) {
+            return {};
+        }
+        return {start, end};
+    }
+
+    void print_search_result(const Message& msg)
+    {
+        std::wstring name_ws = TextUtils::StringToWString(msg.name);
+        std::wstring msg_ws = TextUtils::StringToWString(msg.message);
+        time_t ts = msg.timestamp;
+        tm* local_tm = localtime(&ts);
+        if (local_tm) {
+            wchar_t buf[512];
+            swprintf(buf, 512, L"<a=1>%s</a> @ %S %d, %02d:%02d: <c=#f96677><quote>%s", name_ws.c_str(), months[local_tm->tm_mon], local_tm->tm_mday, local_tm->tm_hour, local_tm->tm_min, msg_ws.c_str());
+            WriteChat(GW::Chat::Channel::CHANNEL_TRADE, buf, nullptr, true);
+        }
+    }
+
+    // Fills the window from the local history
+    void show_history(const std::string& query, const bool print_results_in_chat)
+    {
+        const auto results = trade_history.Search(query, MAX_MESSAGES, is_feed_message);
+        messages.clear();
+        for (const auto& result : results | std::views::reverse) {
+            messages.add({result.timestamp, result.name, result.message});
+        }
+        showing_history = true;
+        if (!print_results_in_chat) {
+            return;
+        }
+        if (results.empty()) {
+            Log::Warning("No results found for %s", query.c_str());
+            return;
+        }
+        for (size_t i = std::min<size_t>(results.size(), 12); i-- > 0;) {
+            print_search_result({results[i].timestamp, results[i].name, results[i].message});
+        }
+    }
+
     void search(const std::string& query, const bool print_results_in_chat = false)
     {
+        // Answer from the local history straight away; if the server can be reached, its results replace these when they arrive
+        const bool online = !trade_socket.IsClosed();
+        show_history(query, print_results_in_chat && !online);
+        if (!online) {
+            pending_query_string.clear();
+            print_search_results = false;
+            return;
+        }
         pending_query_string = query.empty() ? " " : query;
         print_search_results = print_results_in_chat;
         pending_query_sent = 0;
@@ -158,35 +260,24 @@ namespace {
         search(item_to_search, true);
     }
 
-    bool IsTradeAlert(std::string& message)
+    // Swapped in whole, so a message being checked never sees a half-compiled list
+    void CompileAlerts(const char* text)
+    {
+        auto alerts = std::make_shared<AlertList>();
+        alerts->Compile(text);
+        trade_alerts.store(std::move(alerts));
+    }
+
+    bool IsTradeAlert(const std::string& message)
     {
         if (!filter_alerts) {
             return true;
         }
-        std::regex word_regex;
-        std::smatch m;
-        static const auto regex_check = std::regex("^/(.*)/[a-z]?$", std::regex::ECMAScript | std::regex::icase);
-        for (const auto& word : alert_words) {
-            if (std::regex_search(word, m, regex_check)) {
-                try {
-                    word_regex = std::regex(m._At(1).str(), std::regex::ECMAScript | std::regex::icase);
-                } catch (const std::exception&) {
-                    // Silent fail; invalid regex
-                }
-                if (std::regex_search(message, word_regex)) {
-                    return true;
-                }
-            }
-            else {
-                auto found = std::ranges::search(message, word, [](const char c1, const char c2) -> bool {
-                                 return tolower(c1) == c2;
-                             }).begin();
-                if (found != message.end()) {
-                    return true;
-                }
-            }
+        const auto alerts = trade_alerts.load();
+        if (!alerts) {
+            return false;
         }
-        return false;
+        return alerts->Matches(message);
     }
 
     GW::HookEntry OnUIMessage_Entry;
@@ -199,7 +290,12 @@ namespace {
                 const auto packet = (GW::UI::UIPacket::kPlayerChatMessage*)wparam;
                 if (packet->channel != GW::Chat::Channel::CHANNEL_TRADE) break;
                 message = packet->message;
-                break;
+                const auto text = get_trade_message_text(message);
+                const auto sender = GW::PlayerMgr::GetPlayerName(packet->player_number);
+                const auto map_id = GW::Map::GetMapID();
+                if (!text.empty() && sender && is_feed_map(map_id)) {
+                    trade_history.Add({static_cast<uint32_t>(time(nullptr)), static_cast<uint32_t>(map_id), TextUtils::WStringToString(TextUtils::SanitizePlayerName(sender)), TextUtils::WStringToString(text)});
+                }
             } break;
                 case GW::UI::UIMessage::kWriteToChatLog: {
                 const auto packet = (GW::UI::UIPacket::kWriteToChatLog*)wparam;
@@ -208,16 +304,11 @@ namespace {
             } break;
         }
         if (message && filter_alerts && (external_trade_message || filter_local_trade)) {
-            auto start = wcsrchr(message, 0x107);
-            if (!start) {
-                return;
-            }
-            start++;
-            const auto end = wcschr(start, 0x1);
-            if (!end) {
+            const auto text = get_trade_message_text(message);
+            if (text.empty()) {
                 return;
             }
-            std::string message_utf8 = TextUtils::WStringToString(std::wstring(start, end));
+            std::string message_utf8 = TextUtils::WStringToString(text);
             if (!IsTradeAlert(message_utf8)) {
                 status->blocked = true;
             }
@@ -230,20 +321,9 @@ void TradeWindow::Initialize()
 {
     ToolboxWindow::Initialize();
 
-    messages = CircularBuffer<Message>(100);
+    messages = CircularBuffer<Message>(MAX_MESSAGES);
+    trade_history.Load(Resources::GetPath(L"trade history"));
 
-    should_stop = false;
-    worker = new std::thread([this] {
-        while (!should_stop) {
-            if (thread_jobs.empty()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            }
-            else {
-                thread_jobs.front()();
-                thread_jobs.pop();
-            }
-        }
-    });
     GW::Chat::CreateCommand(&ChatCmd_HookEntry, L"pc", CmdPricecheck);
     // local messages
     GW::StoC::RegisterPostPacketCallback(&OnPartySearch_Entry, GAME_SMSG_PARTY_SEARCH_ADVERTISEMENT, [](GW::HookStatus*, void* pak) {
@@ -274,34 +354,18 @@ void TradeWindow::Initialize()
 void TradeWindow::Terminate()
 {
     ToolboxWindow::Terminate();
-    should_stop = true;
-    if (worker) {
-        ASSERT(worker->joinable());
-        worker->join();
-        delete worker;
-        worker = nullptr;
-    }
-    DeleteWebSocket(ws_window);
-    ws_window = nullptr;
-    if (wsaData.wVersion) {
-        WSACleanup();
-        wsaData = { 0 };
-    }
+    trade_socket.Close();
     GW::Chat::DeleteCommand(&ChatCmd_HookEntry);
     GW::UI::RemoveUIMessageCallback(&OnUIMessage_Entry);
+    trade_history.Flush();
 }
 bool TradeWindow::GetInKamadanAE1(const bool check_district)
 {
     using namespace GW::Constants;
-    switch (GW::Map::GetMapID()) {
-        case MapID::Kamadan_Jewel_of_Istan_outpost:
-        case MapID::Kamadan_Jewel_of_Istan_Halloween_outpost:
-        case MapID::Kamadan_Jewel_of_Istan_Wintersday_outpost:
-        case MapID::Kamadan_Jewel_of_Istan_Canthan_New_Year_outpost:
-            return !check_district || (GW::Map::GetDistrict() == 1 && GW::Map::GetRegion() == ServerRegion::America);
-        default:
-            return false;
+    if (!IsKamadan(GW::Map::GetMapID())) {
+        return false;
     }
+    return !check_district || (GW::Map::GetDistrict() == 1 && GW::Map::GetRegion() == ServerRegion::America);
 }
 
 bool TradeWindow::GetInAscalonAE1(const bool check_district)
@@ -318,29 +382,32 @@ bool TradeWindow::GetInAscalonAE1(const bool check_district)
 
 void TradeWindow::Update(const float)
 {
-    if (ws_window && ws_window->getReadyState() == WebSocket::CLOSED) {
-        delete ws_window;
-        ws_window = nullptr;
-    }
-    if (ws_window && ws_window->getReadyState() != WebSocket::CLOSED) {
-        ws_window->poll();
-    }
     const bool search_pending = !pending_query_string.empty();
     const bool maintain_socket = (visible && !collapsed) || ((print_game_chat || print_game_chat_asc) && GW::Map::GetIsMapLoaded() && GetPreference(GW::UI::FlagPreference::ChannelTrade) == 0) || search_pending;
-    if (maintain_socket && !ws_window) {
+    if (maintain_socket && trade_socket.IsClosed()) {
         AsyncWindowConnect();
     }
-    if (!maintain_socket && ws_window && ws_window->getReadyState() == WebSocket::OPEN) {
-        ws_window->close();
+    if (!maintain_socket && !trade_socket.IsClosed()) {
+        trade_socket.Close();
         messages.clear();
+        showing_history = false;
         window_rate_limiter = RateLimiter(); // Deliberately closed; reset rate limiter.
     }
+    if (visible && !showing_history && trade_socket.IsClosed() && trade_history.IsLoaded()) {
+        show_history(search_buffer, false); // Offline; show what we have
+    }
+    if (TIMER_DIFF(last_history_flush) > HISTORY_FLUSH_INTERVAL_MS && trade_history.HasPendingWrites()) {
+        last_history_flush = TIMER_INIT();
+        Resources::EnqueueWorkerTask([] {
+            trade_history.Flush();
+        }, WorkerPriority::Bulk);
+    }
     fetch();
 }
 
 void TradeWindow::fetch()
 {
-    if (!ws_window || ws_window->getReadyState() != WebSocket::OPEN) {
+    if (!trade_socket.IsOpen()) {
         return;
     }
     const bool search_pending = !pending_query_sent && !pending_query_string.empty();
@@ -353,104 +420,100 @@ void TradeWindow::fetch()
         json request;
         request["query"] = pending_query_string;
         pending_query_sent = clock();
-        ws_window->send(request.dump());
+        trade_socket.Send(request.dump());
     }
+}
 
-    ws_window->dispatch([this](const std::string& data) {
-        const json& res = json::parse(data.c_str(), nullptr, false);
-        if (res == json::value_t::discarded) {
-            Log::Log("ERROR: Failed to parse res JSON from response in ws_window->dispatch\n");
+void TradeWindow::OnMessage(const std::string& data)
+{
+    const json& res = json::parse(data.c_str(), nullptr, false);
+    if (res == json::value_t::discarded) {
+        Log::Log("ERROR: Failed to parse res JSON from response in TradeWindow::OnMessage\n");
+        return;
+    }
+    if (res.find("query") != res.end() && res["query"].is_string()) {
+        auto query_string = res["query"].get<std::string>();
+        if (query_string != pending_query_string) {
+            return; // Different query has been made since this search.
+        }
+        pending_query_string.clear();
+        if (!(res.contains("num_results") && res["num_results"].is_number_unsigned())) {
+            Log::Log("ERROR: Failed to parse search results in TradeWindow::fetch\n");
+            print_search_results = false;
             return;
         }
-        if (res.find("query") != res.end() && res["query"].is_string()) {
-            auto query_string = res["query"].get<std::string>();
-            if (query_string != pending_query_string) {
-                return; // Different query has been made since this search.
-            }
-            pending_query_string.clear();
-            if (!(res.contains("num_results") && res["num_results"].is_number_unsigned())) {
-                Log::Log("ERROR: Failed to parse search results in TradeWindow::fetch\n");
-                print_search_results = false;
-                return;
-            }
-            size_t num_results = res["num_results"].get<size_t>();
-            if (print_search_results && !num_results) {
-                Log::Warning("No results found for %s", query_string.c_str());
-                print_search_results = false;
-                return;
-            }
-            if (!(res.contains("results") && res["results"].is_array())) {
-                Log::Log("ERROR: Failed to parse search results in TradeWindow::fetch\n");
-                print_search_results = false;
-                return;
-            }
-            auto results = res["results"].get<json_vec>();
-            messages.clear();
-            if (print_search_results && !results.size()) {
-                Log::Warning("No results found for %s", query_string.c_str());
-                print_search_results = false;
-                return;
-            }
-            size_t results_size = results.size();
-            for (size_t i = results_size - 1; i < results_size; i--) {
-                Message msg;
-                if (!parse_json_message(results[i], &msg)) {
-                    continue;
-                }
-                messages.add(msg);
-                if (print_search_results && i < 12) {
-                    std::wstring name_ws = TextUtils::StringToWString(msg.name);
-                    std::wstring msg_ws = TextUtils::StringToWString(msg.message);
-                    time_t ts = msg.timestamp;
-                    tm* local_tm = localtime(&ts);
-                    if (local_tm) {
-                        wchar_t buf[512];
-                        swprintf(buf, 512, L"<a=1>%s</a> @ %S %d, %02d:%02d: <c=#f96677><quote>%s", name_ws.c_str(), months[local_tm->tm_mon], local_tm->tm_mday, local_tm->tm_hour, local_tm->tm_min, msg_ws.c_str());
-                        WriteChat(GW::Chat::Channel::CHANNEL_TRADE, buf,nullptr,true);
-                    }
-                }
-            }
+        size_t num_results = res["num_results"].get<size_t>();
+        if (print_search_results && !num_results) {
+            Log::Warning("No results found for %s", query_string.c_str());
             print_search_results = false;
             return;
         }
-        // Add to message feed
-        Message msg;
-        if (!parse_json_message(res, &msg)) {
-            return; // Not valid message object
-        }
-        bool add_to_window = searched_words.empty();
-        if (!add_to_window) {
-            // Currently showing a search term in-window. Only add if it matches all words.
-            add_to_window = true;
-            std::string input(msg.message);
-            std::ranges::transform(input, input.begin(),
-                                   [](const char c) -> char {
-                                       return static_cast<char>(tolower(c));
-                                   });
-            for (auto& term : searched_words) {
-                if (input.find(term) != std::string::npos) {
-                    continue; // Searched word no found; drop out
-                }
-                add_to_window = false;
-                break;
-            }
+        if (!(res.contains("results") && res["results"].is_array())) {
+            Log::Log("ERROR: Failed to parse search results in TradeWindow::fetch\n");
+            print_search_results = false;
+            return;
         }
-        if (add_to_window) {
+        auto results = res["results"].get<json_vec>();
+        messages.clear();
+        showing_history = false;
+        if (print_search_results && !results.size()) {
+            Log::Warning("No results found for %s", query_string.c_str());
+            print_search_results = false;
+            return;
+        }
+        size_t results_size = results.size();
+        for (size_t i = results_size - 1; i < results_size; i--) {
+            Message msg;
+            if (!parse_json_message(results[i], &msg)) {
+                continue;
+            }
+            record_message(msg, feed_map_id());
             messages.add(msg);
+            if (print_search_results && i < 12) {
+                print_search_result(msg);
+            }
+        }
+        print_search_results = false;
+        return;
+    }
+    // Add to message feed
+    Message msg;
+    if (!parse_json_message(res, &msg)) {
+        return; // Not valid message object
+    }
+    record_message(msg, feed_map_id());
+    bool add_to_window = searched_words.empty();
+    if (!add_to_window) {
+        // Currently showing a search term in-window. Only add if it matches all words.
+        add_to_window = true;
+        std::string input(msg.message);
+        std::ranges::transform(input, input.begin(),
+                               [](const char c) -> char {
+                                   return static_cast<char>(tolower(c));
+                               });
+        for (auto& term : searched_words) {
+            if (input.find(term) != std::string::npos) {
+                continue; // Searched word no found; drop out
+            }
+            add_to_window = false;
+            break;
         }
+    }
+    if (add_to_window) {
+        messages.add(msg);
+    }
 
-        // Check alerts
-        // do not display trade chat while in kamadan AE district 1 or Pre-Searing Ascalon AE district 1
-        bool print_message = ((is_kamadan_chat && print_game_chat && !GetInKamadanAE1()) || (!is_kamadan_chat && print_game_chat_asc && !GetInAscalonAE1())) && IsTradeAlert(msg.message);
+    // Check alerts
+    // do not display trade chat while in kamadan AE district 1 or Pre-Searing Ascalon AE district 1
+    bool print_message = ((is_kamadan_chat && print_game_chat && !GetInKamadanAE1()) || (!is_kamadan_chat && print_game_chat_asc && !GetInAscalonAE1())) && IsTradeAlert(msg.message);
 
-        if (print_message) {
-            std::wstring name_ws = TextUtils::StringToWString(msg.name);
-            std::wstring msg_ws = std::format(L"<c=#f96677><quote>{}",TextUtils::StringToWString(msg.message));
-            external_trade_message = true;
-            WriteChat(GW::Chat::Channel::CHANNEL_TRADE, msg_ws.c_str(),name_ws.c_str());
-            external_trade_message = false;
-        }
-    });
+    if (print_message) {
+        std::wstring name_ws = TextUtils::StringToWString(msg.name);
+        std::wstring msg_ws = std::format(L"<c=#f96677><quote>{}",TextUtils::StringToWString(msg.message));
+        external_trade_message = true;
+        WriteChat(GW::Chat::Channel::CHANNEL_TRADE, msg_ws.c_str(),name_ws.c_str());
+        external_trade_message = false;
+    }
 }
 
 void TradeWindow::FindPlayerPartySearch(GW::HookStatus*, void*)
@@ -584,7 +647,7 @@ void TradeWindow::Draw(IDirect3DDevice9*)
     /* Main trade chat area */
     ImGui::BeginChild("trade_scroll", ImVec2(0, -20.0f - ImGui::GetStyle().ItemInnerSpacing.y));
     /* Connection checks */
-    if (!ws_window && !ws_window_connecting) {
+    if (trade_socket.IsClosed() && !messages.size()) {
         char buf[255];
         snprintf(buf, 255, "The connection to %s has timed out.", is_kamadan_chat ? ws_host_kmd : ws_host_asc);
         ImGui::SetCursorPosX((ImGui::GetWindowWidth() - ImGui::CalcTextSize(buf).x) / 2);
@@ -595,12 +658,22 @@ void TradeWindow::Draw(IDirect3DDevice9*)
             AsyncWindowConnect(true);
         }
     }
-    else if (ws_window_connecting || (ws_window && ws_window->getReadyState() == WebSocket::CONNECTING)) {
+    else if (trade_socket.IsConnecting() && !messages.size()) {
         ImGui::SetCursorPosX((ImGui::GetWindowWidth() - ImGui::CalcTextSize("Connecting...").x) / 2);
         ImGui::SetCursorPosY(ImGui::GetWindowHeight() / 2);
         ImGui::Text("Connecting...");
     }
     else {
+        if (trade_socket.IsConnecting()) {
+            ImGui::TextDisabled("Connecting... showing saved trade history");
+        }
+        else if (trade_socket.IsClosed()) {
+            ImGui::TextDisabled("Offline, showing saved trade history");
+            ImGui::SameLine();
+            if (ImGui::SmallButton("Reconnect")) {
+                AsyncWindowConnect(true);
+            }
+        }
         /* Display trade messages */
         const bool show_time = ImGui::GetWindowWidth() > 600.0f;
 
@@ -686,7 +759,7 @@ void TradeWindow::DrawAlertsWindowContent(bool)
     ImGui::TextDisabled("(Each line is a separate keyword. Not case sensitive.)");
     if (ImGui::InputTextMultiline("##alertfilter", alert_buf, ALERT_BUF_SIZE,
                                   ImVec2(-1.0f, 0.0f))) {
-        ParseBuffer(alert_buf, alert_words);
+        CompileAlerts(alert_buf);
         alertfile_dirty = true;
     }
     DrawChatSettings(true);
@@ -726,9 +799,9 @@ void TradeWindow::LoadSettings(ToolboxIni* ini)
     if (alert_file.is_open()) {
         alert_file.get(alert_buf, ALERT_BUF_SIZE, '\0');
         alert_file.close();
-        ParseBuffer(alert_buf, alert_words);
     }
     alert_file.close();
+    CompileAlerts(alert_buf);
     SwitchSockets();
 }
 
@@ -782,51 +855,31 @@ void TradeWindow::ParseBuffer(std::fstream stream, std::vector<std::string>& wor
 
 void TradeWindow::AsyncWindowConnect(const bool force)
 {
-    if (ws_window) {
-        return;
-    }
-    if (ws_window_connecting) {
+    if (!trade_socket.IsClosed()) {
         return;
     }
     if (!force && !window_rate_limiter.AddTime(COST_PER_CONNECTION_MS, COST_PER_CONNECTION_MAX_MS)) {
         return;
     }
-    int res;
-    if (!wsaData.wVersion && (res = WSAStartup(MAKEWORD(2, 2), &wsaData)) != 0) {
-        printf("Failed to call WSAStartup: %d\n", res);
-        return;
-    }
-    ws_window_connecting = true;
-    thread_jobs.push([this] {
-        if ((ws_window = WebSocket::from_url(is_kamadan_chat ? ws_host_kmd : ws_host_asc)) == nullptr) {
-            printf("Couldn't connect to the host '%s'", is_kamadan_chat ? ws_host_kmd : ws_host_asc);
-        }
-        ws_window_connecting = false;
-        if (messages.size() == 0 && pending_query_string.empty()) {
-            search(""); // Initial draw, gets latest N messages
+    WebSocketConnection::Callbacks callbacks;
+    callbacks.on_message = [](const std::string& data) {
+        Instance().OnMessage(data);
+    };
+    callbacks.on_open = [] {
+        pending_query_sent = 0; // Resend any search that was in flight when the connection dropped
+        if ((messages.size() == 0 || showing_history) && pending_query_string.empty()) {
+            search(search_buffer); // Initial draw, gets latest N messages
         }
-    });
-}
-
-void TradeWindow::DeleteWebSocket(WebSocket* ws)
-{
-    if (!ws) {
-        return;
-    }
-    if (ws->getReadyState() == WebSocket::OPEN) {
-        ws->close();
-    }
-    while (ws->getReadyState() != WebSocket::CLOSED) {
-        ws->poll();
-    }
-    delete ws;
+    };
+    // Update() reconnects through window_rate_limiter, and only while the socket is wanted
+    trade_socket.Open(is_kamadan_chat ? ws_host_kmd : ws_host_asc, std::move(callbacks), {}, false);
 }
 
 void TradeWindow::SwitchSockets()
 {
     refresh_footer = true;
-    DeleteWebSocket(ws_window);
-    ws_window = nullptr;
+    trade_socket.Close();
     messages.clear();
+    showing_history = false;
     AsyncWindowConnect(true);
 }
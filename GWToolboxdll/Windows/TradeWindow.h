@@ -50,15 +50,10 @@ private:
 
 
     void fetch();
-
-    // tasks to be done async by the worker thread
-    std::queue<std::function<void()>> thread_jobs{};
-    bool should_stop = false;
-    std::thread* worker = nullptr;
+    void OnMessage(const std::string& data);
 
     static void ParseBuffer(const char* text, std::vector<std::string>& words);
     static void ParseBuffer(std::fstream stream, std::vector<std::string>& words);
 
-    static void DeleteWebSocket(easywsclient::WebSocket* ws);
     void SwitchSockets();
 };
@@ -20,6 +20,7 @@
 #include <bitset>
 #include <chrono>
 #include <concepts>
+#include <condition_variable>
 #include <deque>
 #include <filesystem>
 #include <format>
@@ -1,5 +1,7 @@
 #include "stdafx.h"
 
+#include <cstring>
+
 #include "CurlWrapper.h"
 
 #ifdef _NDEBUG
@@ -53,10 +55,98 @@ static bool GetFileSize(FILE* file, curl_off_t* size)
 
 static std::atomic<int> InitializeCount;
 
+static CURLSH* SharedHandle;
+static std::mutex SharedLocks[CURL_LOCK_DATA_LAST];
+
+static void SharedLock(CURL*, const curl_lock_data data, curl_lock_access, void*)
+{
+    SharedLocks[data].lock();
+}
+
+static void SharedUnlock(CURL*, const curl_lock_data data, void*)
+{
+    SharedLocks[data].unlock();
+}
+
+static std::mutex StatsMutex;
+static CurlStats Stats;
+static std::map<std::string, CurlHostStats> StatsByHost;
+
+static std::string GetHost(const char* url)
+{
+    std::string host;
+    CURLU* handle = curl_url();
+    char* part = nullptr;
+    if (handle && curl_url_set(handle, CURLUPART_URL, url, 0) == CURLUE_OK
+        && curl_url_get(handle, CURLUPART_HOST, &part, 0) == CURLUE_OK) {
+        host = part;
+        curl_free(part);
+    }
+    curl_url_cleanup(handle);
+    return host;
+}
+
+// Easy handles are expensive to create and keep their own caches, including their open connections, so destroyed
+// "CurlEasy" objects hand their handle back to a small pool owned by the destroying thread instead of calling "curl_easy_cleanup".
+static constexpr size_t MaxPooledHandlesPerThread = 4;
+
+struct EasyHandlePool {
+    std::vector<CURL*> Handles;
+
+    ~EasyHandlePool()
+    {
+        // Leak rather than touch curl after "curl_global_cleanup"
+        if (InitializeCount > 0) {
+            Drain();
+        }
+    }
+
+    void Drain()
+    {
+        for (CURL* handle : Handles) {
+            curl_easy_cleanup(handle);
+        }
+        Handles.clear();
+    }
+};
+
+static thread_local EasyHandlePool HandlePool;
+
+static CURL* AcquireEasyHandle()
+{
+    if (HandlePool.Handles.empty()) {
+        return curl_easy_init();
+    }
+    CURL* handle = HandlePool.Handles.back();
+    HandlePool.Handles.pop_back();
+    return handle;
+}
+
+static void ReleaseEasyHandle(CURL* handle)
+{
+    curl_easy_reset(handle);
+    // "curl_easy_reset" keeps the share handle attached; pooled handles must not keep it in use.
+    curl_easy_setopt(handle, CURLOPT_SHARE, nullptr);
+    if (HandlePool.Handles.size() < MaxPooledHandlesPerThread) {
+        HandlePool.Handles.push_back(handle);
+    }
+    else {
+        curl_easy_cleanup(handle);
+    }
+}
+
 void InitCurl()
 {
     if (++InitializeCount == 1) {
         curl_global_init(CURL_GLOBAL_ALL);
+
+        SharedHandle = curl_share_init();
+        curl_share_setopt(SharedHandle, CURLSHOPT_LOCKFUNC, SharedLock);
+        curl_share_setopt(SharedHandle, CURLSHOPT_UNLOCKFUNC, SharedUnlock);
+        curl_share_setopt(SharedHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(SharedHandle, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        // Not CURL_LOCK_DATA_CONNECT: libcurl doesn't support a shared connection cache used from several threads at once,
+        // which is what the Resources workers do. Connections are still reused by each thread's pooled handles.
     }
 }
 
@@ -64,16 +154,42 @@ void ShutdownCurl()
 {
     assert(InitializeCount > 0);
     if (--InitializeCount == 0) {
+        HandlePool.Drain();
+        const CURLSHcode code = curl_share_cleanup(SharedHandle);
+        if (code != CURLSHE_OK) {
+            // Some handle is still attached; leak the share handle rather than free it from under them.
+            fprintf(stderr, "Error in 'ShutdownCurl': %s\n", curl_share_strerror(code));
+        }
+        SharedHandle = nullptr;
         curl_global_cleanup();
     }
 }
 
+CurlStats GetCurlStats()
+{
+    std::lock_guard Lock(StatsMutex);
+    return Stats;
+}
+
+std::vector<CurlHostStats> GetCurlHostStats()
+{
+    std::lock_guard Lock(StatsMutex);
+    std::vector<CurlHostStats> out;
+    out.reserve(StatsByHost.size());
+    for (const auto& it : StatsByHost) {
+        out.push_back(it.second);
+    }
+    return out;
+}
+
 CurlEasy::CurlEasy()
     : m_Headers(nullptr)
     , m_File(nullptr)
     , m_UploadFile(nullptr)
     , m_Status(ResponseStatus::None)
     , m_StatusCode(0)
+    , m_DecodedSize(0)
+    , m_MaxDecodedSize(0)
     , m_MultiHandle(nullptr)
 {
 #ifndef _NDEBUG
@@ -82,14 +198,14 @@ CurlEasy::CurlEasy()
 #endif
 
     assert(InitializeCount > 0);
-    m_Handle = curl_easy_init();
+    m_Handle = AcquireEasyHandle();
     Reset();
 }
 
 CurlEasy::~CurlEasy()
 {
     Reset();
-    curl_easy_cleanup(m_Handle);
+    ReleaseEasyHandle(m_Handle);
 }
 
 void CurlEasy::SetUrl(const Protocol proto, const char* url)
@@ -248,6 +364,16 @@ void CurlEasy::SetBufferSize(const size_t size)
     CHECK_CURL_EASY_SETOPT(this, CURLOPT_BUFFERSIZE, static_cast<long>(size));
 }
 
+void CurlEasy::SetAcceptEncoding(const char* encodings)
+{
+    CHECK_CURL_EASY_SETOPT(this, CURLOPT_ACCEPT_ENCODING, encodings);
+}
+
+void CurlEasy::SetMaxDecodedSize(const size_t max_bytes)
+{
+    m_MaxDecodedSize = max_bytes;
+}
+
 void CurlEasy::SetPostContent(const std::string& content, const ContentFlag flag)
 {
     return SetPostContent(content.c_str(), content.size(), flag);
@@ -311,17 +437,30 @@ void CurlEasy::SetUploadFile(FILE* file, const size_t size)
 
 void CurlEasy::SetUploadFile(const char* path)
 {
-    if (fopen_s(&m_File, path, "rb") != 0) {
+    m_File = fopen(path, "rb");
+    if (m_File) {
         SetUploadFile(m_File);
     }
 }
 
+void CurlEasy::SetShared(const bool enable)
+{
+    CHECK_CURL_EASY_SETOPT(this, CURLOPT_SHARE, enable ? SharedHandle : nullptr);
+}
+
+void CurlEasy::SetAbortCallback(std::function<bool()> callback)
+{
+    m_AbortCallback = std::move(callback);
+    CHECK_CURL_EASY_SETOPT(this, CURLOPT_NOPROGRESS, m_AbortCallback ? 0L : 1L);
+}
+
 void CurlEasy::Clear()
 {
     m_Header.clear();
     m_Content.clear();
     m_Status = ResponseStatus::None;
     m_StatusCode = 0;
+    m_DecodedSize = 0;
 }
 
 void CurlEasy::Reset()
@@ -330,6 +469,8 @@ void CurlEasy::Reset()
     m_ErrorBuffer[0] = 0;
 #endif
 
+    m_MaxDecodedSize = 0;
+    m_AbortCallback = nullptr;
     m_UploadFile = nullptr;
     if (m_File) {
         fclose(m_File);
@@ -351,9 +492,12 @@ void CurlEasy::Reset()
     CHECK_CURL_EASY_SETOPT(this, CURLOPT_WRITEDATA, this);
     CHECK_CURL_EASY_SETOPT(this, CURLOPT_HEADERFUNCTION, HeaderCallback);
     CHECK_CURL_EASY_SETOPT(this, CURLOPT_HEADERDATA, this);
+    CHECK_CURL_EASY_SETOPT(this, CURLOPT_XFERINFOFUNCTION, ProgressCallback);
+    CHECK_CURL_EASY_SETOPT(this, CURLOPT_XFERINFODATA, this);
 #ifndef _NDEBUG
     CHECK_CURL_EASY_SETOPT(this, CURLOPT_ERRORBUFFER, m_ErrorBuffer);
 #endif
+    SetShared(true);
 }
 
 bool CurlEasy::Perform()
@@ -392,6 +536,36 @@ void CurlEasy::UpdateStatus(const int CurlStatus)
         m_StatusCode = ResponseStatus;
     }
 
+    long NewConnections = 0;
+    curl_off_t NameLookupUs = 0, ConnectUs = 0, AppConnectUs = 0, TotalUs = 0;
+    curl_easy_getinfo(m_Handle, CURLINFO_NUM_CONNECTS, &NewConnections);
+    curl_easy_getinfo(m_Handle, CURLINFO_NAMELOOKUP_TIME_T, &NameLookupUs);
+    curl_easy_getinfo(m_Handle, CURLINFO_CONNECT_TIME_T, &ConnectUs);
+    curl_easy_getinfo(m_Handle, CURLINFO_APPCONNECT_TIME_T, &AppConnectUs);
+    curl_easy_getinfo(m_Handle, CURLINFO_TOTAL_TIME_T, &TotalUs);
+    // CURLINFO_SIZE_DOWNLOAD_T counts body bytes as received, before any content decoding
+    curl_off_t CompressedBytes = 0;
+    curl_easy_getinfo(m_Handle, CURLINFO_SIZE_DOWNLOAD_T, &CompressedBytes);
+    const char* EffectiveUrl = nullptr;
+    curl_easy_getinfo(m_Handle, CURLINFO_EFFECTIVE_URL, &EffectiveUrl);
+    const std::string Host = EffectiveUrl ? GetHost(EffectiveUrl) : std::string();
+    {
+        std::lock_guard Lock(StatsMutex);
+        if (!Host.empty()) {
+            CurlHostStats& HostStats = StatsByHost[Host];
+            HostStats.Host = Host;
+            HostStats.Requests++;
+            HostStats.CompressedBytes += static_cast<uint64_t>(CompressedBytes);
+            HostStats.DecodedBytes += m_DecodedSize;
+        }
+        Stats.Requests++;
+        Stats.NewConnections += static_cast<uint64_t>(NewConnections);
+        Stats.NameLookupUs += static_cast<uint64_t>(NameLookupUs);
+        Stats.ConnectUs += static_cast<uint64_t>(ConnectUs);
+        Stats.AppConnectUs += static_cast<uint64_t>(AppConnectUs);
+        Stats.TotalUs += static_cast<uint64_t>(TotalUs);
+    }
+
     switch (CurlStatus) {
         case CURLE_OK:
             m_Status = ResponseStatus::Completed;
@@ -452,12 +626,23 @@ size_t CurlEasy::WriteCallback(const char* buffer, const size_t size, const size
 {
     const auto easy = static_cast<CurlEasy*>(userdata);
     const size_t count = size * nitems;
+    if (easy->m_MaxDecodedSize && easy->m_DecodedSize + count > easy->m_MaxDecodedSize) {
+        return 0; // Aborts the transfer with CURLE_WRITE_ERROR
+    }
+    easy->m_DecodedSize += count;
     if (count / size == nitems) {
         easy->OnContent(buffer, count);
     }
     return count;
 }
 
+int CurlEasy::ProgressCallback(void* userdata, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+{
+    const auto easy = static_cast<CurlEasy*>(userdata);
+    // Non-zero aborts the transfer with CURLE_ABORTED_BY_CALLBACK
+    return easy->m_AbortCallback && easy->m_AbortCallback() ? 1 : 0;
+}
+
 size_t CurlEasy::HeaderCallback(const char* buffer, const size_t size, const size_t nitems, void* userdata)
 {
     const auto easy = static_cast<CurlEasy*>(userdata);
@@ -4,7 +4,9 @@
 #include <curl/curl.h>
 #include <stdint.h>
 #include <string>
+#include <functional>
 #include <initializer_list>
+#include <vector>
 
 #if defined(CURL_STRICTER)
 typedef struct Curl_easy CURL;
@@ -17,6 +19,29 @@ using CURLM = void;
 void InitCurl();
 void ShutdownCurl();
 
+// Cumulative transfer statistics across every CurlEasy handle since InitCurl
+struct CurlStats {
+    uint64_t Requests;
+    // Transfers that had to open a new connection rather than reusing a pooled one
+    uint64_t NewConnections;
+    uint64_t NameLookupUs;
+    uint64_t ConnectUs;
+    uint64_t AppConnectUs;
+    uint64_t TotalUs;
+};
+
+CurlStats GetCurlStats();
+
+// Body bytes received from a host on the wire versus after content decoding (gzip, br, ...)
+struct CurlHostStats {
+    std::string Host;
+    uint64_t Requests;
+    uint64_t CompressedBytes;
+    uint64_t DecodedBytes;
+};
+
+std::vector<CurlHostStats> GetCurlHostStats();
+
 struct UploadBuffer {
     const uint8_t* data;
     size_t size;
@@ -85,6 +110,11 @@ public:
     void SetProxy(const char* url, uint16_t port);
     void SetProxyAuth(const char* username, const char* password);
     void SetBufferSize(size_t size);
+    // Advertise and transparently decode compressed responses. An empty string means every encoding curl was built with.
+    void SetAcceptEncoding(const char* encodings);
+    // Abort the transfer once the decoded body grows past max_bytes; 0 means no limit.
+    // Guards against small compressed responses that expand to something huge.
+    void SetMaxDecodedSize(size_t max_bytes);
     void SetPostContent(const std::string& content, ContentFlag flag);
     void SetPostContent(const char* content, size_t size, ContentFlag flag);
     void SetUploadBuffer(const std::string& content, ContentFlag flag);
@@ -92,6 +122,12 @@ public:
     void SetUploadFile(FILE* file);
     void SetUploadFile(FILE* file, size_t size);
     void SetUploadFile(const char* path);
+    // Attach to the process wide share handle so DNS lookups and TLS sessions are reused across
+    // handles. Enabled by default, "Reset" re-enables it.
+    void SetShared(bool enable);
+    // Polled while the transfer runs, at least once a second even when no data is moving.
+    // Returning true aborts the transfer with ResponseStatus::Aborted. "Reset" clears it.
+    void SetAbortCallback(std::function<bool()> callback);
 
     // Clear the response data and status flag
     void Clear();
@@ -140,6 +176,7 @@ private:
 
     static size_t ReadFileCallback(char* buffer, size_t size, size_t nitems, void* userdata);
     static size_t ReadBufferCallback(char* buffer, size_t size, size_t nitems, void* userdata);
+    static int ProgressCallback(void* userdata, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
 
     // You are encouraged to re-write this function however you want, this
     // case represent the use cases of having a lot of hardcoded value where
@@ -168,6 +205,10 @@ protected:
     ResponseStatus m_Status;
     int m_StatusCode;
 
+    size_t m_DecodedSize;
+    size_t m_MaxDecodedSize;
+    std::function<bool()> m_AbortCallback;
+
 #ifndef _NDEBUG
     char m_ErrorBuffer[256];
 #endif
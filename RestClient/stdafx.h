@@ -6,9 +6,11 @@
 #include <algorithm>
 #include <atomic>
 #include <deque>
+#include <map>
 #include <mutex>
 #include <string>
 #include <utility>
+#include <vector>
 
 #define CURL_STATICLIB
 #include <curl/curl.h>
@@ -0,0 +1,247 @@
+// Checks TextUtils::ctre_regex_replace against std::regex_replace, which reads the same $&, $1-$9, $`, $' and $$ syntax.
+// Each case runs the same pattern and replacement through both, narrow and wide. Where std::regex_replace isn't ECMAScript ($0, a $n past the pattern's
+// groups, $` after an earlier match), or can't take the replacement (UTF-32 into narrow or wide text), the expected output is given instead.
+// Then times it against the find/replace version it replaced, on the chat corpus.
+// Usage: CtreReplaceCheck [repeat] [corpus file]
+
+#include "stdafx.h"
+
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+
+// Only named by declarations TextUtils.h doesn't need here
+struct GUID;
+struct FILETIME;
+
+#include <TextUtils.h>
+
+namespace {
+    using namespace TextUtils;
+    using Clock = std::chrono::steady_clock;
+
+    size_t failures = 0;
+
+    template <typename CharT, ctll::fixed_string Text>
+    std::basic_string<CharT> Units()
+    {
+        // ctll keeps narrow literals as bytes and wide ones as code units, so this is the literal as written
+        std::basic_string<CharT> out;
+        for (size_t i = 0; i < Text.size(); i++) {
+            out.push_back(static_cast<CharT>(Text[i]));
+        }
+        return out;
+    }
+
+    template <typename CharT>
+    void Report(const char* label, const std::basic_string<CharT>& got, const std::basic_string<CharT>& want)
+    {
+        if (got == want) return;
+        printf("%s (%s): got %zu units, expected %zu\n", label, sizeof(CharT) == 1 ? "narrow" : "wide", got.size(), want.size());
+        failures++;
+    }
+
+    template <typename CharT, ctll::fixed_string Pattern, ctll::fixed_string Replacement, typename... Modifiers>
+    void Compare(const char* label, const std::basic_string_view<CharT> subject)
+    {
+        auto flags = std::regex::ECMAScript;
+        if constexpr ((std::is_same_v<Modifiers, ctre::case_insensitive> || ...)) {
+            flags |= std::regex::icase;
+        }
+        const std::basic_regex<CharT> regex(Units<CharT, Pattern>(), flags);
+        std::basic_string<CharT> want;
+        std::regex_replace(std::back_inserter(want), subject.begin(), subject.end(), regex, Units<CharT, Replacement>());
+        Report(label, detail::ctre_regex_replace<CharT, Pattern, Replacement, Modifiers...>(subject), want);
+    }
+
+    template <ctll::fixed_string Pattern, ctll::fixed_string Replacement, typename... Modifiers>
+    void Compare(const char* label, const std::string_view subject, const std::wstring_view wide_subject)
+    {
+        Compare<char, Pattern, Replacement, Modifiers...>(label, subject);
+        Compare<wchar_t, Pattern, Replacement, Modifiers...>(label, wide_subject);
+    }
+
+    template <typename CharT, ctll::fixed_string Pattern, ctll::fixed_string Replacement>
+    void Expect(const char* label, const std::basic_string_view<CharT> subject, const std::basic_string_view<CharT> want)
+    {
+        Report(label, detail::ctre_regex_replace<CharT, Pattern, Replacement>(subject), std::basic_string<CharT>(want));
+    }
+
+    template <ctll::fixed_string Text>
+    consteval bool Mentions(const char (&token)[3])
+    {
+        for (size_t i = 0; i + 1 < Text.size(); i++) {
+            if (Text[i] == static_cast<char32_t>(token[0]) && Text[i + 1] == static_cast<char32_t>(token[1])) return true;
+        }
+        return false;
+    }
+
+    // ctre_regex_replace as it was: every match copies the replacement, then runs a find/replace over it per token used.
+    // Mentions stands in for the compile time ctre::search calls it made on Replacement.
+    template <typename CharT, ctll::fixed_string Pattern, ctll::fixed_string Replacement, typename... Modifiers>
+    std::basic_string<CharT> LegacyReplace(const std::basic_string_view<CharT> subject)
+    {
+        using String = std::basic_string<CharT>;
+        const auto literal = [](const char* s) {
+            return String(s, s + strlen(s));
+        };
+
+        String result;
+        result.reserve(subject.size() * 2);
+        auto search_start = subject.begin();
+        const auto replacement = Units<CharT, Replacement>();
+
+        for (auto match : ctre::search_all<Pattern, Modifiers...>(subject)) {
+            result.append(search_start, match.begin());
+            String replaced_match(replacement);
+            struct Pair {
+                String key;
+                String value;
+            };
+            std::vector<Pair> replacements;
+
+            constexpr auto cnt = decltype(match)::count();
+            static_assert(cnt < 10, "Only up to 9 capture groups are supported");
+            const auto group = [&]<size_t I>() {
+                return String(match.template get<I>().to_view());
+            };
+            constexpr auto has_escaped_dollar = Mentions<Replacement>("$$");
+            if constexpr (has_escaped_dollar)
+                replacements.emplace_back(literal("$$"), literal("###ESCAPED_DOLLAR###"));
+            if constexpr (Mentions<Replacement>("$&"))
+                replacements.emplace_back(literal("$&"), String(match.begin(), match.end()));
+            if constexpr (Mentions<Replacement>("$'"))
+                replacements.emplace_back(literal("$'"), String(match.end(), subject.end()));
+            if constexpr (Mentions<Replacement>("$`"))
+                replacements.emplace_back(literal("$`"), String(subject.begin(), match.begin()));
+            if constexpr (Mentions<Replacement>("$1") && cnt > 1)
+                replacements.emplace_back(literal("$1"), group.template operator()<1>());
+            if constexpr (Mentions<Replacement>("$2") && cnt > 2)
+                replacements.emplace_back(literal("$2"), group.template operator()<2>());
+            if constexpr (Mentions<Replacement>("$3") && cnt > 3)
+                replacements.emplace_back(literal("$3"), group.template operator()<3>());
+            if constexpr (has_escaped_dollar)
+                replacements.emplace_back(literal("###ESCAPED_DOLLAR###"), literal("$"));
+
+            for (const auto& [key, value] : replacements) {
+                size_t pos = 0;
+                while ((pos = replaced_match.find(key, pos)) != String::npos) {
+                    replaced_match.replace(pos, key.length(), value);
+                    pos += value.length();
+                }
+            }
+
+            result.append(replaced_match);
+            search_start = match.end();
+        }
+
+        result.append(search_start, subject.end());
+        return result;
+    }
+
+    std::vector<std::string> LoadCorpus(const char* path)
+    {
+        std::vector<std::string> lines;
+        std::ifstream file(path, std::ios::binary);
+        std::string line;
+        while (std::getline(file, line)) {
+            // timestamp, map, name, message
+            size_t field = 0;
+            for (int i = 0; i < 3 && field != std::string::npos; i++) {
+                field = line.find('\t', field ? field + 1 : 0);
+            }
+            if (field != std::string::npos) {
+                lines.push_back(line.substr(field + 1));
+            }
+        }
+        return lines;
+    }
+
+    template <typename CharT, typename Fn>
+    double NanosecondsPerChar(const std::vector<std::basic_string<CharT>>& texts, const size_t repeat, Fn&& fn)
+    {
+        size_t chars = 0;
+        for (const auto& text : texts) {
+            chars += text.size();
+        }
+        const auto started = Clock::now();
+        for (size_t r = 0; r < repeat; r++) {
+            for (const auto& text : texts) {
+                fn(text);
+            }
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - started).count() / static_cast<double>(chars * repeat);
+    }
+
+    template <typename CharT, ctll::fixed_string Pattern, ctll::fixed_string Replacement>
+    void Time(const char* label, const std::vector<std::basic_string<CharT>>& texts, const size_t repeat)
+    {
+        for (const auto& text : texts) {
+            Report(label, LegacyReplace<CharT, Pattern, Replacement>(text), detail::ctre_regex_replace<CharT, Pattern, Replacement>(text));
+        }
+        const auto old = NanosecondsPerChar(texts, repeat, [](const std::basic_string<CharT>& text) {
+            return LegacyReplace<CharT, Pattern, Replacement>(text);
+        });
+        const auto segments = NanosecondsPerChar(texts, repeat, [](const std::basic_string<CharT>& text) {
+            return detail::ctre_regex_replace<CharT, Pattern, Replacement>(text);
+        });
+        printf("  %-18s %-6s old %7.2f   segments %7.2f\n", label, sizeof(CharT) == 1 ? "narrow" : "wide", old, segments);
+    }
+
+    template <ctll::fixed_string Pattern, ctll::fixed_string Replacement>
+    void Time(const char* label, const std::vector<std::string>& lines, const std::vector<std::wstring>& wide_lines, const size_t repeat)
+    {
+        Time<char, Pattern, Replacement>(label, lines, repeat);
+        Time<wchar_t, Pattern, Replacement>(label, wide_lines, repeat);
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    size_t repeat = 50;
+    if (argc > 1) {
+        std::from_chars(argv[1], argv[1] + strlen(argv[1]), repeat);
+    }
+    Compare<"[aeiou]", "<$&>">("$&", "trade chat", L"trade chat");
+    Compare<"(\\w+)@(\\w+)", "$2 at $1">("$1 and $2", "mail bob@toolbox or amy@guild", L"mail bob@toolbox or amy@guild");
+    Compare<"(a)(b)(c)(d)(e)(f)(g)(h)(i)", "$9$8$7$6$5$4$3$2$1">("$1-$9", "xabcdefghiy abcdefghi", L"xabcdefghiy abcdefghi");
+    Compare<"-", "[$`|$']">("$` and $'", "Ðé-stròy", L"Ðé-stròy");
+    Compare<"k", "$$$&$$">("$$", "2k ea, 50k", L"2k ea, 50k");
+    Compare<"q(\\d+)(r)?", "<$1|$2>">("unmatched group", "q9 r8 q10r", L"q9 r8 q10r");
+    Compare<"zzz", "$&$&">("no match", "wts ecto", L"wts ecto");
+    Compare<"e", "$x$">("$ without a reference", "ecto", L"ecto");
+    Compare<"^|$", "|">("empty matches", "ab", L"ab");
+    Compare<"ECTO", "[$&]", ctre::case_insensitive>("case_insensitive", "Ecto, ecto", L"Ecto, ecto");
+    Compare<char, "o", "ö→$&">("non-ASCII narrow replacement", "wts ecto");
+    Compare<wchar_t, "o", L"ö→$&">("non-ASCII wide replacement", L"wts ecto");
+
+    // std::regex_replace takes $0 as the whole match, and an out of range $n as empty; ECMAScript keeps both as written
+    // It also starts $` at the previous match; in ECMAScript it's everything before this one
+    Expect<char, "-", "[$`|$']">("$` and $' after an earlier match", "Ðé-stròy-ér", "Ðé[Ðé|stròy-ér]stròy[Ðé-stròy|ér]ér");
+    Expect<wchar_t, "-", "[$`|$']">("$` and $' after an earlier match", L"Ðé-stròy-ér", L"Ðé[Ðé|stròy-ér]stròy[Ðé-stròy|ér]ér");
+    Expect<char, "(b)", "$0$1$3">("$0 and out of range $n", "abc", "a$0b$3c");
+    Expect<wchar_t, "(b)", "$0$1$3">("$0 and out of range $n", L"abc", L"a$0b$3c");
+    Expect<char, "b", "$1">("$1 without groups", "abc", "a$1c");
+    // Code points too wide for the subject's code units get encoded for it
+    Expect<char, "b", U"→😀">("UTF-32 replacement, narrow", "abc", "a\xE2\x86\x92\xF0\x9F\x98\x80" "c");
+    Expect<wchar_t, "b", U"→é😀">("UTF-32 replacement, wide", L"abc", L"a→é😀c");
+
+    const auto lines = LoadCorpus(argc > 2 ? argv[2] : TESTS_DATA_DIR "/trade_chat.txt");
+    if (lines.empty()) {
+        printf("no chat corpus\n");
+        return 1;
+    }
+    // The sample is ASCII, so widening it a byte at a time is enough
+    std::vector<std::wstring> wide_lines;
+    for (const auto& line : lines) {
+        wide_lines.emplace_back(line.begin(), line.end());
+    }
+    printf("corpus %zu lines, ns/char\n", lines.size());
+    Time<"[^A-Za-z0-9 ]", "_">("literal", lines, wide_lines, repeat);
+    Time<"\\d+", "<$&>">("$&", lines, wide_lines, repeat);
+    Time<"(\\w+) (\\w+)", "$2 $1">("$1 and $2", lines, wide_lines, repeat);
+    Time<"(\\d+)k", "$$$1,000">("$$ and $1", lines, wide_lines, repeat);
+
+    printf("%zu mismatches\n", failures);
+    return failures ? 1 : 0;
+}
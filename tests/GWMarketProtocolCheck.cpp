@@ -0,0 +1,272 @@
+// Checks GWMarketWindow's SAX parsing of gwmarket.net frames against the json DOM path it replaced, then times both on a big snapshot.
+// Every sample frame has to give the same event and the same items both ways; the DOM path is the window's old code, FromJson and all.
+// Usage: GWMarketProtocolCheck [snapshot items] [frames file]
+
+#include "stdafx.h"
+
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+
+#include <GWMarketWindow_Protocol.h>
+
+namespace {
+    using namespace GWMarket;
+    using Clock = std::chrono::steady_clock;
+
+    // Frames the window has to ignore without touching its lists
+    constexpr const char* MALFORMED_FRAMES[] = {
+        "",
+        "2",
+        "40",
+        "42",
+        "42[",
+        "42[]",
+        "42[5,{}]",
+        R"(42{"GetItemOrders":[]})",
+        R"(42["GetItemOrders",[{"name":"Cut Off")",
+        R"(42["GetItemOrders",[{"name":"Bad Json"]])",
+        R"(42["GetItemOrders",{"name":"Not An Array"}])",
+        R"(42["GetAvailableOrders",[{"sellWeek":1}]])",
+        R"(42["GetAvailableOrders",{"Cut Off":{"sellWeek":1}])",
+        R"(42["GetItemOrders",[],{])",
+        R"(42["GetItemOrders",[]]])",
+        R"(42["GetItemOrders",[]"]",1])",
+    };
+
+    std::vector<std::string> LoadFrames(const char* path)
+    {
+        std::vector<std::string> frames;
+        std::ifstream file(path, std::ios::binary);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty()) {
+                frames.push_back(line);
+            }
+        }
+        return frames;
+    }
+
+    // As GWMarketWindow was: the whole frame into a DOM, then FromJson per item
+    bool DomParseSocketIOMessage(const std::string& message, std::string& event, json& data)
+    {
+        if (message.length() < 2 || message.substr(0, 2) != "42") return false;
+
+        json parsed = json::parse(message.substr(2), nullptr, false);
+        if (!parsed.is_discarded() && parsed.is_array() && parsed.size() >= 1) {
+            if (!parsed[0].is_string()) return false;
+            event = parsed[0].get<std::string>();
+            if (parsed.size() >= 2) {
+                data = parsed[1];
+            }
+            return true;
+        }
+        return false;
+    }
+
+    std::vector<MarketItem> DomMarketItems(const json& items)
+    {
+        std::vector<MarketItem> out;
+        if (items.is_array()) {
+            out.reserve(items.size());
+            for (const auto& item_json : items) {
+                out.push_back(MarketItem::FromJson(item_json));
+            }
+        }
+        return out;
+    }
+
+    // Keyed by name; the DOM keeps object keys sorted, the SAX handler keeps them in order of arrival
+    std::map<std::string, std::pair<int, int>> DomAvailableOrders(const json& orders)
+    {
+        std::map<std::string, std::pair<int, int>> out;
+        for (auto it = orders.begin(); it != orders.end(); ++it) {
+            const auto& j = it.value();
+            out[it.key()] = {parseIntFromJson(j, "sellWeek", 0), parseIntFromJson(j, "buyWeek", 0)};
+        }
+        return out;
+    }
+
+    std::map<std::string, std::pair<int, int>> Keyed(const std::vector<AvailableItem>& items)
+    {
+        std::map<std::string, std::pair<int, int>> out;
+        for (const auto& item : items) {
+            out[*item.name] = {item.sellOrders, item.buyOrders};
+        }
+        return out;
+    }
+
+    // Returns a description of the first difference, or empty if there isn't one
+    std::string Compare(const MarketItem& a, const MarketItem& b)
+    {
+        if (a.name != b.name) return "name";
+        if (a.player != b.player) return "player";
+        if (a.description != b.description) return "description";
+        if (a.orderType != b.orderType) return "orderType";
+        if (a.quantity != b.quantity) return "quantity";
+        if (a.lastRefresh != b.lastRefresh) return "lastRefresh";
+        if (a.weaponDetails.attribute != b.weaponDetails.attribute) return "weaponDetails.attribute";
+        if (a.weaponDetails.requirement != b.weaponDetails.requirement) return "weaponDetails.requirement";
+        if (a.weaponDetails.inscribable != b.weaponDetails.inscribable) return "weaponDetails.inscription";
+        if (a.prices.size() != b.prices.size()) return "prices.size";
+        for (size_t i = 0; i < a.prices.size(); i++) {
+            const auto& pa = a.prices[i];
+            const auto& pb = b.prices[i];
+            if (pa.type != pb.type || pa.quantity != pb.quantity || pa.price != pb.price) {
+                return "prices[" + std::to_string(i) + "]";
+            }
+        }
+        return {};
+    }
+
+    size_t CompareItems(const std::string& frame, const std::vector<MarketItem>& dom, const std::vector<MarketItem>& sax)
+    {
+        if (dom.size() != sax.size()) {
+            printf("item count differs (DOM %zu, SAX %zu) on %.120s\n", dom.size(), sax.size(), frame.c_str());
+            return 1;
+        }
+        size_t failures = 0;
+        for (size_t i = 0; i < dom.size(); i++) {
+            if (const auto field = Compare(dom[i], sax[i]); !field.empty()) {
+                printf("item %zu differs in %s on %.120s\n", i, field.c_str(), frame.c_str());
+                failures++;
+            }
+        }
+        return failures;
+    }
+
+    // Returns the number of disagreements for one frame
+    size_t CheckFrame(const std::string& frame)
+    {
+        std::string dom_event;
+        json dom_data;
+        const bool dom_ok = DomParseSocketIOMessage(frame, dom_event, dom_data);
+        std::string_view event;
+        std::string_view payload;
+        const bool sax_ok = ParseSocketIOMessage(frame, event, payload);
+        if (!dom_ok) {
+            // The split alone can't tell broken json; the payload parsers have to reject it instead
+            if (!sax_ok) return 0;
+            std::vector<AvailableItem> available;
+            if (!ParseMarketItems(payload).empty() || ParseAvailableOrders(payload, available)) {
+                printf("SAX accepted a frame the DOM rejects: %.120s\n", frame.c_str());
+                return 1;
+            }
+            return 0;
+        }
+        if (!sax_ok || event != dom_event) {
+            printf("event differs (DOM \"%s\", SAX %s\"%.*s\") on %.120s\n", dom_event.c_str(), sax_ok ? "" : "rejected ", static_cast<int>(event.size()), event.data(), frame.c_str());
+            return 1;
+        }
+        if (event == "GetAvailableOrders") {
+            std::vector<AvailableItem> sax_items;
+            const bool parsed = ParseAvailableOrders(payload, sax_items);
+            if (parsed != dom_data.is_object()) {
+                printf("available orders %s by SAX only on %.120s\n", parsed ? "accepted" : "rejected", frame.c_str());
+                return 1;
+            }
+            if (parsed && Keyed(sax_items) != DomAvailableOrders(dom_data)) {
+                printf("available orders differ on %.120s\n", frame.c_str());
+                return 1;
+            }
+            return 0;
+        }
+        if (event == "GetItemOrders" || event == "GetLastItems") {
+            return CompareItems(frame, DomMarketItems(dom_data), ParseMarketItems(payload));
+        }
+        return 0;
+    }
+
+    // A snapshot the size gwmarket.net sends on connect, built from the same kinds of items as the samples
+    std::pair<std::string, std::string> MakeSnapshots(const size_t count)
+    {
+        std::string orders = R"(42["GetItemOrders",[)";
+        std::string available = R"(42["GetAvailableOrders",{)";
+        for (size_t i = 0; i < count; i++) {
+            if (i) {
+                orders += ',';
+                available += ',';
+            }
+            const auto n = std::to_string(i);
+            orders += R"({"name":"Item )" + n + R"(","player":"Trader )" + std::to_string(i % 97) + R"(","orderType":)" + std::to_string(i % 2) + R"(,"quantity":)" + std::to_string(1 + i % 250) +
+                      R"(,"lastRefresh":)" + std::to_string(1760774400000 + i * 1013) + R"(,"description":"snapshot item )" + n + '"';
+            if (i % 5 == 0) {
+                orders += R"(,"weaponDetails":{"attribute":"Tactics","requirement":)" + std::to_string(i % 13) + R"(,"inscription":)" + (i % 2 ? "true" : "false") +
+                          R"(,"oldschool":false,"core":null,"prefix":null,"suffix":null})";
+            }
+            orders += R"(,"prices":[{"type":0,"quantity":1,"price":)" + std::to_string(100 + i % 5000) + R"(},{"type":1,"quantity":)" + std::to_string(1 + i % 3) + R"(,"unit":0.5,"price":1.25}]})";
+            available += R"("Item )" + n + R"(":{"sellWeek":)" + std::to_string(i % 40) + R"(,"buyWeek":)" + std::to_string(i % 7) + R"(,"lastSell":)" + std::to_string(1760774400000 + i) + '}';
+        }
+        orders += "]]";
+        available += "}]";
+        return {orders, available};
+    }
+
+    template <typename Fn>
+    double MillisecondsPer(const size_t repeat, Fn&& fn)
+    {
+        const auto started = Clock::now();
+        for (size_t r = 0; r < repeat; r++) {
+            fn();
+        }
+        return std::chrono::duration<double, std::milli>(Clock::now() - started).count() / static_cast<double>(repeat);
+    }
+
+    size_t Snapshot(const size_t count)
+    {
+        const auto [orders, available] = MakeSnapshots(count);
+        size_t failures = CheckFrame(orders) + CheckFrame(available);
+
+        const size_t repeat = count >= 10000 ? 10 : 1;
+        size_t sink = 0;
+        const auto dom_orders_ms = MillisecondsPer(repeat, [&] {
+            std::string event;
+            json data;
+            if (DomParseSocketIOMessage(orders, event, data)) sink += DomMarketItems(data).size();
+        });
+        const auto sax_orders_ms = MillisecondsPer(repeat, [&] {
+            std::string_view event;
+            std::string_view payload;
+            if (ParseSocketIOMessage(orders, event, payload)) sink += ParseMarketItems(payload).size();
+        });
+        const auto dom_available_ms = MillisecondsPer(repeat, [&] {
+            std::string event;
+            json data;
+            if (DomParseSocketIOMessage(available, event, data)) sink += DomAvailableOrders(data).size();
+        });
+        const auto sax_available_ms = MillisecondsPer(repeat, [&] {
+            std::string_view event;
+            std::string_view payload;
+            std::vector<AvailableItem> items;
+            if (ParseSocketIOMessage(available, event, payload) && ParseAvailableOrders(payload, items)) sink += items.size();
+        });
+        printf("snapshot %zu items, orders %.1f MB, available %.1f MB\n", count, orders.size() / 1e6, available.size() / 1e6);
+        printf("  GetItemOrders      DOM %8.2f ms   SAX %8.2f ms\n", dom_orders_ms, sax_orders_ms);
+        printf("  GetAvailableOrders DOM %8.2f ms   SAX %8.2f ms   (%zu)\n", dom_available_ms, sax_available_ms, sink);
+        return failures;
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    size_t count = 20000;
+    if (argc > 1) {
+        std::from_chars(argv[1], argv[1] + strlen(argv[1]), count);
+    }
+    const auto frames = LoadFrames(argc > 2 ? argv[2] : TESTS_DATA_DIR "/gwmarket_frames.txt");
+    if (frames.empty()) {
+        printf("no sample frames\n");
+        return 1;
+    }
+
+    size_t failures = 0;
+    for (const auto& frame : frames) {
+        failures += CheckFrame(frame);
+    }
+    for (const auto frame : MALFORMED_FRAMES) {
+        failures += CheckFrame(frame);
+    }
+    printf("%zu sample frames, %zu malformed, %zu mismatches\n", frames.size(), std::size(MALFORMED_FRAMES), failures);
+    failures += Snapshot(count);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,299 @@
+// Checks RegexSet against std::regex, then times both on chat.
+// Random patterns and texts must give the same answer from both engines, narrow and wide, with and without icase, alone and in sets.
+// The chat corpus is in the format TradeHistory writes, so a day of real history can be passed instead of the sample.
+// Usage: RegexSetCheck [fuzz cases] [corpus file]
+
+#include "stdafx.h"
+
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <random>
+
+#include <RegexSet.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Filters of the kind people keep in FilterByContent_regex.txt and their trade alerts
+    constexpr const char* CHAT_PATTERNS[] = {
+        R"(\bwts\b.*\becto)",
+        R"(\b(zodiac|crystalline|tormented)\s+(shield|sword|staff|bow)\b)",
+        R"(\d+(\.\d+)?\s*k\s*(ea|each)\b)",
+        R"(q(8|9|10)\b.*\b15\^50\b)",
+        R"(^wtb\s)",
+        R"(\b(\d+)e\b)",
+        R"(\[[^\]]+\]\s*(q\d+|r\d+)?)",
+        R"(armbraces?\s+of\s+truth)",
+        R"(\bpm\b\s*$)",
+        R"(g'?eve|vaettir)",
+    };
+
+    // Exponential for a backtracking engine, on a line of a's with no match
+    constexpr const char* PATHOLOGICAL_PATTERN = "(a|aa)*c";
+
+    std::vector<std::string> LoadCorpus(const char* path)
+    {
+        std::vector<std::string> lines;
+        std::ifstream file(path, std::ios::binary);
+        std::string line;
+        while (std::getline(file, line)) {
+            // timestamp, map, name, message
+            size_t field = 0;
+            for (int i = 0; i < 3 && field != std::string::npos; i++) {
+                field = line.find('\t', field ? field + 1 : 0);
+            }
+            if (field != std::string::npos) {
+                lines.push_back(line.substr(field + 1));
+            }
+        }
+        return lines;
+    }
+
+    std::wstring Widen(const std::string_view s)
+    {
+        // Test input is ASCII apart from the odd Latin-1 letter written as a single byte
+        std::wstring out;
+        for (const auto c : s) {
+            out.push_back(static_cast<wchar_t>(static_cast<uint8_t>(c)));
+        }
+        return out;
+    }
+
+    class PatternGenerator {
+    public:
+        explicit PatternGenerator(const uint32_t seed) : rng(seed) {}
+
+        std::string Pattern(const int depth = 0)
+        {
+            std::string out = Sequence(depth);
+            while (Chance(depth ? 15 : 25)) {
+                out += '|';
+                out += Sequence(depth);
+            }
+            return out;
+        }
+
+        std::string Text()
+        {
+            static constexpr char ALPHABET[] = "aaabbcAB1 _.-\xe9\xc9";
+            std::string out(Pick(0, 24), ' ');
+            for (auto& c : out) {
+                c = ALPHABET[Pick(0, sizeof(ALPHABET) - 2)];
+            }
+            return out;
+        }
+
+    private:
+        std::string Sequence(const int depth)
+        {
+            std::string out;
+            for (auto n = Pick(1, 4); n; n--) {
+                out += Atom(depth);
+            }
+            return out;
+        }
+
+        std::string Atom(const int depth)
+        {
+            static constexpr const char* ASSERTIONS[] = {"^", "$", "\\b", "\\B"};
+            static constexpr const char* ATOMS[] = {"a", "b", "c", "A", "1", " ", "\xe9", ".", "[abc]", "[^a]", "[a-c]", "[A-Z]", "\\d", "\\w", "\\s", "\\W", "\\.", "_"};
+            if (Chance(8)) {
+                return ASSERTIONS[Pick(0, std::size(ASSERTIONS) - 1)];
+            }
+            static constexpr const char* QUANTIFIERS[] = {"?", "{2}", "{0,3}", "{2,4}", "*", "+", "{1,}"};
+            std::string atom;
+            size_t quantifiers = std::size(QUANTIFIERS);
+            if (depth < 3 && Chance(15)) {
+                atom = (Chance(50) ? "(" : "(?:") + Pattern(depth + 1) + ")";
+                // Unbounded loops around groups make std::regex, the reference, exponential; the single-atom ones cover RegexSet's loops
+                quantifiers = 4;
+            }
+            else {
+                atom = ATOMS[Pick(0, std::size(ATOMS) - 1)];
+            }
+            if (Chance(35)) {
+                atom += QUANTIFIERS[Pick(0, quantifiers - 1)];
+                if (Chance(20)) {
+                    atom += '?';
+                }
+            }
+            return atom;
+        }
+
+        size_t Pick(const size_t lo, const size_t hi) { return std::uniform_int_distribution<size_t>(lo, hi)(rng); }
+        bool Chance(const int percent) { return Pick(0, 99) < static_cast<size_t>(percent); }
+
+        std::mt19937 rng;
+    };
+
+    template <typename CharT>
+    bool StdSearch(const std::vector<std::basic_regex<CharT>>& regexes, const std::basic_string<CharT>& text)
+    {
+        return std::ranges::any_of(regexes, [&text](const auto& re) { return std::regex_search(text, re); });
+    }
+
+    // Returns the number of disagreements
+    template <typename CharT>
+    size_t FuzzOne(const std::vector<std::string>& patterns, const std::vector<std::string>& texts, const bool icase)
+    {
+        using String = std::basic_string<CharT>;
+        const auto convert = [](const std::string& s) {
+            if constexpr (sizeof(CharT) == 1) {
+                return s;
+            }
+            else {
+                return Widen(s);
+            }
+        };
+
+        const auto std_flags = icase ? std::regex_constants::ECMAScript | std::regex_constants::icase : std::regex_constants::ECMAScript;
+        std::vector<std::basic_regex<CharT>> expected;
+        RegexSet set;
+        for (const auto& pattern : patterns) {
+            const String converted = convert(pattern);
+            bool std_ok = true;
+            bool set_ok = true;
+            try {
+                expected.emplace_back(converted, std_flags);
+            } catch (const std::regex_error&) {
+                std_ok = false;
+            }
+            try {
+                set.Add(std::basic_string_view<CharT>(converted), icase ? RegexSet::IgnoreCase : RegexSet::Default);
+            } catch (const std::regex_error&) {
+                set_ok = false;
+            }
+            if (std_ok != set_ok) {
+                printf("validity differs for /%s/: std::regex %s, RegexSet %s\n", pattern.c_str(), std_ok ? "accepts" : "rejects", set_ok ? "accepts" : "rejects");
+                return 1;
+            }
+        }
+
+        size_t failures = 0;
+        for (const auto& text : texts) {
+            const String converted = convert(text);
+            bool want;
+            try {
+                want = StdSearch(expected, converted);
+            } catch (const std::regex_error&) {
+                continue; // std::regex gave up (error_complexity or error_stack); nothing to compare with
+            }
+            if (set.Search(std::basic_string_view<CharT>(converted)) != want) {
+                printf("%s%s mismatch on \"%s\": std::regex says %d for", sizeof(CharT) == 1 ? "narrow" : "wide", icase ? " icase" : "", text.c_str(), want);
+                for (const auto& pattern : patterns) {
+                    printf(" /%s/", pattern.c_str());
+                }
+                printf("\n");
+                failures++;
+            }
+        }
+        return failures;
+    }
+
+    size_t Fuzz(const size_t cases)
+    {
+        PatternGenerator gen(12345);
+        size_t failures = 0;
+        for (size_t i = 0; i < cases && failures < 20; i++) {
+            // Every fourth case is a set of several patterns, to check they don't interfere with each other
+            std::vector<std::string> patterns(i % 4 == 3 ? 3 : 1);
+            for (auto& pattern : patterns) {
+                pattern = gen.Pattern();
+            }
+            std::vector<std::string> texts(8);
+            for (auto& text : texts) {
+                text = gen.Text();
+            }
+            failures += FuzzOne<char>(patterns, texts, i % 2);
+            failures += FuzzOne<wchar_t>(patterns, texts, i % 2);
+        }
+        printf("fuzz   %zu cases, %zu mismatches\n", cases, failures);
+        return failures;
+    }
+
+    // The patterns against real chat; each line has to get the same answer, and the time for both is reported
+    size_t Corpus(const std::vector<std::string>& lines, const size_t repeat)
+    {
+        std::vector<std::regex> regexes;
+        RegexSet set;
+        for (const auto pattern : CHAT_PATTERNS) {
+            regexes.emplace_back(pattern, std::regex_constants::ECMAScript | std::regex_constants::icase);
+            set.Add(std::string_view(pattern), RegexSet::IgnoreCase);
+        }
+
+        size_t failures = 0;
+        size_t matched = 0;
+        for (const auto& line : lines) {
+            const bool want = StdSearch(regexes, line);
+            matched += want;
+            if (set.Search(std::string_view(line)) != want) {
+                printf("corpus mismatch on \"%s\": std::regex says %d\n", line.c_str(), want);
+                failures++;
+            }
+        }
+
+        size_t sink = 0;
+        auto started = Clock::now();
+        for (size_t r = 0; r < repeat; r++) {
+            for (const auto& line : lines) {
+                sink += StdSearch(regexes, line);
+            }
+        }
+        const auto std_seconds = std::chrono::duration<double>(Clock::now() - started).count();
+        started = Clock::now();
+        for (size_t r = 0; r < repeat; r++) {
+            for (const auto& line : lines) {
+                sink += set.Search(std::string_view(line));
+            }
+        }
+        const auto set_seconds = std::chrono::duration<double>(Clock::now() - started).count();
+        const auto searched = static_cast<double>(lines.size() * repeat);
+        printf("corpus %zu lines, %zu patterns, %zu lines match\n", lines.size(), std::size(CHAT_PATTERNS), matched);
+        printf("       std::regex %8.2f us/line   RegexSet %8.2f us/line   (%zu)\n", std_seconds * 1e6 / searched, set_seconds * 1e6 / searched, sink);
+        return failures;
+    }
+
+    // Backtracking blows up on this one, so std::regex only gets a short line
+    void Pathological()
+    {
+        const std::regex re(PATHOLOGICAL_PATTERN);
+        RegexSet set;
+        set.Add(std::string_view(PATHOLOGICAL_PATTERN));
+        for (const size_t length : {16, 24}) {
+            const std::string text(length, 'a');
+            auto started = Clock::now();
+            bool std_found = false;
+            try {
+                std_found = std::regex_search(text, re);
+            } catch (const std::regex_error&) {}
+            const auto std_us = std::chrono::duration<double, std::micro>(Clock::now() - started).count();
+            started = Clock::now();
+            const bool set_found = set.Search(std::string_view(text));
+            const auto set_us = std::chrono::duration<double, std::micro>(Clock::now() - started).count();
+            printf("/%s/ on %zu a's: std::regex %10.0f us, RegexSet %6.1f us (%d %d)\n", PATHOLOGICAL_PATTERN, length, std_us, set_us, std_found, set_found);
+        }
+        const std::string long_text(100000, 'a');
+        const auto started = Clock::now();
+        const bool found = set.Search(std::string_view(long_text));
+        printf("/%s/ on %zu a's: RegexSet %.0f us (%d)\n", PATHOLOGICAL_PATTERN, long_text.size(), std::chrono::duration<double, std::micro>(Clock::now() - started).count(), found);
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    size_t cases = 20000;
+    if (argc > 1) {
+        std::from_chars(argv[1], argv[1] + strlen(argv[1]), cases);
+    }
+    const auto lines = LoadCorpus(argc > 2 ? argv[2] : TESTS_DATA_DIR "/trade_chat.txt");
+    if (lines.empty()) {
+        printf("no chat corpus\n");
+        return 1;
+    }
+
+    size_t failures = Fuzz(cases);
+    failures += Corpus(lines, cases >= 20000 ? 50 : 1);
+    Pathological();
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,391 @@
+// Drives CurlEasy against an in-process HTTP/1.1 server on loopback, so changes to the REST stack can be measured without
+// touching live services. The server can delay, chunk, fail or drop any response; every response is checked.
+// Usage: RestClientBench [requests]
+
+#include <CurlWrapper.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    constexpr size_t SYNC_THREADS = 4;
+    constexpr size_t ASYNC_IN_FLIGHT = 32;
+
+    // What one request asks the server for; also what the response is checked against
+    struct Job {
+        size_t size = 512;
+        int status = 200;
+        int delay_ms = 0;
+        bool chunked = false;
+        bool drop = false; // Close the connection instead of answering
+    };
+
+    // Mostly small responses, with some chunked, slow, failed and dropped ones mixed in
+    Job MakeJob(const size_t i)
+    {
+        Job job;
+        if (i % 50 == 49) {
+            job.drop = true;
+        }
+        else if (i % 20 == 0) {
+            job.status = 500;
+            job.size = 64;
+        }
+        else if (i % 20 == 1) {
+            job.delay_ms = 2;
+        }
+        else if (i % 20 == 2 || i % 20 == 3) {
+            job.chunked = true;
+            job.size = 16 * 1024;
+        }
+        return job;
+    }
+
+    char BodyByte(const size_t i)
+    {
+        return static_cast<char>('a' + i % 26);
+    }
+
+    std::string MakeUrl(const uint16_t port, const Job& job)
+    {
+        return "http://127.0.0.1:" + std::to_string(port) + "/?size=" + std::to_string(job.size) + "&status=" + std::to_string(job.status)
+               + "&delay=" + std::to_string(job.delay_ms) + "&chunked=" + (job.chunked ? "1" : "0") + "&drop=" + (job.drop ? "1" : "0");
+    }
+
+    int QueryInt(const std::string_view target, const std::string_view name)
+    {
+        const auto key = std::string(name) + "=";
+        auto pos = target.find(key);
+        if (pos == std::string_view::npos) {
+            return 0;
+        }
+        pos += key.size();
+        int value = 0;
+        std::from_chars(target.data() + pos, target.data() + target.size(), value);
+        return value;
+    }
+
+    bool SendAll(const int fd, const std::string_view data)
+    {
+        for (size_t sent = 0; sent < data.size();) {
+            const auto n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    // Keep-alive HTTP/1.1 server with a thread per connection; answers GETs described by Job's query string
+    class LoopbackServer {
+    public:
+        LoopbackServer()
+        {
+            listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            socklen_t addr_len = sizeof(addr);
+            if (listen_fd < 0
+                || bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0
+                || getsockname(listen_fd, reinterpret_cast<sockaddr*>(&addr), &addr_len) != 0
+                || listen(listen_fd, 128) != 0) {
+                perror("LoopbackServer");
+                return;
+            }
+            port = ntohs(addr.sin_port);
+            acceptor = std::thread([this] { AcceptLoop(); });
+        }
+
+        LoopbackServer(const LoopbackServer&) = delete;
+
+        ~LoopbackServer()
+        {
+            stopping = true;
+            shutdown(listen_fd, SHUT_RDWR);
+            if (acceptor.joinable()) {
+                acceptor.join();
+            }
+            close(listen_fd);
+            {
+                std::lock_guard lock(mutex);
+                for (const auto fd : open_fds) {
+                    shutdown(fd, SHUT_RDWR);
+                }
+            }
+            for (auto& t : connections) {
+                t.join();
+            }
+        }
+
+        [[nodiscard]] uint16_t GetPort() const { return port; }
+
+    private:
+        void AcceptLoop()
+        {
+            while (!stopping) {
+                const int fd = accept(listen_fd, nullptr, nullptr);
+                if (fd < 0) {
+                    continue;
+                }
+                const int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                std::lock_guard lock(mutex);
+                open_fds.insert(fd);
+                connections.emplace_back([this, fd] { Serve(fd); });
+            }
+        }
+
+        void Serve(const int fd)
+        {
+            std::string buffer;
+            char chunk[4096];
+            bool keep_open = true;
+            while (keep_open) {
+                const auto header_end = buffer.find("\r\n\r\n");
+                if (header_end == std::string::npos) {
+                    const auto n = recv(fd, chunk, sizeof(chunk), 0);
+                    if (n <= 0) {
+                        break;
+                    }
+                    buffer.append(chunk, static_cast<size_t>(n));
+                    continue;
+                }
+                const std::string_view request(buffer.data(), header_end);
+                const auto target_begin = request.find(' ') + 1;
+                const auto target = request.substr(target_begin, request.find(' ', target_begin) - target_begin);
+                keep_open = Respond(fd, target);
+                buffer.erase(0, header_end + 4);
+            }
+            std::lock_guard lock(mutex);
+            open_fds.erase(fd);
+            close(fd);
+        }
+
+        // Returns false if the connection should be closed
+        static bool Respond(const int fd, const std::string_view target)
+        {
+            if (QueryInt(target, "drop")) {
+                return false;
+            }
+            if (const auto delay = QueryInt(target, "delay")) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+            }
+            const auto size = static_cast<size_t>(QueryInt(target, "size"));
+            const auto status = QueryInt(target, "status");
+            std::string body(size, '\0');
+            for (size_t i = 0; i < size; i++) {
+                body[i] = BodyByte(i);
+            }
+
+            std::string response = "HTTP/1.1 " + std::to_string(status) + (status == 200 ? " OK" : " Error") + "\r\nContent-Type: application/octet-stream\r\n";
+            if (QueryInt(target, "chunked")) {
+                response += "Transfer-Encoding: chunked\r\n\r\n";
+                constexpr size_t CHUNK = 4000;
+                for (size_t pos = 0; pos < body.size(); pos += CHUNK) {
+                    const auto len = std::min(CHUNK, body.size() - pos);
+                    char hex[16];
+                    snprintf(hex, sizeof(hex), "%zx\r\n", len);
+                    response += hex;
+                    response.append(body, pos, len);
+                    response += "\r\n";
+                }
+                response += "0\r\n\r\n";
+            }
+            else {
+                response += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+                response += body;
+            }
+            return SendAll(fd, response);
+        }
+
+        int listen_fd = -1;
+        uint16_t port = 0;
+        std::atomic<bool> stopping = false;
+        std::thread acceptor;
+        std::mutex mutex;
+        std::set<int> open_fds;
+        std::vector<std::thread> connections;
+    };
+
+    // Exposes the completion step that CurlMultiThread does through AsyncRestClient
+    class BenchRequest : public CurlEasy {
+    public:
+        void Complete(const int curl_code) { UpdateStatus(curl_code); }
+
+        size_t index = 0;
+        Clock::time_point started;
+    };
+
+    bool Check(CurlEasy& easy, const Job& job)
+    {
+        if (job.drop) {
+            return easy.GetStatus() != ResponseStatus::Completed;
+        }
+        if (easy.GetStatus() != ResponseStatus::Completed || easy.GetStatusCode() != job.status) {
+            return false;
+        }
+        const auto& content = easy.GetContent();
+        if (content.size() != job.size) {
+            return false;
+        }
+        for (size_t i = 0; i < content.size(); i++) {
+            if (content[i] != BodyByte(i)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Prepare(CurlEasy& easy, const std::string& url)
+    {
+        easy.SetUrl(url.c_str());
+        easy.SetMethod(HttpMethod::Get);
+        easy.SetTcpNoDelay(true);
+        easy.SetTimeoutSec(10);
+    }
+
+    double CpuSeconds()
+    {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return static_cast<double>(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+
+    struct Results {
+        std::vector<double> latency_us;
+        size_t failed = 0;
+    };
+
+    void Report(const char* name, Results& results, const double wall_seconds, const double cpu_seconds)
+    {
+        auto& latency = results.latency_us;
+        std::ranges::sort(latency);
+        const auto percentile = [&latency](const double q) {
+            return latency.empty() ? 0.0 : latency[std::min(latency.size() - 1, static_cast<size_t>(q * latency.size()))];
+        };
+        printf("%-6s %6zu requests  %9.0f req/s  p50 %7.0f us  p99 %7.0f us  cpu %6.3f s (client and server)  failed %zu\n",
+               name, latency.size(), latency.size() / wall_seconds, percentile(0.5), percentile(0.99), cpu_seconds, results.failed);
+    }
+
+    // Blocking requests, one CurlEasy per thread, like the worker threads use
+    Results RunSync(const uint16_t port, const size_t count)
+    {
+        Results results;
+        std::mutex mutex;
+        std::atomic<size_t> next = 0;
+        std::vector<std::thread> threads;
+        for (size_t t = 0; t < SYNC_THREADS; t++) {
+            threads.emplace_back([&] {
+                CurlEasy easy;
+                Results local;
+                for (size_t i; (i = next++) < count;) {
+                    const auto job = MakeJob(i);
+                    Prepare(easy, MakeUrl(port, job));
+                    const auto started = Clock::now();
+                    easy.Perform();
+                    local.latency_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - started).count());
+                    local.failed += !Check(easy, job);
+                }
+                std::lock_guard lock(mutex);
+                results.latency_us.insert(results.latency_us.end(), local.latency_us.begin(), local.latency_us.end());
+                results.failed += local.failed;
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        return results;
+    }
+
+    // Many transfers in flight on one thread through CurlMulti, like CurlMultiThread
+    Results RunAsync(const uint16_t port, const size_t count)
+    {
+        Results results;
+        CurlMulti multi;
+        std::vector<std::unique_ptr<BenchRequest>> requests(ASYNC_IN_FLIGHT);
+        size_t next = 0;
+        size_t done = 0;
+        const auto start = [&](std::unique_ptr<BenchRequest>& request) {
+            request = std::make_unique<BenchRequest>();
+            request->index = next++;
+            Prepare(*request, MakeUrl(port, MakeJob(request->index)));
+            request->started = Clock::now();
+            multi.AddHandle(request.get());
+        };
+        for (auto& request : requests) {
+            if (next < count) {
+                start(request);
+            }
+        }
+        while (done < count) {
+            multi.Perform();
+            int left = 0;
+            while (const auto msg = curl_multi_info_read(multi.GetHandle(), &left)) {
+                const auto found = std::ranges::find_if(requests, [msg](const auto& r) { return r && r->GetHandle() == msg->easy_handle; });
+                auto& request = *found;
+                multi.RemoveHandle(request.get());
+                request->Complete(msg->data.result);
+                results.latency_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - request->started).count());
+                results.failed += !Check(*request, MakeJob(request->index));
+                done++;
+                request.reset();
+                if (next < count) {
+                    start(request);
+                }
+            }
+            curl_multi_poll(multi.GetHandle(), nullptr, 0, 100, nullptr);
+        }
+        return results;
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    size_t count = 5000;
+    if (argc > 1) {
+        std::from_chars(argv[1], argv[1] + strlen(argv[1]), count);
+    }
+
+    InitCurl();
+    size_t failed = 0;
+    {
+        LoopbackServer server;
+        if (!server.GetPort()) {
+            return 1;
+        }
+        for (const auto& [name, run] : {std::pair{"sync", &RunSync}, std::pair{"async", &RunAsync}}) {
+            const auto cpu_before = CpuSeconds();
+            const auto started = Clock::now();
+            auto results = run(server.GetPort(), count);
+            const auto wall = std::chrono::duration<double>(Clock::now() - started).count();
+            Report(name, results, wall, CpuSeconds() - cpu_before);
+            failed += results.failed;
+        }
+        const auto stats = GetCurlStats();
+        printf("%llu transfers, %llu new connections\n", static_cast<unsigned long long>(stats.Requests), static_cast<unsigned long long>(stats.NewConnections));
+    }
+    ShutdownCurl();
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,274 @@
+// Checks and times TextUtils::Fold's kernel, as char16_t since wchar_t is 32 bits here.
+// Every fold has to agree with a plain table lookup per character (which is what the SSE2 ASCII path skips), in place or not, and the
+// single folds with the per-character code they replaced. Timings are for chat, for names full of diacritics, and for long ASCII runs.
+// Usage: TextKernelsBench [repeat] [corpus file]
+
+#include "stdafx.h"
+
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <locale>
+#include <random>
+
+#include <TextKernels.h>
+
+namespace {
+    using namespace TextUtils;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr const char16_t* NAMES[] = {
+        u"Ðéstròyér Çhåøs Äxe",
+        u"Ŝtëvîe Wönder Of Ťhe Ñorth",
+        u"Mïstress Ōf Ĝreed",
+        u"Zodiac Shield (Ægis) — Q9 Str",
+        u"Ḿesmer Ŀord Ĳssel",
+        u"Ｆｕｌｌｗｉｄｔｈ Ｔｒａｄｅｒ",
+    };
+
+    std::vector<std::u16string> LoadCorpus(const char* path)
+    {
+        std::vector<std::u16string> lines;
+        std::ifstream file(path, std::ios::binary);
+        std::string line;
+        while (std::getline(file, line)) {
+            // timestamp, map, name, message
+            size_t field = 0;
+            for (int i = 0; i < 3 && field != std::string::npos; i++) {
+                field = line.find('\t', field ? field + 1 : 0);
+            }
+            if (field != std::string::npos) {
+                // The sample is ASCII; anything else just becomes a non-ASCII code unit, which is all the kernel cares about
+                std::u16string message;
+                for (const auto c : std::string_view(line).substr(field + 1)) {
+                    message.push_back(static_cast<char16_t>(static_cast<uint8_t>(c)));
+                }
+                lines.push_back(message);
+            }
+        }
+        return lines;
+    }
+
+    // Per character, as Fold is defined: drop punctuation if asked, then look the rest up
+    size_t Reference(const std::u16string_view s, char16_t* out, const uint8_t flags)
+    {
+        const auto& tables = detail::GetFoldTables();
+        size_t written = 0;
+        for (const auto c : s) {
+            if (flags & FoldPunctuation && tables.punctuation[c]) continue;
+            uint16_t folded = c;
+            if (flags & FoldCase) {
+                folded = flags & FoldDiacritics ? tables.folded[c] : tables.lower[c];
+            }
+            else if (flags & FoldDiacritics) {
+                folded = tables.diacritics[c];
+            }
+            out[written++] = static_cast<char16_t>(folded);
+        }
+        return written;
+    }
+
+    std::u16string Reference(const std::u16string_view s, const uint8_t flags)
+    {
+        std::u16string out(s.size(), u'\0');
+        out.resize(Reference(s, out.data(), flags));
+        return out;
+    }
+
+    // RemoveDiacritics, ToLower and RemovePunctuation as they were: a std::map lookup, or a std::locale constructed, per character
+    class Legacy {
+    public:
+        Legacy()
+        {
+            const auto& tables = detail::GetFoldTables();
+            for (size_t i = 0; i < tables.diacritics.size(); i++) {
+                if (tables.diacritics[i] != i) diacritics_charmap[static_cast<wchar_t>(i)] = static_cast<wchar_t>(tables.diacritics[i]);
+            }
+        }
+
+        std::wstring RemoveDiacritics(const std::wstring_view s) const
+        {
+            std::wstring out(s.length(), L'\0');
+            std::ranges::transform(s, out.begin(), [&](const wchar_t wc) -> wchar_t {
+                if (wc < 0x7f) {
+                    return wc;
+                }
+                const auto it = diacritics_charmap.find(wc);
+                return it == diacritics_charmap.end() ? wc : it->second;
+            });
+            return out;
+        }
+
+        static std::wstring ToLower(std::wstring s)
+        {
+            std::ranges::transform(s, s.begin(), [](const wchar_t c) {
+                return std::tolower(c, std::locale());
+            });
+            return s;
+        }
+
+        static std::wstring RemovePunctuation(std::wstring s)
+        {
+            std::erase_if(s, [](auto c) { return std::ispunct(c, std::locale()); });
+            return s;
+        }
+
+    private:
+        std::map<wchar_t, wchar_t> diacritics_charmap;
+    };
+
+    std::wstring Widen(const std::u16string_view s)
+    {
+        return {s.begin(), s.end()};
+    }
+
+    std::u16string Narrow(const std::wstring_view s)
+    {
+        std::u16string out;
+        for (const auto c : s) {
+            out.push_back(static_cast<char16_t>(c));
+        }
+        return out;
+    }
+
+    std::u16string Kernel(const std::u16string_view s, const uint8_t flags)
+    {
+        std::u16string out(s.size(), u'\0');
+        out.resize(detail::Fold(s, out.data(), flags));
+        return out;
+    }
+
+    size_t Check(const std::u16string_view s, const Legacy& legacy)
+    {
+        size_t failures = 0;
+        for (uint8_t flags = 0; flags < 8; flags++) {
+            const auto want = Reference(s, flags);
+            std::u16string in_place(s);
+            in_place.resize(detail::Fold(std::u16string_view(in_place), in_place.data(), flags));
+            if (Kernel(s, flags) != want || in_place != want) {
+                printf("flags %d: kernel differs from the table on a %zu character string\n", flags, s.size());
+                failures++;
+            }
+        }
+        const auto wide = Widen(s);
+        if (Kernel(s, FoldDiacritics) != Narrow(legacy.RemoveDiacritics(wide))) {
+            printf("FoldDiacritics differs from the old RemoveDiacritics on a %zu character string\n", s.size());
+            failures++;
+        }
+        if (Kernel(s, FoldCase) != Narrow(Legacy::ToLower(wide))) {
+            printf("FoldCase differs from the old ToLower on a %zu character string\n", s.size());
+            failures++;
+        }
+        if (Kernel(s, FoldPunctuation) != Narrow(Legacy::RemovePunctuation(wide))) {
+            printf("FoldPunctuation differs from the old RemovePunctuation on a %zu character string\n", s.size());
+            failures++;
+        }
+        return failures;
+    }
+
+    // Runs of ASCII broken up by the odd non-ASCII character, at every length and alignment the 8-wide loop can see
+    size_t Fuzz(const size_t cases, const Legacy& legacy)
+    {
+        static constexpr char16_t ALPHABET[] = u"aaaazZAM09 .,!?-_[]éÉİẞＡⒶ𐏿￿\u007f\u0080";
+        std::mt19937 rng(12345);
+        const auto pick = [&rng](const size_t hi) { return std::uniform_int_distribution<size_t>(0, hi)(rng); };
+        size_t failures = 0;
+        for (size_t i = 0; i < cases && failures < 20; i++) {
+            std::u16string s(pick(40), u' ');
+            const bool mostly_ascii = i % 2;
+            for (auto& c : s) {
+                c = ALPHABET[pick(mostly_ascii && pick(15) ? 18 : std::size(ALPHABET) - 2)];
+            }
+            failures += Check(std::u16string_view(s).substr(pick(std::min<size_t>(s.size(), 7))), legacy);
+        }
+        printf("fuzz   %zu cases, %zu mismatches\n", cases, failures);
+        return failures;
+    }
+
+    template <typename Fn>
+    double NanosecondsPerChar(const std::vector<std::u16string>& texts, const size_t repeat, Fn&& fn)
+    {
+        size_t chars = 0;
+        for (const auto& text : texts) {
+            chars += text.size();
+        }
+        const auto started = Clock::now();
+        for (size_t r = 0; r < repeat; r++) {
+            for (const auto& text : texts) {
+                fn(text);
+            }
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - started).count() / static_cast<double>(chars * repeat);
+    }
+
+    void Time(const char* label, const std::vector<std::u16string>& texts, const size_t repeat, const Legacy& legacy)
+    {
+        std::vector<std::wstring> wide;
+        for (const auto& text : texts) {
+            wide.push_back(Widen(text));
+        }
+        size_t sink = 0;
+        std::u16string out;
+        const auto kernel = [&](const uint8_t flags) {
+            return NanosecondsPerChar(texts, repeat, [&](const std::u16string& text) {
+                out.resize(text.size());
+                sink += detail::Fold(std::u16string_view(text), out.data(), flags);
+            });
+        };
+        // Only the wide strings are timed for the old code, so it isn't charged for converting
+        const auto old = [&](auto&& fn) {
+            size_t i = 0;
+            return NanosecondsPerChar(texts, repeat, [&](const std::u16string&) {
+                sink += fn(wide[i++ % wide.size()]).size();
+            });
+        };
+        const auto table = [&](const uint8_t flags) {
+            return NanosecondsPerChar(texts, repeat, [&](const std::u16string& text) {
+                out.resize(text.size());
+                sink += Reference(text, out.data(), flags);
+            });
+        };
+
+        printf("%s, %zu strings, ns/char\n", label, texts.size());
+        printf("  diacritics        old %6.2f   table %6.2f   Fold %6.2f\n", old([&](const std::wstring& s) { return legacy.RemoveDiacritics(s); }), table(FoldDiacritics), kernel(FoldDiacritics));
+        printf("  case              old %6.2f   table %6.2f   Fold %6.2f\n", old(Legacy::ToLower), table(FoldCase), kernel(FoldCase));
+        printf("  punctuation       old %6.2f   table %6.2f   Fold %6.2f\n", old(Legacy::RemovePunctuation), table(FoldPunctuation), kernel(FoldPunctuation));
+        printf("  case+diacritics   old %6.2f   table %6.2f   Fold %6.2f\n", old([&](const std::wstring& s) { return Legacy::ToLower(legacy.RemoveDiacritics(s)); }), table(FoldCase | FoldDiacritics),
+               kernel(FoldCase | FoldDiacritics));
+        printf("  all three         old %6.2f   table %6.2f   Fold %6.2f   (%zu)\n", old([&](const std::wstring& s) { return Legacy::RemovePunctuation(Legacy::ToLower(legacy.RemoveDiacritics(s))); }),
+               table(FoldCase | FoldDiacritics | FoldPunctuation), kernel(FoldCase | FoldDiacritics | FoldPunctuation), sink);
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    size_t repeat = 50;
+    if (argc > 1) {
+        std::from_chars(argv[1], argv[1] + strlen(argv[1]), repeat);
+    }
+    const auto lines = LoadCorpus(argc > 2 ? argv[2] : TESTS_DATA_DIR "/trade_chat.txt");
+    if (lines.empty()) {
+        printf("no chat corpus\n");
+        return 1;
+    }
+
+    const Legacy legacy;
+    size_t failures = Fuzz(repeat * 100, legacy);
+    for (const auto& line : lines) {
+        failures += Check(line, legacy);
+    }
+    for (const auto name : NAMES) {
+        failures += Check(name, legacy);
+    }
+    printf("corpus %zu lines, %zu names, %zu mismatches\n", lines.size(), std::size(NAMES), failures);
+
+    Time("chat", lines, repeat, legacy);
+    Time("names", std::vector<std::u16string>(std::begin(NAMES), std::end(NAMES)), repeat * 100, legacy);
+    std::u16string long_ascii;
+    for (const auto& line : lines) {
+        long_ascii += line;
+        long_ascii += u' ';
+    }
+    Time("one long ASCII run", {long_ascii}, repeat, legacy);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,174 @@
+// Times the alert matching TradeWindow and PartySearchWindow share, AlertList, on trade chat against the per-message loop it replaced.
+// Both have to agree on every line.
+// Usage: TradeAlertBench [repeat] [corpus file]
+
+#include "stdafx.h"
+
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+
+#include <AlertList.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // A busy trader's list: mostly item names, a few patterns
+    constexpr const char* ALERTS = R"(ecto
+zodiac shield
+armbrace
+tormented
+crystalline
+froggy
+bone dragon
+chaos axe
+destroyer
+celestial
+miniature
+sup vigor
+tonic
+lockpick
+zaishen key
+15^50
+hsr
+oni blade
+raven staff
+dhuum
+glacial blade
+eternal blade
+voltaic spear
+obby
+granite slab
+/\bwt[sb]\b.*\bq(8|9)\b/
+/\b[1-9]\d*\s*e\b/
+/(sword|axe|staff)\s.*\b(vamp|zeal)\b/
+/\bWTS\W+\S*\s*ECTO/i
+)";
+
+    std::vector<std::string> LoadCorpus(const char* path)
+    {
+        std::vector<std::string> lines;
+        std::ifstream file(path, std::ios::binary);
+        std::string line;
+        while (std::getline(file, line)) {
+            // timestamp, map, name, message
+            size_t field = 0;
+            for (int i = 0; i < 3 && field != std::string::npos; i++) {
+                field = line.find('\t', field ? field + 1 : 0);
+            }
+            if (field != std::string::npos) {
+                lines.push_back(line.substr(field + 1));
+            }
+        }
+        return lines;
+    }
+
+    // As IsTradeAlert was: every message tries each line in turn, building each regex as it goes.
+    // It lowercased regex lines too, which turned \W \D \S \B into \w \d \s \b; only the plain words are lowercased here, as AlertList does.
+    class PerMessageAlerts {
+    public:
+        explicit PerMessageAlerts(const char* text)
+        {
+            std::istringstream stream(text);
+            std::string word;
+            static const auto regex_check = std::regex("^/(.*)/[a-z]?$", std::regex::ECMAScript | std::regex::icase);
+            while (std::getline(stream, word)) {
+                if (!std::regex_search(word, regex_check)) {
+                    for (auto& c : word) {
+                        c = static_cast<char>(tolower(c));
+                    }
+                }
+                alert_words.push_back(word);
+            }
+        }
+
+        bool Matches(const std::string& message) const
+        {
+            std::regex word_regex;
+            std::smatch m;
+            static const auto regex_check = std::regex("^/(.*)/[a-z]?$", std::regex::ECMAScript | std::regex::icase);
+            for (const auto& word : alert_words) {
+                if (std::regex_search(word, m, regex_check)) {
+                    try {
+                        word_regex = std::regex(m[1].str(), std::regex::ECMAScript | std::regex::icase);
+                    } catch (const std::exception&) {
+                        // Silent fail; invalid regex
+                    }
+                    if (std::regex_search(message, word_regex)) {
+                        return true;
+                    }
+                }
+                else {
+                    const auto found = std::ranges::search(message, word, [](const char c1, const char c2) -> bool {
+                                           return tolower(c1) == c2;
+                                       }).begin();
+                    if (found != message.end()) {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+    private:
+        std::vector<std::string> alert_words;
+    };
+
+    template <typename Fn>
+    double MicrosecondsPer(const size_t count, Fn&& fn)
+    {
+        const auto started = Clock::now();
+        fn();
+        return std::chrono::duration<double, std::micro>(Clock::now() - started).count() / static_cast<double>(count);
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    size_t repeat = 20;
+    if (argc > 1) {
+        std::from_chars(argv[1], argv[1] + strlen(argv[1]), repeat);
+    }
+    const auto lines = LoadCorpus(argc > 2 ? argv[2] : TESTS_DATA_DIR "/trade_chat.txt");
+    if (lines.empty()) {
+        printf("no chat corpus\n");
+        return 1;
+    }
+
+    const PerMessageAlerts per_message(ALERTS);
+    const auto compile_us = MicrosecondsPer(1, [] { AlertList().Compile(ALERTS); });
+    AlertList compiled;
+    compiled.Compile(ALERTS);
+
+    size_t mismatches = 0;
+    size_t alerts = 0;
+    for (const auto& line : lines) {
+        const bool want = per_message.Matches(line);
+        alerts += want;
+        if (compiled.Matches(line) != want) {
+            printf("mismatch on \"%s\": per message says %d\n", line.c_str(), want);
+            mismatches++;
+        }
+    }
+
+    size_t sink = 0;
+    const auto searched = lines.size() * repeat;
+    const auto per_message_us = MicrosecondsPer(searched, [&] {
+        for (size_t r = 0; r < repeat; r++) {
+            for (const auto& line : lines) {
+                sink += per_message.Matches(line);
+            }
+        }
+    });
+    const auto compiled_us = MicrosecondsPer(searched, [&] {
+        for (size_t r = 0; r < repeat; r++) {
+            for (const auto& line : lines) {
+                sink += compiled.Matches(line);
+            }
+        }
+    });
+
+    printf("%zu messages, %zu alert on, %zu mismatches\n", lines.size(), alerts, mismatches);
+    printf("per message %8.2f us/message   compiled %6.2f us/message   compile once %.0f us   (%zu)\n", per_message_us, compiled_us, compile_us, sink);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,369 @@
+// Checks TextUtils' UTF-8/UTF-16 transcoders at every SIMD level against a reference written from the Unicode tables, then times them
+// against std::codecvt, which stands in here for the MultiByteToWideChar/WideCharToMultiByte calls they replaced. Built as char16_t, since
+// wchar_t is 32 bits here.
+// Usage: TranscodeBench [fuzz cases] [corpus file]
+
+#include "stdafx.h"
+
+#include <charconv>
+#include <codecvt>
+#include <cstdio>
+#include <fstream>
+#include <locale>
+#include <optional>
+#include <random>
+
+#include <TextKernels.h>
+
+namespace {
+    using namespace TextUtils;
+    using detail::Simd;
+    using Clock = std::chrono::steady_clock;
+
+    constexpr Simd LEVELS[] = {Simd::None, Simd::Sse2, Simd::Avx2};
+    constexpr const char* LEVEL_NAMES[] = {"scalar", "SSE2", "AVX2"};
+
+    // AVX2 code would fault on a CPU without it, so it's left out there
+    size_t Levels()
+    {
+        return detail::BestSimd() == Simd::Avx2 ? 3 : 2;
+    }
+
+    // Well-formed UTF-8, straight from table 3-7 of the Unicode standard; nullopt if s isn't
+    std::optional<std::u16string> ReferenceUtf8ToUtf16(const std::string_view s)
+    {
+        std::u16string out;
+        size_t i = 0;
+        const auto byte = [&s](const size_t at) { return at < s.size() ? static_cast<uint8_t>(s[at]) : 0x100u; };
+        const auto in = [](const uint32_t b, const uint32_t lo, const uint32_t hi) { return b >= lo && b <= hi; };
+        while (i < s.size()) {
+            const uint32_t b0 = byte(i);
+            uint32_t cp;
+            if (b0 <= 0x7f) {
+                cp = b0;
+                i += 1;
+            }
+            else if (in(b0, 0xc2, 0xdf) && in(byte(i + 1), 0x80, 0xbf)) {
+                cp = (b0 & 0x1f) << 6 | (byte(i + 1) & 0x3f);
+                i += 2;
+            }
+            else if (((b0 == 0xe0 && in(byte(i + 1), 0xa0, 0xbf)) || (in(b0, 0xe1, 0xec) && in(byte(i + 1), 0x80, 0xbf)) || (b0 == 0xed && in(byte(i + 1), 0x80, 0x9f)) ||
+                      (in(b0, 0xee, 0xef) && in(byte(i + 1), 0x80, 0xbf))) &&
+                     in(byte(i + 2), 0x80, 0xbf)) {
+                cp = (b0 & 0x0f) << 12 | (byte(i + 1) & 0x3f) << 6 | (byte(i + 2) & 0x3f);
+                i += 3;
+            }
+            else if (((b0 == 0xf0 && in(byte(i + 1), 0x90, 0xbf)) || (in(b0, 0xf1, 0xf3) && in(byte(i + 1), 0x80, 0xbf)) || (b0 == 0xf4 && in(byte(i + 1), 0x80, 0x8f))) &&
+                     in(byte(i + 2), 0x80, 0xbf) && in(byte(i + 3), 0x80, 0xbf)) {
+                cp = (b0 & 0x07) << 18 | (byte(i + 1) & 0x3f) << 12 | (byte(i + 2) & 0x3f) << 6 | (byte(i + 3) & 0x3f);
+                i += 4;
+            }
+            else {
+                return std::nullopt;
+            }
+            if (cp >= 0x10000) {
+                out.push_back(static_cast<char16_t>(0xd800 + ((cp - 0x10000) >> 10)));
+                out.push_back(static_cast<char16_t>(0xdc00 + ((cp - 0x10000) & 0x3ff)));
+            }
+            else {
+                out.push_back(static_cast<char16_t>(cp));
+            }
+        }
+        return out;
+    }
+
+    void AppendUtf8(std::string& out, const uint32_t cp)
+    {
+        if (cp < 0x80) {
+            out += static_cast<char>(cp);
+        }
+        else if (cp < 0x800) {
+            out += static_cast<char>(0xc0 | cp >> 6);
+            out += static_cast<char>(0x80 | (cp & 0x3f));
+        }
+        else if (cp < 0x10000) {
+            out += static_cast<char>(0xe0 | cp >> 12);
+            out += static_cast<char>(0x80 | (cp >> 6 & 0x3f));
+            out += static_cast<char>(0x80 | (cp & 0x3f));
+        }
+        else {
+            out += static_cast<char>(0xf0 | cp >> 18);
+            out += static_cast<char>(0x80 | (cp >> 12 & 0x3f));
+            out += static_cast<char>(0x80 | (cp >> 6 & 0x3f));
+            out += static_cast<char>(0x80 | (cp & 0x3f));
+        }
+    }
+
+    // Well-formed UTF-16 has every surrogate in a high-low pair; nullopt if s doesn't
+    std::optional<std::string> ReferenceUtf16ToUtf8(const std::u16string_view s)
+    {
+        std::string out;
+        for (size_t i = 0; i < s.size(); i++) {
+            uint32_t cp = s[i];
+            if (cp >= 0xdc00 && cp <= 0xdfff) return std::nullopt;
+            if (cp >= 0xd800 && cp <= 0xdbff) {
+                if (i + 1 >= s.size() || s[i + 1] < 0xdc00 || s[i + 1] > 0xdfff) return std::nullopt;
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (s[++i] - 0xdc00);
+            }
+            AppendUtf8(out, cp);
+        }
+        return out;
+    }
+
+    std::optional<std::u16string> KernelUtf8ToUtf16(const std::string_view s, const Simd simd)
+    {
+        const auto measured = detail::TranscodeUtf8ToUtf16<false, char16_t>(s, nullptr, simd);
+        std::u16string out(s.size(), u'\0');
+        const auto written = detail::TranscodeUtf8ToUtf16<true>(s, out.data(), simd);
+        if (written != measured) {
+            printf("measuring says %zu code units, writing says %zu\n", measured, written);
+            return u"<length mismatch>";
+        }
+        if (written == InvalidEncoding) return std::nullopt;
+        out.resize(written);
+        return out;
+    }
+
+    std::optional<std::string> KernelUtf16ToUtf8(const std::u16string_view s, const Simd simd)
+    {
+        const auto measured = detail::TranscodeUtf16ToUtf8<false>(s, nullptr, simd);
+        std::string out(s.size() * 3, '\0');
+        const auto written = detail::TranscodeUtf16ToUtf8<true>(s, out.data(), simd);
+        if (written != measured) {
+            printf("measuring says %zu bytes, writing says %zu\n", measured, written);
+            return "<length mismatch>";
+        }
+        if (written == InvalidEncoding) return std::nullopt;
+        out.resize(written);
+        return out;
+    }
+
+    class TextGenerator {
+    public:
+        explicit TextGenerator(const uint32_t seed) : rng(seed) {}
+
+        // Runs of ASCII long enough for the 32-byte loop, broken up by everything from Latin-1 to astral code points
+        std::vector<uint32_t> CodePoints()
+        {
+            std::vector<uint32_t> out(Pick(0, 90));
+            const auto ascii_percent = static_cast<int>(Pick(0, 4) * 25);
+            for (auto& cp : out) {
+                if (Chance(ascii_percent)) {
+                    cp = static_cast<uint32_t>(Pick(0, 0x7f));
+                    continue;
+                }
+                switch (Pick(0, 4)) {
+                    case 0: cp = static_cast<uint32_t>(Pick(0x80, 0x7ff)); break;
+                    case 1: cp = static_cast<uint32_t>(Pick(0x800, 0xd7ff)); break;
+                    case 2: cp = static_cast<uint32_t>(Pick(0xe000, 0xffff)); break;
+                    case 3: cp = static_cast<uint32_t>(Pick(0x10000, 0x10ffff)); break;
+                    default: cp = Chance(50) ? 0x7f : 0x80; break;
+                }
+            }
+            return out;
+        }
+
+        // Breaks well-formed UTF-8 in one of the ways that matter: stray or missing continuation bytes, overlongs, surrogates, past U+10FFFF
+        void Corrupt(std::string& s)
+        {
+            static constexpr uint8_t BAD[] = {0x80, 0xbf, 0xc0, 0xc1, 0xe0, 0xed, 0xf0, 0xf4, 0xf5, 0xff};
+            static constexpr const char* SEQUENCES[] = {"\xc0\xaf", "\xe0\x80\xaf", "\xed\xa0\x80", "\xed\xbf\xbf", "\xf4\x90\x80\x80", "\xf0\x80\x80\xaf", "\xef\xbf\xbf", "\xf4\x8f\xbf\xbf"};
+            const auto at = Pick(0, s.size());
+            switch (Pick(0, 3)) {
+                case 0: s.insert(at, 1, static_cast<char>(BAD[Pick(0, std::size(BAD) - 1)])); break;
+                case 1: s.insert(at, SEQUENCES[Pick(0, std::size(SEQUENCES) - 1)]); break;
+                case 2: s.resize(at); break;
+                default:
+                    if (!s.empty()) s[Pick(0, s.size() - 1)] = static_cast<char>(Pick(0, 0xff));
+                    break;
+            }
+        }
+
+        // Same for UTF-16: unpaired and reversed surrogates
+        void Corrupt(std::u16string& s)
+        {
+            const auto at = Pick(0, s.size());
+            switch (Pick(0, 2)) {
+                case 0: s.insert(at, 1, static_cast<char16_t>(Pick(0xd800, 0xdfff))); break;
+                case 1: s.insert(at, u"\xdc00\xd800"); break;
+                default: s.resize(at); break;
+            }
+        }
+
+        bool Chance(const int percent) { return Pick(0, 99) < static_cast<size_t>(percent); }
+
+    private:
+        size_t Pick(const size_t lo, const size_t hi) { return std::uniform_int_distribution<size_t>(lo, hi)(rng); }
+
+        std::mt19937 rng;
+    };
+
+    std::u16string ToUtf16(const std::vector<uint32_t>& code_points)
+    {
+        std::string utf8;
+        for (const auto cp : code_points) {
+            AppendUtf8(utf8, cp);
+        }
+        return *ReferenceUtf8ToUtf16(utf8);
+    }
+
+    // Returns the number of disagreements
+    size_t CheckUtf8(const std::string& s)
+    {
+        const auto want = ReferenceUtf8ToUtf16(s);
+        size_t failures = 0;
+        for (size_t level = 0; level < Levels(); level++) {
+            if (KernelUtf8ToUtf16(s, LEVELS[level]) != want) {
+                printf("%s UTF-8 -> UTF-16 differs on a %zu byte string (reference says %s)\n", LEVEL_NAMES[level], s.size(), want ? "valid" : "invalid");
+                failures++;
+            }
+        }
+        return failures;
+    }
+
+    size_t CheckUtf16(const std::u16string& s)
+    {
+        const auto want = ReferenceUtf16ToUtf8(s);
+        size_t failures = 0;
+        for (size_t level = 0; level < Levels(); level++) {
+            if (KernelUtf16ToUtf8(s, LEVELS[level]) != want) {
+                printf("%s UTF-16 -> UTF-8 differs on a %zu code unit string (reference says %s)\n", LEVEL_NAMES[level], s.size(), want ? "valid" : "invalid");
+                failures++;
+            }
+        }
+        return failures;
+    }
+
+    size_t Fuzz(const size_t cases)
+    {
+        TextGenerator gen(12345);
+        size_t failures = 0;
+        size_t invalid = 0;
+        for (size_t i = 0; i < cases && failures < 20; i++) {
+            auto utf16 = ToUtf16(gen.CodePoints());
+            auto utf8 = *ReferenceUtf16ToUtf8(utf16);
+            if (gen.Chance(50)) {
+                gen.Corrupt(utf8);
+                gen.Corrupt(utf16);
+            }
+            invalid += !ReferenceUtf8ToUtf16(utf8) + !ReferenceUtf16ToUtf8(utf16);
+            failures += CheckUtf8(utf8) + CheckUtf16(utf16);
+        }
+        printf("fuzz   %zu cases each way, %zu of them malformed, %zu mismatches\n", cases, invalid, failures);
+        return failures;
+    }
+
+    std::vector<std::string> LoadCorpus(const char* path)
+    {
+        std::vector<std::string> lines;
+        std::ifstream file(path, std::ios::binary);
+        std::string line;
+        while (std::getline(file, line)) {
+            // timestamp, map, name, message
+            size_t field = 0;
+            for (int i = 0; i < 3 && field != std::string::npos; i++) {
+                field = line.find('\t', field ? field + 1 : 0);
+            }
+            if (field != std::string::npos) {
+                lines.push_back(line.substr(field + 1));
+            }
+        }
+        return lines;
+    }
+
+    template <typename Fn>
+    double NanosecondsPerByte(const std::vector<std::string>& texts, const size_t repeat, Fn&& fn)
+    {
+        size_t bytes = 0;
+        for (const auto& text : texts) {
+            bytes += text.size();
+        }
+        const auto started = Clock::now();
+        for (size_t r = 0; r < repeat; r++) {
+            for (size_t i = 0; i < texts.size(); i++) {
+                fn(i);
+            }
+        }
+        return std::chrono::duration<double, std::nano>(Clock::now() - started).count() / static_cast<double>(bytes * repeat);
+    }
+
+    // Times by the size of the UTF-8 side, both ways; into one reused buffer for ours, as callers with their own buffer would
+    size_t Time(const char* label, const std::vector<std::string>& texts, const size_t repeat)
+    {
+        std::vector<std::u16string> utf16;
+        for (const auto& text : texts) {
+            utf16.push_back(*ReferenceUtf8ToUtf16(text));
+        }
+        std::wstring_convert<std::codecvt_utf8_utf16<char16_t>, char16_t> codecvt;
+        size_t failures = 0;
+        for (size_t i = 0; i < texts.size(); i++) {
+            if (codecvt.from_bytes(texts[i]) != utf16[i] || codecvt.to_bytes(utf16[i]) != texts[i]) {
+                printf("std::codecvt disagrees on \"%s\"\n", texts[i].c_str());
+                failures++;
+            }
+        }
+
+        size_t sink = 0;
+        std::u16string wide_buffer;
+        std::string narrow_buffer;
+        printf("%s, %zu strings, ns/byte of UTF-8\n", label, texts.size());
+        printf("  UTF-8 -> UTF-16   codecvt %6.2f", NanosecondsPerByte(texts, repeat, [&](const size_t i) { sink += codecvt.from_bytes(texts[i]).size(); }));
+        for (size_t level = 0; level < Levels(); level++) {
+            printf("   %s %6.2f", LEVEL_NAMES[level], NanosecondsPerByte(texts, repeat, [&](const size_t i) {
+                       wide_buffer.resize(texts[i].size());
+                       sink += detail::TranscodeUtf8ToUtf16<true>(texts[i], wide_buffer.data(), LEVELS[level]);
+                   }));
+        }
+        printf("\n  UTF-16 -> UTF-8   codecvt %6.2f", NanosecondsPerByte(texts, repeat, [&](const size_t i) { sink += codecvt.to_bytes(utf16[i]).size(); }));
+        for (size_t level = 0; level < Levels(); level++) {
+            printf("   %s %6.2f", LEVEL_NAMES[level], NanosecondsPerByte(texts, repeat, [&](const size_t i) {
+                       narrow_buffer.resize(utf16[i].size() * 3);
+                       sink += detail::TranscodeUtf16ToUtf8<true>(std::u16string_view(utf16[i]), narrow_buffer.data(), LEVELS[level]);
+                   }));
+        }
+        // Measuring has no side effects, so it reads its input and stores its result through volatiles, to keep it inside the timed loop
+        volatile size_t measured = 0;
+        printf("\n  length only       UTF-8 %6.2f   UTF-16 %6.2f   (%zu)\n", NanosecondsPerByte(texts, repeat, [&](const size_t i) {
+                   const char* volatile data = texts[i].data();
+                   measured = detail::TranscodeUtf8ToUtf16<false, char16_t>({data, texts[i].size()}, nullptr, detail::BestSimd());
+               }),
+               NanosecondsPerByte(texts, repeat, [&](const size_t i) {
+                   const char16_t* volatile data = utf16[i].data();
+                   measured = detail::TranscodeUtf16ToUtf8<false>(std::u16string_view(data, utf16[i].size()), nullptr, detail::BestSimd());
+               }),
+               sink);
+        return failures;
+    }
+}
+
+int main(const int argc, char** argv)
+{
+    size_t cases = 20000;
+    if (argc > 1) {
+        std::from_chars(argv[1], argv[1] + strlen(argv[1]), cases);
+    }
+    const auto lines = LoadCorpus(argc > 2 ? argv[2] : TESTS_DATA_DIR "/trade_chat.txt");
+    if (lines.empty()) {
+        printf("no chat corpus\n");
+        return 1;
+    }
+    if (Levels() < std::size(LEVELS)) {
+        printf("no AVX2 on this CPU, so only the scalar and SSE2 paths are checked\n");
+    }
+
+    size_t failures = Fuzz(cases);
+    for (const auto& line : lines) {
+        failures += CheckUtf8(line);
+    }
+
+    const size_t repeat = cases >= 20000 ? 50 : 1;
+    failures += Time("chat", lines, repeat);
+    failures += Time("names", {"Ðéstròyér Çhåøs Äxe", "Ŝtëvîe Wönder Of Ťhe Ñorth", "Mïstress Ōf Ĝreed", "Ｆｕｌｌｗｉｄｔｈ Ｔｒａｄｅｒ", "ギルドウォーズ 🐸 트레이더"}, repeat * 100);
+    std::string long_ascii;
+    for (const auto& line : lines) {
+        long_ascii += line;
+        long_ascii += ' ';
+    }
+    failures += Time("one long ASCII run", {long_ascii}, repeat);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+// Stands in for GWToolboxdll/stdafx.h when building Toolbox sources outside the game: the standard headers only.
+
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <cwctype>
+
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <concepts>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ranges>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>